@@ -38,6 +38,31 @@ static_libraries_needed_by_slang := \
 	libLLVMBitWriter_2_9_func \
 	libLLVMBitWriter_3_2
 
+# The sources of the RenderScript front end, also linked into the tools
+# driving it (see benchmarks/).
+slang_rs_src_files :=	\
+	rs_cc_options.cpp \
+	slang_rs.cpp	\
+	slang_rs_ast_replace.cpp	\
+	slang_rs_check_ast.cpp	\
+	slang_rs_compile_cache.cpp	\
+	slang_rs_context.cpp	\
+	slang_rs_pragma_handler.cpp	\
+	slang_rs_backend.cpp	\
+	slang_rs_exportable.cpp	\
+	slang_rs_export_type.cpp	\
+	slang_rs_export_element.cpp	\
+	slang_rs_export_var.cpp	\
+	slang_rs_export_func.cpp	\
+	slang_rs_export_foreach.cpp \
+	slang_rs_object_ref_count.cpp	\
+	slang_rs_reflection.cpp \
+	slang_rs_reflection_cpp.cpp \
+	slang_rs_reflect_utils.cpp \
+	scalarize_tbaa.cpp \
+	strip_bitcode.cpp \
+	strip_unknown_attributes.cpp
+
 # Static library libslang for host
 # ========================================================
 include $(CLEAR_VARS)
@@ -70,7 +95,14 @@ TBLGEN_TABLES :=    \
 LOCAL_SRC_FILES :=	\
 	slang.cpp	\
 	slang_utils.cpp	\
+	slang_file_cache.cpp	\
+	slang_memory_file_system.cpp	\
+	slang_output_sink.cpp	\
 	slang_backend.cpp	\
+	slang_bitcode_index.cpp	\
+	slang_dependency_recorder.cpp	\
+	slang_phase_report.cpp	\
+	slang_profile.cpp	\
 	slang_pragma_recorder.cpp	\
 	slang_diagnostic_buffer.cpp
 
@@ -138,24 +170,7 @@ TBLGEN_TABLES :=    \
 
 LOCAL_SRC_FILES :=	\
 	llvm-rs-cc.cpp	\
-	rs_cc_options.cpp \
-	slang_rs.cpp	\
-	slang_rs_ast_replace.cpp	\
-	slang_rs_check_ast.cpp	\
-	slang_rs_context.cpp	\
-	slang_rs_pragma_handler.cpp	\
-	slang_rs_backend.cpp	\
-	slang_rs_exportable.cpp	\
-	slang_rs_export_type.cpp	\
-	slang_rs_export_element.cpp	\
-	slang_rs_export_var.cpp	\
-	slang_rs_export_func.cpp	\
-	slang_rs_export_foreach.cpp \
-	slang_rs_object_ref_count.cpp	\
-	slang_rs_reflection.cpp \
-	slang_rs_reflection_cpp.cpp \
-	slang_rs_reflect_utils.cpp \
-	strip_unknown_attributes.cpp
+	$(slang_rs_src_files)
 
 LOCAL_STATIC_LIBRARIES :=	\
 	libslang \
@@ -29,8 +29,14 @@
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cctype>
+#include <cstring>
 #include <map>
+#include <vector>
+#ifndef USE_MINGW
+#include <thread>
+#endif
 using namespace llvm;
 
 static bool EnablePreserveUseListOrdering = false;
@@ -65,6 +71,106 @@ enum {
   SWITCH_INST_MAGIC = 0x4B5 // May 2012 => 1205 => Hex
 };
 
+/// GetVBRBits - Return the number of bits V takes encoded as a VBR of the
+/// given width.
+static unsigned GetVBRBits(uint64_t V, unsigned Width) {
+  unsigned Bits = V ? Log2_64(V) + 1 : 1;
+  return ((Bits + Width - 2) / (Width - 1)) * Width;
+}
+
+namespace {
+/// OperandHistogram - Counts of the operands of some records by the number of
+/// significant bits they have, used to pick the width encoding them as VBRs
+/// in the fewest bits.
+struct OperandHistogram {
+  enum { MinVBRWidth = 2, MaxVBRWidth = 12 };
+
+  uint64_t Counts[65];
+
+  OperandHistogram() { memset(Counts, 0, sizeof(Counts)); }
+
+  void add(uint64_t V) { ++Counts[V ? Log2_64(V) + 1 : 0]; }
+
+  /// getVBRBits - Return the number of bits the operands take encoded as
+  /// VBRs of the given width.
+  uint64_t getVBRBits(unsigned Width) const {
+    uint64_t Bits = 0;
+    for (unsigned i = 0; i != 65; ++i)
+      Bits += Counts[i] * GetVBRBits(i ? (1ULL << (i - 1)) : 0, Width);
+    return Bits;
+  }
+
+  unsigned getBestVBRWidth() const {
+    unsigned Best = 6;
+    uint64_t BestBits = getVBRBits(Best);
+    for (unsigned W = MinVBRWidth; W <= MaxVBRWidth; ++W) {
+      uint64_t Bits = getVBRBits(W);
+      if (Bits < BestBits) {
+        Best = W;
+        BestBits = Bits;
+      }
+    }
+    return Best;
+  }
+};
+
+/// RecordStats - What the size-optimized encoding knows about the records of
+/// a given code in the function blocks that are emitted unabbreviated.
+struct RecordStats {
+  uint64_t NumRecords;
+  OperandHistogram Operands;
+
+  RecordStats() : NumRecords(0) {}
+};
+
+/// BitcodeEncoding - The choices of the writer that are not fixed by the
+/// bitcode format. The defaults are the encoding LLVM 3.2 uses; the
+/// size-optimized encoding (see ChooseSizeOptimizedEncoding()) derives them
+/// from the statistics of the module written, and stays readable by the 3.2
+/// reader.
+struct BitcodeEncoding {
+  bool OptimizeForSize;
+
+  /// CollectingStats - True while the function bodies are only walked to
+  /// collect the statistics, in which case no record is emitted.
+  bool CollectingStats;
+
+  /// ValueVBRWidth - Width of the value operands of the INST_LOAD,
+  /// INST_BINOP, INST_CAST and INST_RET abbrevs.
+  unsigned ValueVBRWidth;
+
+  /// MDNodeVBRWidth - Width of the operands of the METADATA_NODE abbrev (only
+  /// defined when optimizing for size).
+  unsigned MDNodeVBRWidth;
+
+  /// FunctionAbbrevWidth - Width of the abbrev ids of the function blocks.
+  unsigned FunctionAbbrevWidth;
+
+  /// RecordAbbrevs - Pairs of <record code, operand VBR width> of the
+  /// [code, array of VBRs] abbrevs defined for the FUNCTION_BLOCK after the
+  /// fixed ones, in abbrev id order.
+  std::vector<std::pair<unsigned, unsigned> > RecordAbbrevs;
+
+  /// Statistics of the function blocks, by record code.
+  std::map<unsigned, RecordStats> Records;
+  OperandHistogram ValueOperands;
+  uint64_t NumFunctionRecords;
+
+  BitcodeEncoding()
+    : OptimizeForSize(false), CollectingStats(false), ValueVBRWidth(6),
+      MDNodeVBRWidth(6), FunctionAbbrevWidth(4), NumFunctionRecords(0) {}
+
+  /// getRecordAbbrev - Return the abbrev id chosen for records of the given
+  /// code, or 0 if there is none.
+  unsigned getRecordAbbrev(unsigned Code) const {
+    for (unsigned i = 0, e = RecordAbbrevs.size(); i != e; ++i)
+      if (RecordAbbrevs[i].first == Code)
+        return FUNCTION_INST_UNREACHABLE_ABBREV + 1 + i;
+    return 0;
+  }
+};
+}  // end anonymous namespace
+
 static unsigned GetEncodedCastOpcode(unsigned Opcode) {
   switch (Opcode) {
   default: llvm_unreachable("Unknown cast instruction!");
@@ -569,7 +675,8 @@ static uint64_t GetOptimizationFlags(const Value *V) {
 static void WriteMDNode(const MDNode *N,
                         const llvm_3_2::ValueEnumerator &VE,
                         BitstreamWriter &Stream,
-                        SmallVector<uint64_t, 64> &Record) {
+                        SmallVector<uint64_t, 64> &Record,
+                        unsigned NodeAbbrev = 0) {
   for (unsigned i = 0, e = N->getNumOperands(); i != e; ++i) {
     if (N->getOperand(i)) {
       Record.push_back(VE.getTypeID(N->getOperand(i)->getType()));
@@ -581,16 +688,74 @@ static void WriteMDNode(const MDNode *N,
   }
   unsigned MDCode = N->isFunctionLocal() ? bitc::METADATA_FN_NODE :
                                            bitc::METADATA_NODE;
-  Stream.EmitRecord(MDCode, Record, 0);
+  Stream.EmitRecord(MDCode, Record,
+                    MDCode == bitc::METADATA_NODE ? NodeAbbrev : 0);
   Record.clear();
 }
 
+namespace {
+/// MetadataAbbrevs - The abbrev ids of the module METADATA_BLOCK, 0 for the
+/// records emitted unabbreviated.
+struct MetadataAbbrevs {
+  unsigned String8;
+  unsigned String6;
+  unsigned Node;
+  unsigned Name;
+
+  MetadataAbbrevs() : String8(0), String6(0), Node(0), Name(0) {}
+};
+}  // end anonymous namespace
+
+/// WriteSizeOptimizedMetadataAbbrevs - Define the abbrevs the size-optimized
+/// encoding uses in the module METADATA_BLOCK, which has room for four.
+static void WriteSizeOptimizedMetadataAbbrevs(const BitcodeEncoding &Enc,
+                                              BitstreamWriter &Stream,
+                                              MetadataAbbrevs &Abbrevs) {
+  { // 8-bit fixed-width METADATA_STRING.
+    BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_STRING));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 8));
+    Abbrevs.String8 = Stream.EmitAbbrev(Abbv);
+  }
+  { // 6-bit char6 METADATA_STRING.
+    BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_STRING));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Char6));
+    Abbrevs.String6 = Stream.EmitAbbrev(Abbv);
+  }
+  { // METADATA_NODE: [n x [type num, value num]]
+    BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_NODE));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, Enc.MDNodeVBRWidth));
+    Abbrevs.Node = Stream.EmitAbbrev(Abbv);
+  }
+  { // 8-bit fixed-width METADATA_NAME.
+    BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_NAME));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 8));
+    Abbrevs.Name = Stream.EmitAbbrev(Abbv);
+  }
+}
+
+/// IsChar6String - Return true if all the characters of Str fit in char6.
+static bool IsChar6String(StringRef Str) {
+  for (StringRef::iterator C = Str.begin(), E = Str.end(); C != E; ++C)
+    if (!BitCodeAbbrevOp::isChar6(*C))
+      return false;
+  return true;
+}
+
 static void WriteModuleMetadata(const Module *M,
                                 const llvm_3_2::ValueEnumerator &VE,
+                                const BitcodeEncoding &Enc,
                                 BitstreamWriter &Stream) {
   const llvm_3_2::ValueEnumerator::ValueList &Vals = VE.getMDValues();
   bool StartedMetadataBlock = false;
-  unsigned MDSAbbrev = 0;
+  MetadataAbbrevs Abbrevs;
   SmallVector<uint64_t, 64> Record;
   for (unsigned i = 0, e = Vals.size(); i != e; ++i) {
 
@@ -598,20 +763,26 @@ static void WriteModuleMetadata(const Module *M,
       if (!N->isFunctionLocal() || !N->getFunction()) {
         if (!StartedMetadataBlock) {
           Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
+          if (Enc.OptimizeForSize)
+            WriteSizeOptimizedMetadataAbbrevs(Enc, Stream, Abbrevs);
           StartedMetadataBlock = true;
         }
-        WriteMDNode(N, VE, Stream, Record);
+        WriteMDNode(N, VE, Stream, Record, Abbrevs.Node);
       }
     } else if (const MDString *MDS = dyn_cast<MDString>(Vals[i].first)) {
       if (!StartedMetadataBlock)  {
         Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
 
-        // Abbrev for METADATA_STRING.
-        BitCodeAbbrev *Abbv = new BitCodeAbbrev();
-        Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_STRING));
-        Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
-        Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 8));
-        MDSAbbrev = Stream.EmitAbbrev(Abbv);
+        if (Enc.OptimizeForSize) {
+          WriteSizeOptimizedMetadataAbbrevs(Enc, Stream, Abbrevs);
+        } else {
+          // Abbrev for METADATA_STRING.
+          BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+          Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_STRING));
+          Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+          Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 8));
+          Abbrevs.String8 = Stream.EmitAbbrev(Abbv);
+        }
         StartedMetadataBlock = true;
       }
 
@@ -619,6 +790,9 @@ static void WriteModuleMetadata(const Module *M,
       Record.append(MDS->begin(), MDS->end());
 
       // Emit the finished record.
+      unsigned MDSAbbrev = Abbrevs.String8;
+      if (Abbrevs.String6 && IsChar6String(MDS->getString()))
+        MDSAbbrev = Abbrevs.String6;
       Stream.EmitRecord(bitc::METADATA_STRING, Record, MDSAbbrev);
       Record.clear();
     }
@@ -630,6 +804,8 @@ static void WriteModuleMetadata(const Module *M,
     const NamedMDNode *NMD = I;
     if (!StartedMetadataBlock)  {
       Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
+      if (Enc.OptimizeForSize)
+        WriteSizeOptimizedMetadataAbbrevs(Enc, Stream, Abbrevs);
       StartedMetadataBlock = true;
     }
 
@@ -637,7 +813,7 @@ static void WriteModuleMetadata(const Module *M,
     StringRef Str = NMD->getName();
     for (unsigned i = 0, e = Str.size(); i != e; ++i)
       Record.push_back(Str[i]);
-    Stream.EmitRecord(bitc::METADATA_NAME, Record, 0/*TODO*/);
+    Stream.EmitRecord(bitc::METADATA_NAME, Record, Abbrevs.Name);
     Record.clear();
 
     // Write named metadata operands.
@@ -1044,9 +1220,52 @@ static bool PushValueAndType(const Value *V, unsigned InstID,
   return false;
 }
 
+/// GetNumAbbrevValueOperands - Return the number of value operands the
+/// records emitted with the given FUNCTION_BLOCK abbrev start with.
+static unsigned GetNumAbbrevValueOperands(unsigned Abbrev) {
+  switch (Abbrev) {
+  case FUNCTION_INST_LOAD_ABBREV:
+  case FUNCTION_INST_CAST_ABBREV:
+  case FUNCTION_INST_RET_VAL_ABBREV:
+    return 1;
+  case FUNCTION_INST_BINOP_ABBREV:
+  case FUNCTION_INST_BINOP_FLAGS_ABBREV:
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+/// EmitFunctionRecord - Emit a record of a function block. The records
+/// without an abbrev use the one the size-optimized encoding chose for their
+/// code, if any. While collecting the statistics, the record is only counted.
+static void EmitFunctionRecord(unsigned Code, SmallVectorImpl<unsigned> &Vals,
+                               unsigned AbbrevToUse, BitcodeEncoding &Enc,
+                               BitstreamWriter &Stream) {
+  if (Enc.CollectingStats) {
+    ++Enc.NumFunctionRecords;
+    if (AbbrevToUse) {
+      for (unsigned i = 0, e = GetNumAbbrevValueOperands(AbbrevToUse);
+           i != e; ++i)
+        Enc.ValueOperands.add(Vals[i]);
+    } else {
+      RecordStats &Stats = Enc.Records[Code];
+      ++Stats.NumRecords;
+      for (unsigned i = 0, e = Vals.size(); i != e; ++i)
+        Stats.Operands.add(Vals[i]);
+    }
+    return;
+  }
+
+  if (!AbbrevToUse)
+    AbbrevToUse = Enc.getRecordAbbrev(Code);
+  Stream.EmitRecord(Code, Vals, AbbrevToUse);
+}
+
 /// WriteInstruction - Emit an instruction to the specified stream.
 static void WriteInstruction(const Instruction &I, unsigned InstID,
                              llvm_3_2::ValueEnumerator &VE,
+                             BitcodeEncoding &Enc,
                              BitstreamWriter &Stream,
                              SmallVector<unsigned, 64> &Vals) {
   unsigned Code = 0;
@@ -1337,13 +1556,14 @@ static void WriteInstruction(const Instruction &I, unsigned InstID,
     break;
   }
 
-  Stream.EmitRecord(Code, Vals, AbbrevToUse);
+  EmitFunctionRecord(Code, Vals, AbbrevToUse, Enc, Stream);
   Vals.clear();
 }
 
 // Emit names for globals/functions etc.
 static void WriteValueSymbolTable(const ValueSymbolTable &VST,
                                   const llvm_3_2::ValueEnumerator &VE,
+                                  const BitcodeEncoding &Enc,
                                   BitstreamWriter &Stream) {
   if (VST.empty()) return;
   Stream.EnterSubblock(bitc::VALUE_SYMTAB_BLOCK_ID, 4);
@@ -1355,6 +1575,14 @@ static void WriteValueSymbolTable(const ValueSymbolTable &VST,
   for (ValueSymbolTable::const_iterator SI = VST.begin(), SE = VST.end();
        SI != SE; ++SI) {
 
+    // Nothing refers to the globals with local linkage by name, so the
+    // size-optimized encoding leaves them unnamed.
+    if (Enc.OptimizeForSize) {
+      const GlobalValue *GV = dyn_cast<GlobalValue>(SI->getValue());
+      if (GV && GV->hasLocalLinkage())
+        continue;
+    }
+
     const ValueName &Name = *SI;
 
     // Figure out the encoding to use for the name.
@@ -1401,8 +1629,8 @@ static void WriteValueSymbolTable(const ValueSymbolTable &VST,
 
 /// WriteFunction - Emit a function body to the module stream.
 static void WriteFunction(const Function &F, llvm_3_2::ValueEnumerator &VE,
-                          BitstreamWriter &Stream) {
-  Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+                          BitcodeEncoding &Enc, BitstreamWriter &Stream) {
+  Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, Enc.FunctionAbbrevWidth);
   VE.incorporateFunction(F);
 
   SmallVector<unsigned, 64> Vals;
@@ -1432,7 +1660,7 @@ static void WriteFunction(const Function &F, llvm_3_2::ValueEnumerator &VE,
   for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
     for (BasicBlock::const_iterator I = BB->begin(), E = BB->end();
          I != E; ++I) {
-      WriteInstruction(*I, InstID, VE, Stream, Vals);
+      WriteInstruction(*I, InstID, VE, Enc, Stream, Vals);
 
       if (!I->getType()->isVoidTy())
         ++InstID;
@@ -1446,7 +1674,8 @@ static void WriteFunction(const Function &F, llvm_3_2::ValueEnumerator &VE,
         // nothing todo.
       } else if (DL == LastDL) {
         // Just repeat the same debug loc as last time.
-        Stream.EmitRecord(bitc::FUNC_CODE_DEBUG_LOC_AGAIN, Vals);
+        EmitFunctionRecord(bitc::FUNC_CODE_DEBUG_LOC_AGAIN, Vals, 0, Enc,
+                           Stream);
       } else {
         MDNode *Scope, *IA;
         DL.getScopeAndInlinedAt(Scope, IA, I->getContext());
@@ -1455,15 +1684,17 @@ static void WriteFunction(const Function &F, llvm_3_2::ValueEnumerator &VE,
         Vals.push_back(DL.getCol());
         Vals.push_back(Scope ? VE.getValueID(Scope)+1 : 0);
         Vals.push_back(IA ? VE.getValueID(IA)+1 : 0);
-        Stream.EmitRecord(bitc::FUNC_CODE_DEBUG_LOC, Vals);
+        EmitFunctionRecord(bitc::FUNC_CODE_DEBUG_LOC, Vals, 0, Enc, Stream);
         Vals.clear();
 
         LastDL = DL;
       }
     }
 
-  // Emit names for all the instructions etc.
-  WriteValueSymbolTable(F.getValueSymbolTable(), VE, Stream);
+  // Emit names for all the instructions etc. The size-optimized encoding
+  // leaves the values local to the function unnamed.
+  if (!Enc.OptimizeForSize)
+    WriteValueSymbolTable(F.getValueSymbolTable(), VE, Enc, Stream);
 
   if (NeedsMetadataAttachment)
     WriteMetadataAttachment(F, VE, Stream);
@@ -1471,8 +1702,133 @@ static void WriteFunction(const Function &F, llvm_3_2::ValueEnumerator &VE,
   Stream.ExitBlock();
 }
 
+/// CollectFunctionStats - Walk the instructions of F the way WriteFunction()
+/// does, counting the records it would emit in Enc.
+static void CollectFunctionStats(const Function &F,
+                                 llvm_3_2::ValueEnumerator &VE,
+                                 BitcodeEncoding &Enc,
+                                 BitstreamWriter &Stream) {
+  VE.incorporateFunction(F);
+
+  SmallVector<unsigned, 64> Vals;
+  unsigned CstStart, CstEnd;
+  VE.getFunctionConstantRange(CstStart, CstEnd);
+  unsigned InstID = CstEnd;
+  DebugLoc LastDL;
+
+  for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    for (BasicBlock::const_iterator I = BB->begin(), E = BB->end();
+         I != E; ++I) {
+      WriteInstruction(*I, InstID, VE, Enc, Stream, Vals);
+
+      if (!I->getType()->isVoidTy())
+        ++InstID;
+
+      DebugLoc DL = I->getDebugLoc();
+      if (DL.isUnknown()) {
+        // nothing todo.
+      } else if (DL == LastDL) {
+        EmitFunctionRecord(bitc::FUNC_CODE_DEBUG_LOC_AGAIN, Vals, 0, Enc,
+                           Stream);
+      } else {
+        MDNode *Scope, *IA;
+        DL.getScopeAndInlinedAt(Scope, IA, I->getContext());
+
+        Vals.push_back(DL.getLine());
+        Vals.push_back(DL.getCol());
+        Vals.push_back(Scope ? VE.getValueID(Scope)+1 : 0);
+        Vals.push_back(IA ? VE.getValueID(IA)+1 : 0);
+        EmitFunctionRecord(bitc::FUNC_CODE_DEBUG_LOC, Vals, 0, Enc, Stream);
+        Vals.clear();
+
+        LastDL = DL;
+      }
+    }
+
+  VE.purgeFunction();
+}
+
+/// ChooseSizeOptimizedEncoding - Collect the statistics of the records of M
+/// and set up Enc to encode them in as few bits as possible:
+///  - the value operands of the fixed FUNCTION_BLOCK abbrevs get the VBR
+///    width that suits them best,
+///  - the unabbreviated function block records whose code saves the most
+///    bits get an abbrev of their own, and
+///  - so do the operands of the module METADATA_NODEs.
+static void ChooseSizeOptimizedEncoding(const Module *M,
+                                        llvm_3_2::ValueEnumerator &VE,
+                                        BitstreamWriter &Stream,
+                                        BitcodeEncoding &Enc) {
+  // Cost of the definition of a [code, array of VBRs] abbrev in the BLOCKINFO
+  // block.
+  const uint64_t AbbrevDefinitionBits = 40;
+  // Abbrev ids fitting in the 4 and 5 bits wide ids of the function blocks.
+  const unsigned MaxNarrowAbbrevs = 15 - FUNCTION_INST_UNREACHABLE_ABBREV;
+  const unsigned MaxWideAbbrevs = 31 - FUNCTION_INST_UNREACHABLE_ABBREV;
+
+  Enc.OptimizeForSize = true;
+  Enc.CollectingStats = true;
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
+    if (!F->isDeclaration())
+      CollectFunctionStats(*F, VE, Enc, Stream);
+  Enc.CollectingStats = false;
+
+  Enc.ValueVBRWidth = Enc.ValueOperands.getBestVBRWidth();
+
+  // Rank the codes by the bits an abbrev of their own would save.
+  std::vector<std::pair<uint64_t, std::pair<unsigned, unsigned> > > Savings;
+  for (std::map<unsigned, RecordStats>::const_iterator
+       I = Enc.Records.begin(), E = Enc.Records.end(); I != E; ++I) {
+    const RecordStats &Stats = I->second;
+    unsigned Width = Stats.Operands.getBestVBRWidth();
+    uint64_t Before = Stats.NumRecords * GetVBRBits(I->first, 6) +
+                      Stats.Operands.getVBRBits(6);
+    uint64_t After = Stats.Operands.getVBRBits(Width) + AbbrevDefinitionBits;
+    if (After < Before)
+      Savings.push_back(std::make_pair(Before - After,
+                                       std::make_pair(I->first, Width)));
+  }
+  std::sort(Savings.rbegin(), Savings.rend());
+
+  // Going past the 4-bit abbrev ids costs one more bit per record.
+  unsigned NumAbbrevs = std::min<unsigned>(Savings.size(), MaxNarrowAbbrevs);
+  uint64_t NarrowSaved = 0, WideSaved = 0;
+  for (unsigned i = 0, e = std::min<unsigned>(Savings.size(), MaxWideAbbrevs);
+       i != e; ++i) {
+    if (i < MaxNarrowAbbrevs)
+      NarrowSaved += Savings[i].first;
+    WideSaved += Savings[i].first;
+  }
+  if (WideSaved > NarrowSaved + Enc.NumFunctionRecords) {
+    NumAbbrevs = std::min<unsigned>(Savings.size(), MaxWideAbbrevs);
+    Enc.FunctionAbbrevWidth = 5;
+  }
+  for (unsigned i = 0; i != NumAbbrevs; ++i)
+    Enc.RecordAbbrevs.push_back(Savings[i].second);
+
+  // The operands of the METADATA_NODEs, see WriteMDNode().
+  OperandHistogram MDNodeOperands;
+  const llvm_3_2::ValueEnumerator::ValueList &MDVals = VE.getMDValues();
+  for (unsigned i = 0, e = MDVals.size(); i != e; ++i) {
+    const MDNode *N = dyn_cast<MDNode>(MDVals[i].first);
+    if (!N || N->isFunctionLocal())
+      continue;
+    for (unsigned j = 0, je = N->getNumOperands(); j != je; ++j) {
+      if (const Value *Op = N->getOperand(j)) {
+        MDNodeOperands.add(VE.getTypeID(Op->getType()));
+        MDNodeOperands.add(VE.getValueID(Op));
+      } else {
+        MDNodeOperands.add(VE.getTypeID(Type::getVoidTy(N->getContext())));
+        MDNodeOperands.add(0);
+      }
+    }
+  }
+  Enc.MDNodeVBRWidth = MDNodeOperands.getBestVBRWidth();
+}
+
 // Emit blockinfo, which defines the standard abbreviations etc.
 static void WriteBlockInfo(const llvm_3_2::ValueEnumerator &VE,
+                           const BitcodeEncoding &Enc,
                            BitstreamWriter &Stream) {
   // We only want to emit block info records for blocks that have multiple
   // instances: CONSTANTS_BLOCK, FUNCTION_BLOCK and VALUE_SYMTAB_BLOCK.  Other
@@ -1567,7 +1923,8 @@ static void WriteBlockInfo(const llvm_3_2::ValueEnumerator &VE,
   { // INST_LOAD abbrev for FUNCTION_BLOCK.
     BitCodeAbbrev *Abbv = new BitCodeAbbrev();
     Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_LOAD));
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // Ptr
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR,
+                              Enc.ValueVBRWidth)); // Ptr
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 4)); // Align
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 1)); // volatile
     if (Stream.EmitBlockInfoAbbrev(bitc::FUNCTION_BLOCK_ID,
@@ -1577,8 +1934,10 @@ static void WriteBlockInfo(const llvm_3_2::ValueEnumerator &VE,
   { // INST_BINOP abbrev for FUNCTION_BLOCK.
     BitCodeAbbrev *Abbv = new BitCodeAbbrev();
     Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_BINOP));
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // LHS
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // RHS
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR,
+                              Enc.ValueVBRWidth)); // LHS
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR,
+                              Enc.ValueVBRWidth)); // RHS
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 4)); // opc
     if (Stream.EmitBlockInfoAbbrev(bitc::FUNCTION_BLOCK_ID,
                                    Abbv) != FUNCTION_INST_BINOP_ABBREV)
@@ -1587,8 +1946,10 @@ static void WriteBlockInfo(const llvm_3_2::ValueEnumerator &VE,
   { // INST_BINOP_FLAGS abbrev for FUNCTION_BLOCK.
     BitCodeAbbrev *Abbv = new BitCodeAbbrev();
     Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_BINOP));
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // LHS
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // RHS
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR,
+                              Enc.ValueVBRWidth)); // LHS
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR,
+                              Enc.ValueVBRWidth)); // RHS
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 4)); // opc
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 7)); // flags
     if (Stream.EmitBlockInfoAbbrev(bitc::FUNCTION_BLOCK_ID,
@@ -1598,7 +1959,8 @@ static void WriteBlockInfo(const llvm_3_2::ValueEnumerator &VE,
   { // INST_CAST abbrev for FUNCTION_BLOCK.
     BitCodeAbbrev *Abbv = new BitCodeAbbrev();
     Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_CAST));
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));    // OpVal
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR,
+                              Enc.ValueVBRWidth));    // OpVal
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed,       // dest ty
                               Log2_32_Ceil(VE.getTypes().size()+1)));
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 4));  // opc
@@ -1617,7 +1979,8 @@ static void WriteBlockInfo(const llvm_3_2::ValueEnumerator &VE,
   { // INST_RET abbrev for FUNCTION_BLOCK.
     BitCodeAbbrev *Abbv = new BitCodeAbbrev();
     Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_RET));
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // ValID
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR,
+                              Enc.ValueVBRWidth)); // ValID
     if (Stream.EmitBlockInfoAbbrev(bitc::FUNCTION_BLOCK_ID,
                                    Abbv) != FUNCTION_INST_RET_VAL_ABBREV)
       llvm_unreachable("Unexpected abbrev ordering!");
@@ -1630,6 +1993,18 @@ static void WriteBlockInfo(const llvm_3_2::ValueEnumerator &VE,
       llvm_unreachable("Unexpected abbrev ordering!");
   }
 
+  // Abbrevs of the size-optimized encoding for the other records.
+  for (unsigned i = 0, e = Enc.RecordAbbrevs.size(); i != e; ++i) {
+    BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(Enc.RecordAbbrevs[i].first));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR,
+                              Enc.RecordAbbrevs[i].second));
+    if (Stream.EmitBlockInfoAbbrev(bitc::FUNCTION_BLOCK_ID, Abbv) !=
+        FUNCTION_INST_UNREACHABLE_ABBREV + 1 + i)
+      llvm_unreachable("Unexpected abbrev ordering!");
+  }
+
   Stream.ExitBlock();
 }
 
@@ -1731,8 +2106,134 @@ static void WriteModuleUseLists(const Module *M, llvm_3_2::ValueEnumerator &VE,
   Stream.ExitBlock();
 }
 
+namespace {
+/// FunctionBlockWorker - Encodes a share of the function blocks of a module
+/// into a buffer of its own, with its own copy of the ValueEnumerator, so
+/// that several of them can run concurrently.
+struct FunctionBlockWorker {
+  const llvm_3_2::ValueEnumerator *VE;
+  const BitcodeEncoding *Enc;
+  std::vector<const Function *> Functions;
+
+  /// Buffer - A BLOCKINFO block, followed by the function blocks, which start
+  /// at the byte offsets of BlockStarts.
+  SmallVector<char, 0> Buffer;
+  std::vector<size_t> BlockStarts;
+
+  void run();
+};
+}  // end anonymous namespace
+
+void FunctionBlockWorker::run() {
+  llvm_3_2::ValueEnumerator LocalVE(*VE);
+  BitcodeEncoding LocalEnc(*Enc);
+  BitstreamWriter Stream(Buffer);
+
+  // The blocks below use the abbrevs defined in the BLOCKINFO block.
+  WriteBlockInfo(LocalVE, LocalEnc, Stream);
+
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i) {
+    BlockStarts.push_back(Buffer.size());
+    WriteFunction(*Functions[i], LocalVE, LocalEnc, Stream);
+  }
+  BlockStarts.push_back(Buffer.size());
+}
+
+/// EmitEncodedFunctionBlock - Emit the function block of Buffer starting at
+/// byte Begin and ending at End, as encoded by a FunctionBlockWorker.
+///
+/// The worker entered the block from the top level of its stream, on a word
+/// boundary, which took one word for the ENTER_SUBBLOCK header. The header is
+/// emitted again here, for the abbrev id width of the module block. What
+/// follows it (the length of the block, and its contents starting on a word
+/// boundary) does not depend on where the block is, and is copied as is,
+/// which makes the output identical to the one of WriteFunction().
+static void EmitEncodedFunctionBlock(const SmallVectorImpl<char> &Buffer,
+                                     size_t Begin, size_t End,
+                                     const BitcodeEncoding &Enc,
+                                     BitstreamWriter &Stream) {
+  assert(Begin % 4 == 0 && End % 4 == 0 && End - Begin >= 8 &&
+         "Function block not on word boundaries!");
+  Stream.EmitCode(bitc::ENTER_SUBBLOCK);
+  Stream.EmitVBR(bitc::FUNCTION_BLOCK_ID, bitc::BlockIDWidth);
+  Stream.EmitVBR(Enc.FunctionAbbrevWidth, bitc::CodeLenWidth);
+  Stream.FlushToWord();
+
+  const unsigned char *Words =
+      reinterpret_cast<const unsigned char *>(Buffer.data());
+  for (size_t i = Begin + 4; i != End; i += 4)
+    Stream.Emit((uint32_t)Words[i] | ((uint32_t)Words[i+1] << 8) |
+                ((uint32_t)Words[i+2] << 16) | ((uint32_t)Words[i+3] << 24),
+                32);
+}
+
+/// GetNumEncodingThreads - Return the number of threads to encode NumFunctions
+/// function blocks on, NumThreads if non-zero. By default, each thread gets at
+/// least MinFunctionsPerThread functions, under which the copy of the
+/// ValueEnumerator it starts with does not pay off.
+static unsigned GetNumEncodingThreads(unsigned NumFunctions,
+                                      unsigned NumThreads) {
+#ifdef USE_MINGW
+  return 1;
+#else
+  const unsigned MinFunctionsPerThread = 32;
+  if (NumThreads == 0)
+    NumThreads = std::min(std::max(std::thread::hardware_concurrency(), 1U),
+                          NumFunctions / MinFunctionsPerThread);
+  return std::max(std::min(NumThreads, NumFunctions), 1U);
+#endif
+}
+
+/// WriteFunctions - Emit the bodies of the functions defined in M, encoded on
+/// up to NumThreads threads (see GetNumEncodingThreads()). The functions only
+/// depend on the numbering of the module-level values, which VE holds at this
+/// point, so they can be encoded concurrently with copies of it, then emitted
+/// in order.
+static void WriteFunctions(const Module *M, llvm_3_2::ValueEnumerator &VE,
+                           BitcodeEncoding &Enc, BitstreamWriter &Stream,
+                           unsigned NumThreads) {
+  std::vector<const Function *> Functions;
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
+    if (!F->isDeclaration())
+      Functions.push_back(&*F);
+
+  NumThreads = GetNumEncodingThreads(Functions.size(), NumThreads);
+  if (NumThreads <= 1) {
+    for (unsigned i = 0, e = Functions.size(); i != e; ++i)
+      WriteFunction(*Functions[i], VE, Enc, Stream);
+    return;
+  }
+
+#ifndef USE_MINGW
+  // Deal the functions out round-robin, so that the large ones of a module
+  // (which tend to be next to each other) end up on different threads.
+  std::vector<FunctionBlockWorker> Workers(NumThreads);
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i) {
+    FunctionBlockWorker &W = Workers[i % NumThreads];
+    W.VE = &VE;
+    W.Enc = &Enc;
+    W.Functions.push_back(Functions[i]);
+  }
+
+  std::vector<std::thread> Threads;
+  for (unsigned t = 1; t != NumThreads; ++t)
+    Threads.push_back(std::thread(&FunctionBlockWorker::run, &Workers[t]));
+  Workers[0].run();
+  for (unsigned t = 0, e = Threads.size(); t != e; ++t)
+    Threads[t].join();
+
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i) {
+    const FunctionBlockWorker &W = Workers[i % NumThreads];
+    unsigned Block = i / NumThreads;
+    EmitEncodedFunctionBlock(W.Buffer, W.BlockStarts[Block],
+                             W.BlockStarts[Block + 1], Enc, Stream);
+  }
+#endif
+}
+
 /// WriteModule - Emit the specified module to the bitstream.
-static void WriteModule(const Module *M, BitstreamWriter &Stream) {
+static void WriteModule(const Module *M, BitstreamWriter &Stream,
+                        bool OptimizeForSize, unsigned NumThreads) {
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
 
   // Emit the version number if it is non-zero.
@@ -1745,8 +2246,12 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   // Analyze the module, enumerating globals, functions, etc.
   llvm_3_2::ValueEnumerator VE(M);
 
+  BitcodeEncoding Enc;
+  if (OptimizeForSize)
+    ChooseSizeOptimizedEncoding(M, VE, Stream, Enc);
+
   // Emit blockinfo, which defines the standard abbreviations etc.
-  WriteBlockInfo(VE, Stream);
+  WriteBlockInfo(VE, Enc, Stream);
 
   // Emit information about parameter attributes.
   WriteAttributeTable(VE, Stream);
@@ -1762,22 +2267,20 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   WriteModuleConstants(VE, Stream);
 
   // Emit metadata.
-  WriteModuleMetadata(M, VE, Stream);
+  WriteModuleMetadata(M, VE, Enc, Stream);
 
   // Emit metadata.
   WriteModuleMetadataStore(M, Stream);
 
   // Emit names for globals/functions etc.
-  WriteValueSymbolTable(M->getValueSymbolTable(), VE, Stream);
+  WriteValueSymbolTable(M->getValueSymbolTable(), VE, Enc, Stream);
 
   // Emit use-lists.
   if (EnablePreserveUseListOrdering)
     WriteModuleUseLists(M, VE, Stream);
 
   // Emit function bodies.
-  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
-    if (!F->isDeclaration())
-      WriteFunction(*F, VE, Stream);
+  WriteFunctions(M, VE, Enc, Stream, NumThreads);
 
   Stream.ExitBlock();
 }
@@ -1858,6 +2361,11 @@ static void EmitDarwinBCHeaderAndTrailer(SmallVectorImpl<char> &Buffer,
 /// WriteBitcodeToFile - Write the specified module to the specified output
 /// stream.
 void llvm_3_2::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
+  WriteBitcodeToFile(M, Out, false);
+}
+
+void llvm_3_2::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
+                                  bool OptimizeForSize, unsigned NumThreads) {
   SmallVector<char, 1024> Buffer;
   Buffer.reserve(256*1024);
 
@@ -1880,7 +2388,7 @@ void llvm_3_2::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
     Stream.Emit(0xD, 4);
 
     // Emit the module.
-    WriteModule(M, Stream);
+    WriteModule(M, Stream, OptimizeForSize, NumThreads);
   }
 
   if (TT.isOSDarwin())
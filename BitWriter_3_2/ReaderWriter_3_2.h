@@ -55,9 +55,22 @@ namespace llvm_3_2 {
   /// should be in "binary" mode.
   void WriteBitcodeToFile(const llvm::Module *M, llvm::raw_ostream &Out);
 
+  /// WriteBitcodeToFile - Same as above. If OptimizeForSize is true, the
+  /// abbreviations and the VBR widths are chosen from the statistics of the
+  /// module, and the values with local linkage are left unnamed, which makes
+  /// the bitcode smaller but still readable by the 3.2 reader.
+  ///
+  /// The function bodies are encoded on up to NumThreads threads; 0 picks a
+  /// number suiting the size of the module and the host, 1 encodes them on
+  /// the calling thread. The output does not depend on it.
+  void WriteBitcodeToFile(const llvm::Module *M, llvm::raw_ostream &Out,
+                          bool OptimizeForSize, unsigned NumThreads = 0);
+
   /// createBitcodeWriterPass - Create and return a pass that writes the module
-  /// to the specified ostream.
-  llvm::ModulePass *createBitcodeWriterPass(llvm::raw_ostream &Str);
+  /// to the specified ostream, as WriteBitcodeToFile() does.
+  llvm::ModulePass *createBitcodeWriterPass(llvm::raw_ostream &Str,
+                                            bool OptimizeForSize = false,
+                                            unsigned NumThreads = 0);
 
 
   /// isBitcodeWrapper - Return true if the given bytes are the magic bytes
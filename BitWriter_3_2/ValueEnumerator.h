@@ -87,11 +87,12 @@ private:
   unsigned FirstFuncConstantID;
   unsigned FirstInstID;
 
-  ValueEnumerator(const ValueEnumerator &);  // DO NOT IMPLEMENT
-  void operator=(const ValueEnumerator &);   // DO NOT IMPLEMENT
 public:
   ValueEnumerator(const llvm::Module *M);
 
+  // The copy constructor is used by the writer to encode function bodies on
+  // several threads, each incorporating functions into its own copy.
+
   void dump() const;
   void print(llvm::raw_ostream &OS, const ValueMapType &Map, const char *Name) const;
 
@@ -0,0 +1,185 @@
+#
+# Copyright (C) 2014 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+LOCAL_PATH := $(call my-dir)
+
+# The prebuilt tools should be used when we are doing app-only build.
+ifeq ($(TARGET_BUILD_APPS),)
+
+LLVM_ROOT_PATH := external/llvm
+include $(LLVM_ROOT_PATH)/llvm.mk
+
+# Executable bitcode-writer-bench for host
+# ========================================================
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := bitcode-writer-bench
+LOCAL_MODULE_TAGS := optional
+ifneq ($(HOST_OS),windows)
+LOCAL_CLANG := true
+endif
+
+LOCAL_MODULE_CLASS := EXECUTABLES
+
+LOCAL_SRC_FILES :=	\
+	bitcode_writer_bench.cpp	\
+	value_enumerator_2_9.cpp	\
+	value_enumerator_2_9_func.cpp	\
+	value_enumerator_3_2.cpp
+
+LOCAL_CFLAGS += $(local_cflags_for_slang)
+LOCAL_C_INCLUDES += frameworks/compile/slang
+
+LOCAL_STATIC_LIBRARIES :=	\
+	$(static_libraries_needed_by_slang)
+LOCAL_SHARED_LIBRARIES := \
+	libLLVM
+
+ifneq ($(HOST_OS),windows)
+  LOCAL_LDLIBS := -ldl -lpthread
+endif
+
+include $(LLVM_HOST_BUILD_MK)
+include $(LLVM_GEN_INTRINSICS_MK)
+include $(BUILD_HOST_EXECUTABLE)
+
+# Executable rs-profile-replay for host
+# ========================================================
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := rs-profile-replay
+LOCAL_MODULE_TAGS := optional
+ifneq ($(HOST_OS),windows)
+LOCAL_CLANG := true
+endif
+
+LOCAL_MODULE_CLASS := EXECUTABLES
+
+LOCAL_SRC_FILES :=	\
+	profile_replay.cpp
+
+LOCAL_CFLAGS += $(local_cflags_for_slang)
+LOCAL_C_INCLUDES += frameworks/compile/slang
+
+LOCAL_STATIC_LIBRARIES :=	\
+	libslang	\
+	libLLVMInterpreter	\
+	libLLVMExecutionEngine	\
+	$(static_libraries_needed_by_slang)
+LOCAL_SHARED_LIBRARIES := \
+	libLLVM
+
+ifneq ($(HOST_OS),windows)
+  LOCAL_LDLIBS := -ldl -lpthread
+endif
+
+include $(LLVM_HOST_BUILD_MK)
+include $(LLVM_GEN_INTRINSICS_MK)
+include $(BUILD_HOST_EXECUTABLE)
+
+# Executable rs-bitcode-index-check for host
+# ========================================================
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := rs-bitcode-index-check
+LOCAL_MODULE_TAGS := optional
+ifneq ($(HOST_OS),windows)
+LOCAL_CLANG := true
+endif
+
+LOCAL_MODULE_CLASS := EXECUTABLES
+
+LOCAL_SRC_FILES :=	\
+	bitcode_index_check.cpp
+
+LOCAL_CFLAGS += $(local_cflags_for_slang)
+LOCAL_C_INCLUDES += \
+	frameworks/compile/slang	\
+	frameworks/compile/libbcc/include
+
+LOCAL_STATIC_LIBRARIES :=	\
+	libslang	\
+	$(static_libraries_needed_by_slang)
+LOCAL_SHARED_LIBRARIES := \
+	libLLVM
+
+ifneq ($(HOST_OS),windows)
+  LOCAL_LDLIBS := -ldl -lpthread
+endif
+
+include $(LLVM_HOST_BUILD_MK)
+include $(LLVM_GEN_INTRINSICS_MK)
+include $(BUILD_HOST_EXECUTABLE)
+
+# Executable rs-compile-in-memory for host
+# ========================================================
+include $(CLEAR_VARS)
+include $(CLEAR_TBLGEN_VARS)
+
+CLANG_ROOT_PATH := external/clang
+include $(CLANG_ROOT_PATH)/clang.mk
+
+LOCAL_IS_HOST_MODULE := true
+LOCAL_MODULE := rs-compile-in-memory
+LOCAL_MODULE_TAGS := optional
+ifneq ($(HOST_OS),windows)
+LOCAL_CLANG := true
+endif
+
+LOCAL_MODULE_CLASS := EXECUTABLES
+
+TBLGEN_TABLES :=    \
+	AttrList.inc    \
+	Attrs.inc    \
+	CommentCommandList.inc \
+	CommentNodes.inc \
+	DeclNodes.inc    \
+	DiagnosticCommonKinds.inc   \
+	DiagnosticDriverKinds.inc	\
+	DiagnosticFrontendKinds.inc	\
+	DiagnosticSemaKinds.inc	\
+	StmtNodes.inc	\
+	RSCCOptions.inc
+
+LOCAL_SRC_FILES :=	\
+	compile_in_memory.cpp	\
+	$(addprefix ../,$(slang_rs_src_files))
+
+LOCAL_CFLAGS += $(local_cflags_for_slang)
+LOCAL_C_INCLUDES += frameworks/compile/slang
+
+LOCAL_STATIC_LIBRARIES :=	\
+	libslang	\
+	$(static_libraries_needed_by_slang)
+LOCAL_SHARED_LIBRARIES := \
+	libclang \
+	libLLVM
+
+ifneq ($(HOST_OS),windows)
+  LOCAL_LDLIBS := -ldl -lpthread
+endif
+
+# rs_cc_options.cpp includes RSCCOptions.inc.
+intermediates := $(call local-generated-sources-dir)
+LOCAL_GENERATED_SOURCES += $(intermediates)/RSCCOptions.inc
+$(intermediates)/RSCCOptions.inc: $(LOCAL_PATH)/../RSCCOptions.td $(LLVM_ROOT_PATH)/include/llvm/Option/OptParser.td $(LLVM_TBLGEN)
+	@echo "Building Renderscript compiler (rs-compile-in-memory) Option tables with tblgen"
+	$(call transform-host-td-to-out,opt-parser-defs)
+
+include $(CLANG_HOST_BUILD_MK)
+include $(CLANG_TBLGEN_RULES_MK)
+include $(BUILD_HOST_EXECUTABLE)
+
+endif  # TARGET_BUILD_APPS
@@ -0,0 +1,245 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+// Host-side check of the index appended to the bitcode by llvm-rs-cc
+// -bitcode-index, done the way a reader of the index would:
+//
+//   rs-bitcode-index-check <wrapped .bc>
+//
+// It checks that kWrapperFlag is set in the wrapper and that an index follows
+// the bitcode, then jumps to the offset of each entry: the blocks (including
+// the METADATA_BLOCK and every function body) must start there and span the
+// size recorded, and each #rs_export_* entry must be the METADATA_NAME record
+// of that named metadata. Every function defined and every #rs_export_*
+// named metadata of the module must be indexed. The entries checked are
+// printed on stdout.
+
+#include <cstring>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Bitcode/BitstreamReader.h"
+#include "llvm/Bitcode/LLVMBitCodes.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "bcinfo/BitcodeWrapper.h"
+
+#include "slang_bitcode_index.h"
+
+namespace {
+
+llvm::cl::opt<std::string>
+InputFilename(llvm::cl::Positional, llvm::cl::Required,
+              llvm::cl::desc("<bitcode built with -bitcode-index>"));
+
+typedef slang::BitcodeIndex::Entry Entry;
+
+// Check that a block starts at Ent.BitOffset of Stream and spans Ent.BitSize
+// bits.
+bool CheckBlock(llvm::BitstreamCursor &Stream, const Entry &Ent) {
+  Stream.JumpToBit(Ent.BitOffset);
+  if (Stream.SkipBlock())
+    return false;
+  return Stream.GetCurrentBitNo() == Ent.BitOffset + Ent.BitSize;
+}
+
+// Check that the named metadata Ent is the METADATA_NAME record at
+// Ent.BitOffset of the METADATA_BLOCK MetadataBlock. The block is read from
+// its start up to the record, for the abbrevs defined on the way.
+bool CheckNamedMetadata(llvm::BitstreamCursor &Stream,
+                        const Entry &MetadataBlock, const Entry &Ent) {
+  Stream.JumpToBit(MetadataBlock.BitOffset);
+  if (Stream.EnterSubBlock(llvm::bitc::METADATA_BLOCK_ID))
+    return false;
+
+  while (Stream.GetCurrentBitNo() < Ent.BitOffset) {
+    llvm::BitstreamEntry E = Stream.advance();
+    if (E.Kind == llvm::BitstreamEntry::Record) {
+      Stream.skipRecord(E.ID);
+    } else if ((E.Kind != llvm::BitstreamEntry::SubBlock) ||
+               Stream.SkipBlock()) {
+      return false;
+    }
+  }
+  if (Stream.GetCurrentBitNo() != Ent.BitOffset)
+    return false;
+
+  llvm::BitstreamEntry E = Stream.advance();
+  llvm::SmallVector<uint64_t, 64> Record;
+  if ((E.Kind != llvm::BitstreamEntry::Record) ||
+      (Stream.readRecord(E.ID, Record) != llvm::bitc::METADATA_NAME) ||
+      (std::string(Record.begin(), Record.end()) != Ent.Name))
+    return false;
+  return Stream.GetCurrentBitNo() == Ent.BitOffset + Ent.BitSize;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  llvm::sys::PrintStackTraceOnErrorSignal();
+  llvm::llvm_shutdown_obj Y;
+  llvm::cl::ParseCommandLineOptions(argc, argv,
+                                    "RenderScript bitcode index check\n");
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buffer =
+      llvm::MemoryBuffer::getFile(InputFilename);
+  if (Buffer.getError()) {
+    llvm::errs() << "error: unable to read '" << InputFilename << "'\n";
+    return 1;
+  }
+  llvm::StringRef File = Buffer.get()->getBuffer();
+
+  bcinfo::AndroidBitcodeWrapper Wrapper;
+  const unsigned char *Start =
+      reinterpret_cast<const unsigned char*>(File.data());
+  if ((File.size() < sizeof(Wrapper)) ||
+      !llvm::isBitcodeWrapper(Start, Start + File.size())) {
+    llvm::errs() << "error: '" << InputFilename << "' has no bitcode "
+                 << "wrapper\n";
+    return 1;
+  }
+  memcpy(&Wrapper, File.data(), sizeof(Wrapper));
+  if ((Wrapper.Version & slang::BitcodeIndex::kWrapperFlag) == 0) {
+    llvm::errs() << "error: the wrapper does not flag a bitcode index\n";
+    return 1;
+  }
+  if (File.size() < uint64_t(Wrapper.BitcodeOffset) + Wrapper.BitcodeSize) {
+    llvm::errs() << "error: the bitcode is truncated\n";
+    return 1;
+  }
+  llvm::StringRef Bitcode =
+      File.substr(Wrapper.BitcodeOffset, Wrapper.BitcodeSize);
+
+  slang::BitcodeIndex Index;
+  if (!Index.read(File.substr(Wrapper.BitcodeOffset + Wrapper.BitcodeSize))) {
+    llvm::errs() << "error: no valid index follows the bitcode\n";
+    return 1;
+  }
+
+  llvm::LLVMContext Context;
+  std::unique_ptr<llvm::MemoryBuffer> BitcodeBuffer(
+      llvm::MemoryBuffer::getMemBuffer(Bitcode, InputFilename, false));
+  llvm::ErrorOr<llvm::Module *> ModuleOrErr =
+      llvm::parseBitcodeFile(BitcodeBuffer.get(), Context);
+  if (ModuleOrErr.getError()) {
+    llvm::errs() << "error: unable to parse the bitcode: "
+                 << ModuleOrErr.getError().message() << "\n";
+    return 1;
+  }
+  std::unique_ptr<llvm::Module> M(ModuleOrErr.get());
+
+  const unsigned char *BitcodeStart =
+      reinterpret_cast<const unsigned char*>(Bitcode.data());
+  llvm::BitstreamReader Reader(BitcodeStart, BitcodeStart + Bitcode.size());
+  llvm::BitstreamCursor Stream(Reader);
+
+  const std::vector<Entry> &Entries = Index.getEntries();
+  const Entry *MetadataBlock = NULL;
+  for (unsigned i = 0, e = Entries.size(); i != e; i++) {
+    if ((Entries[i].Kind == slang::BitcodeIndex::EK_ModuleBlock) &&
+        (Entries[i].BlockID == llvm::bitc::METADATA_BLOCK_ID)) {
+      MetadataBlock = &Entries[i];
+    }
+  }
+
+  // <kind, name> of the entries checked, to find what is not indexed.
+  std::set<std::pair<int, std::string> > Indexed;
+  bool Failed = false;
+  for (unsigned i = 0, e = Entries.size(); i != e; i++) {
+    const Entry &Ent = Entries[i];
+    const char *What = NULL;
+    bool Valid = false;
+    switch (Ent.Kind) {
+      case slang::BitcodeIndex::EK_ModuleBlock: {
+        What = "module block";
+        Valid = CheckBlock(Stream, Ent);
+        break;
+      }
+      case slang::BitcodeIndex::EK_FunctionBlock: {
+        What = "function block";
+        const llvm::Function *F = M->getFunction(Ent.Name);
+        Valid = (Ent.BlockID == llvm::bitc::FUNCTION_BLOCK_ID) &&
+                (F != NULL) && !F->isDeclaration() && CheckBlock(Stream, Ent);
+        break;
+      }
+      case slang::BitcodeIndex::EK_NamedMetadata: {
+        What = "named metadata";
+        Valid = (MetadataBlock != NULL) &&
+                (M->getNamedMetadata(Ent.Name) != NULL) &&
+                CheckNamedMetadata(Stream, *MetadataBlock, Ent);
+        break;
+      }
+    }
+    Indexed.insert(std::make_pair(static_cast<int>(Ent.Kind), Ent.Name));
+
+    llvm::outs() << What << " '" << Ent.Name << "'";
+    if (!Valid) {
+      llvm::outs() << ": invalid";
+      Failed = true;
+    }
+    llvm::outs() << "\n";
+  }
+
+  if (MetadataBlock == NULL) {
+    llvm::errs() << "error: the METADATA_BLOCK is not indexed\n";
+    Failed = true;
+  }
+  for (llvm::Module::const_iterator I = M->begin(), E = M->end(); I != E;
+       ++I) {
+    if (!I->isDeclaration() &&
+        !Indexed.count(std::make_pair(
+            static_cast<int>(slang::BitcodeIndex::EK_FunctionBlock),
+            I->getName().str()))) {
+      llvm::errs() << "error: function '" << I->getName()
+                   << "' is not indexed\n";
+      Failed = true;
+    }
+  }
+  for (llvm::Module::const_named_metadata_iterator
+           I = M->named_metadata_begin(), E = M->named_metadata_end();
+       I != E; ++I) {
+    if (I->getName().startswith("#rs_export_") &&
+        !Indexed.count(std::make_pair(
+            static_cast<int>(slang::BitcodeIndex::EK_NamedMetadata),
+            I->getName().str()))) {
+      llvm::errs() << "error: named metadata '" << I->getName()
+                   << "' is not indexed\n";
+      Failed = true;
+    }
+  }
+
+  if (Failed)
+    return 1;
+  llvm::outs() << Entries.size() << " index entries verified\n";
+  return 0;
+}
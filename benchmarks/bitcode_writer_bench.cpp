@@ -0,0 +1,393 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Benchmark of the bitcode writers llvm-rs-cc picks from depending on the
+// target API (see Backend::HandleTranslationUnit()).
+//
+// Each module of the corpus (.ll or .bc files, e.g. the outputs of llvm-rs-cc
+// -emit-llvm, and synthetic modules built with -synthetic) is written
+// -iterations times by each writer. The results are printed as JSON:
+//
+//   {"label": "<-label>", "iterations": <n>, "results": [
+//     {"module": "<name>", "writer": "<BC29|BC29Func|BC32|BC32Serial|BC32Os>",
+//      "functions": <defined functions>, "bitcode_bytes": <size>,
+//      "size_vs_bc32": <bitcode_bytes / size written by BC32Serial>,
+//      "write_seconds": <mean>, "write_seconds_min": <min>,
+//      "enumerate_seconds": <mean ValueEnumerator construction>,
+//      "mb_per_second": <bitcode_bytes / write_seconds / 1e6>,
+//      "functions_per_second": <functions / write_seconds>}, ...]}
+//
+// BC32Os is the 3.2 writer with the size-optimized encoding of llvm-rs-cc
+// -Os-bitcode, so size_vs_bc32 reports what it saves on each module.
+// BC32Serial is the 3.2 writer encoding the function bodies on the calling
+// thread, whereas BC32 spreads them over the cores of the host. Their outputs
+// must be identical; the benchmark fails if they are not.
+//
+// See run_bitcode_writer_bench.sh to run it on the scripts of tests/.
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/Twine.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "BitWriter_2_9/ReaderWriter_2_9.h"
+#include "BitWriter_2_9_func/ReaderWriter_2_9_func.h"
+#include "BitWriter_3_2/ReaderWriter_3_2.h"
+
+#include "bitcode_writer_bench.h"
+
+namespace {
+
+enum BCVersion {
+  BC29, BC29Func, BC32, BC32Serial, BC32Os
+};
+
+llvm::cl::list<std::string>
+InputFilenames(llvm::cl::Positional, llvm::cl::ZeroOrMore,
+               llvm::cl::desc("<input .ll/.bc files>"));
+
+llvm::cl::list<unsigned>
+SyntheticFunctions("synthetic", llvm::cl::ZeroOrMore,
+                   llvm::cl::value_desc("functions"),
+                   llvm::cl::desc("Also benchmark a synthetic module with "
+                                  "that many functions (may be repeated)"));
+
+llvm::cl::opt<unsigned>
+ConstantsPerFunction("constants-per-function", llvm::cl::init(16),
+                     llvm::cl::desc("Size of the constant table of each "
+                                    "synthetic function"));
+
+llvm::cl::opt<unsigned>
+MetadataPerFunction("metadata-per-function", llvm::cl::init(4),
+                    llvm::cl::desc("Number of metadata nodes describing each "
+                                   "synthetic function"));
+
+llvm::cl::list<BCVersion>
+Writers("writer", llvm::cl::ZeroOrMore,
+        llvm::cl::desc("Bitcode writer to benchmark (all by default):"),
+        llvm::cl::values(
+            clEnumValN(BC29, "BC29", "Version 2.9"),
+            clEnumValN(BC29Func, "BC29Func", "Version 2.9 func"),
+            clEnumValN(BC32, "BC32", "Version 3.2"),
+            clEnumValN(BC32Serial, "BC32Serial",
+                       "Version 3.2, single-threaded"),
+            clEnumValN(BC32Os, "BC32Os", "Version 3.2, size-optimized"),
+            clEnumValEnd));
+
+llvm::cl::opt<unsigned>
+Iterations("iterations", llvm::cl::init(10),
+           llvm::cl::desc("Number of times each module is written"));
+
+llvm::cl::opt<std::string>
+Label("label", llvm::cl::init(""),
+      llvm::cl::desc("Recorded with the results (e.g. the commit measured)"));
+
+llvm::cl::opt<std::string>
+OutputFilename("o", llvm::cl::init("-"), llvm::cl::value_desc("filename"),
+               llvm::cl::desc("Write the results to <filename>"));
+
+struct Writer {
+  const char *Name;
+  void (*Write)(const llvm::Module *M, llvm::raw_ostream &Out);
+  void (*Enumerate)(const llvm::Module *M);
+};
+
+void WriteBitcode_3_2_Serial(const llvm::Module *M, llvm::raw_ostream &Out) {
+  llvm_3_2::WriteBitcodeToFile(M, Out, /* OptimizeForSize = */false,
+                               /* NumThreads = */1);
+}
+
+void WriteBitcode_3_2_Os(const llvm::Module *M, llvm::raw_ostream &Out) {
+  llvm_3_2::WriteBitcodeToFile(M, Out, /* OptimizeForSize = */true);
+}
+
+const Writer AllWriters[] = {
+  { "BC29", llvm_2_9::WriteBitcodeToFile, slang_bench::EnumerateValues_2_9 },
+  { "BC29Func", llvm_2_9_func::WriteBitcodeToFile,
+    slang_bench::EnumerateValues_2_9_func },
+  { "BC32", llvm_3_2::WriteBitcodeToFile, slang_bench::EnumerateValues_3_2 },
+  { "BC32Serial", WriteBitcode_3_2_Serial,
+    slang_bench::EnumerateValues_3_2 },
+  { "BC32Os", WriteBitcode_3_2_Os, slang_bench::EnumerateValues_3_2 },
+};
+
+double GetWallTime() {
+  return llvm::TimeRecord::getCurrentTime(true).getWallTime();
+}
+
+// Load the .ll or .bc file Path. Returns NULL (after printing why) on error.
+llvm::Module *LoadModule(const std::string &Path, llvm::LLVMContext &Context) {
+  if (llvm::sys::path::extension(Path) == ".ll") {
+    llvm::SMDiagnostic Err;
+    std::unique_ptr<llvm::Module> M(
+        llvm::ParseAssemblyFile(Path, Err, Context));
+    if (M.get() == NULL)
+      Err.print("bitcode-writer-bench", llvm::errs());
+    return M.release();
+  }
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buffer =
+      llvm::MemoryBuffer::getFile(Path);
+  if (Buffer.getError()) {
+    llvm::errs() << "error: unable to read '" << Path << "'\n";
+    return NULL;
+  }
+  llvm::ErrorOr<llvm::Module *> M =
+      llvm::parseBitcodeFile(Buffer.get().get(), Context);
+  if (M.getError()) {
+    llvm::errs() << "error: unable to parse '" << Path << "': "
+                 << M.getError().message() << "\n";
+    return NULL;
+  }
+  return M.get();
+}
+
+// Build a module of NumFunctions functions, each of them reading a table of
+// ConstantsPerFunction constants, calling the previous one, and described by
+// MetadataPerFunction nodes of named metadata.
+llvm::Module *CreateSyntheticModule(llvm::LLVMContext &Context,
+                                    unsigned NumFunctions) {
+  llvm::Module *M = new llvm::Module(
+      "synthetic-" + llvm::Twine(NumFunctions), Context);
+  M->setTargetTriple("armv7-none-linux-gnueabi");
+
+  llvm::Type *FloatTy = llvm::Type::getFloatTy(Context);
+  llvm::Type *Int32Ty = llvm::Type::getInt32Ty(Context);
+  llvm::Type *ParamTys[] = { FloatTy, Int32Ty };
+  llvm::FunctionType *FuncTy =
+      llvm::FunctionType::get(FloatTy, ParamTys, /* isVarArg = */false);
+  unsigned TableSize = std::max(ConstantsPerFunction.getValue(), 1U);
+  llvm::ArrayType *TableTy = llvm::ArrayType::get(FloatTy, TableSize);
+  llvm::NamedMDNode *Metadata =
+      M->getOrInsertNamedMetadata("bench.functions");
+
+  llvm::Function *Previous = NULL;
+  for (unsigned f = 0; f < NumFunctions; f++) {
+    std::vector<llvm::Constant*> Elements;
+    for (unsigned c = 0; c < TableSize; c++) {
+      Elements.push_back(
+          llvm::ConstantFP::get(FloatTy, f * TableSize + c + 0.5));
+    }
+    llvm::GlobalVariable *Table = new llvm::GlobalVariable(
+        *M, TableTy, /* isConstant = */true,
+        llvm::GlobalValue::InternalLinkage,
+        llvm::ConstantArray::get(TableTy, Elements),
+        "table" + llvm::Twine(f));
+
+    llvm::Function *F = llvm::Function::Create(
+        FuncTy, llvm::GlobalValue::ExternalLinkage, "func" + llvm::Twine(f),
+        M);
+    llvm::Function::arg_iterator Args = F->arg_begin();
+    llvm::Value *X = Args++;
+    llvm::Value *Index = Args++;
+
+    llvm::IRBuilder<> Builder(llvm::BasicBlock::Create(Context, "entry", F));
+    llvm::Value *Indices[] = {
+      Builder.getInt32(0),
+      Builder.CreateURem(Index, Builder.getInt32(TableSize))
+    };
+    llvm::Value *Result = Builder.CreateFMul(
+        X, Builder.CreateLoad(Builder.CreateInBoundsGEP(Table, Indices)));
+    if (Previous != NULL) {
+      Result = Builder.CreateFAdd(
+          Result, Builder.CreateCall2(Previous, Result, Index));
+    }
+    Builder.CreateRet(Result);
+
+    for (unsigned m = 0; m < MetadataPerFunction; m++) {
+      llvm::Value *Operands[] = {
+        llvm::MDString::get(Context, ("func" + llvm::Twine(f) + ".md" +
+                                      llvm::Twine(m)).str()),
+        Builder.getInt32(m),
+        F
+      };
+      Metadata->addOperand(llvm::MDNode::get(Context, Operands));
+    }
+
+    Previous = F;
+  }
+
+  return M;
+}
+
+unsigned CountDefinedFunctions(const llvm::Module &M) {
+  unsigned Count = 0;
+  for (llvm::Module::const_iterator I = M.begin(), E = M.end(); I != E; I++) {
+    if (!I->isDeclaration())
+      Count++;
+  }
+  return Count;
+}
+
+// Benchmark W on M, and print the result as a JSON object to OS. Returns false
+// if W is BC32 and did not write the same bitcode as BC32Serial.
+bool RunBenchmark(const std::string &Name, const llvm::Module &M,
+                  const Writer &W, llvm::raw_ostream &OS) {
+  std::string Bitcode;
+  double WriteTotal = 0;
+  double WriteMin = std::numeric_limits<double>::max();
+  double EnumerateTotal = 0;
+
+  for (unsigned i = 0; i < Iterations; i++) {
+    Bitcode.clear();
+    llvm::raw_string_ostream BitcodeOS(Bitcode);
+    double Start = GetWallTime();
+    W.Write(&M, BitcodeOS);
+    BitcodeOS.flush();
+    double Elapsed = GetWallTime() - Start;
+    WriteTotal += Elapsed;
+    WriteMin = std::min(WriteMin, Elapsed);
+
+    Start = GetWallTime();
+    W.Enumerate(&M);
+    EnumerateTotal += GetWallTime() - Start;
+  }
+
+  // The size of the default encoding, which the others are compared to.
+  std::string BC32Bitcode;
+  {
+    llvm::raw_string_ostream BC32OS(BC32Bitcode);
+    WriteBitcode_3_2_Serial(&M, BC32OS);
+  }
+
+  bool Identical = true;
+  if (strcmp(W.Name, "BC32") == 0 && Bitcode != BC32Bitcode) {
+    llvm::errs() << "error: BC32 and BC32Serial wrote different bitcode for '"
+                 << Name << "'\n";
+    Identical = false;
+  }
+
+  unsigned Functions = CountDefinedFunctions(M);
+  double WriteMean = WriteTotal / Iterations;
+  double EnumerateMean = EnumerateTotal / Iterations;
+  double MBPerSecond =
+      (WriteMean > 0) ? (Bitcode.size() / WriteMean / 1e6) : 0;
+  double FunctionsPerSecond = (WriteMean > 0) ? (Functions / WriteMean) : 0;
+  double SizeVsBC32 = static_cast<double>(Bitcode.size()) / BC32Bitcode.size();
+
+  OS << "    {\"module\": \"";
+  OS.write_escaped(Name);
+  OS << "\", \"writer\": \"" << W.Name << "\", "
+     << "\"functions\": " << Functions << ", "
+     << "\"bitcode_bytes\": " << Bitcode.size() << ", "
+     << "\"size_vs_bc32\": " << llvm::format("%.4f", SizeVsBC32) << ", "
+     << "\"write_seconds\": " << llvm::format("%.6f", WriteMean) << ", "
+     << "\"write_seconds_min\": " << llvm::format("%.6f", WriteMin) << ", "
+     << "\"enumerate_seconds\": " << llvm::format("%.6f", EnumerateMean)
+     << ", "
+     << "\"mb_per_second\": " << llvm::format("%.3f", MBPerSecond) << ", "
+     << "\"functions_per_second\": "
+     << llvm::format("%.1f", FunctionsPerSecond) << "}";
+  return Identical;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  llvm::sys::PrintStackTraceOnErrorSignal();
+  llvm::llvm_shutdown_obj Y;
+  llvm::cl::ParseCommandLineOptions(argc, argv,
+                                    "RenderScript bitcode writer benchmark\n");
+
+  if (InputFilenames.empty() && SyntheticFunctions.empty()) {
+    llvm::errs() << "error: no input files nor -synthetic modules\n";
+    return 1;
+  }
+  if (Iterations == 0)
+    Iterations = 1;
+
+  std::vector<const Writer*> SelectedWriters;
+  for (unsigned i = 0; i < sizeof(AllWriters) / sizeof(AllWriters[0]); i++) {
+    bool Selected = Writers.empty();
+    for (unsigned j = 0, e = Writers.size(); j != e; j++)
+      Selected |= (static_cast<unsigned>(Writers[j]) == i);
+    if (Selected)
+      SelectedWriters.push_back(&AllWriters[i]);
+  }
+
+  std::string ErrorInfo;
+  llvm::raw_fd_ostream OS(OutputFilename.c_str(), ErrorInfo,
+                          llvm::sys::fs::F_Text);
+  if (!ErrorInfo.empty()) {
+    llvm::errs() << "error: " << ErrorInfo << "\n";
+    return 1;
+  }
+
+  OS << "{\"label\": \"";
+  OS.write_escaped(Label);
+  OS << "\", \"iterations\": " << Iterations << ", \"results\": [\n";
+
+  bool First = true;
+  int Status = 0;
+  unsigned NumModules = InputFilenames.size() + SyntheticFunctions.size();
+  for (unsigned i = 0; i < NumModules; i++) {
+    // Each module gets a context of its own, so that their types and
+    // constants don't pile up.
+    llvm::LLVMContext Context;
+    std::unique_ptr<llvm::Module> M;
+    std::string Name;
+    if (i < InputFilenames.size()) {
+      Name = InputFilenames[i];
+      M.reset(LoadModule(Name, Context));
+    } else {
+      unsigned NumFunctions = SyntheticFunctions[i - InputFilenames.size()];
+      M.reset(CreateSyntheticModule(Context, NumFunctions));
+      Name = M->getModuleIdentifier();
+    }
+
+    if (M.get() == NULL) {
+      Status = 1;
+      continue;
+    }
+
+    for (unsigned w = 0, e = SelectedWriters.size(); w != e; w++) {
+      if (!First)
+        OS << ",\n";
+      First = false;
+      if (!RunBenchmark(Name, *M, *SelectedWriters[w], OS))
+        Status = 1;
+    }
+  }
+
+  OS << "\n]}\n";
+  return Status;
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_BENCHMARKS_BITCODE_WRITER_BENCH_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_BENCHMARKS_BITCODE_WRITER_BENCH_H_
+
+namespace llvm {
+  class Module;
+}
+
+namespace slang_bench {
+
+// Number the values of M the way the bitcode writer of each version does
+// before writing it out. They are defined in a file of their own each, as the
+// ValueEnumerator.h of the writers share the same include guard.
+void EnumerateValues_2_9(const llvm::Module *M);
+void EnumerateValues_2_9_func(const llvm::Module *M);
+void EnumerateValues_3_2(const llvm::Module *M);
+
+}  // namespace slang_bench
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_BENCHMARKS_BITCODE_WRITER_BENCH_H_  NOLINT
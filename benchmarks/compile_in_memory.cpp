@@ -0,0 +1,144 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+// Host-side driver of SlangRS::CompileInMemory(), the entry point of the
+// tools embedding the compiler:
+//
+//   rs-compile-in-memory [-header <path>=<file>]... <llvm-rs-cc options>
+//                        <input.rs> < <source>
+//
+// The script is compiled as <input.rs> (which need not exist) from the
+// source read on stdin. Each -header makes the contents of <file> visible as
+// <path> to the #includes of the script only. The other options are the ones
+// of llvm-rs-cc, for a single input.
+//
+// Once the compilation is done, the path and size of each output kept in
+// memory are printed on stdout, then the outputs are written to the
+// filesystem so that they can be checked. The diagnostics go to stderr.
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/DiagnosticIDs.h"
+#include "clang/Basic/DiagnosticOptions.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "rs_cc_options.h"
+#include "slang_diagnostic_buffer.h"
+#include "slang_output_sink.h"
+#include "slang_rs.h"
+
+namespace {
+
+// Read the file File into Contents.
+bool ReadFile(const std::string &File, std::string *Contents) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > Buffer =
+      llvm::MemoryBuffer::getFile(File);
+  if (Buffer.getError())
+    return false;
+  *Contents = Buffer.get()->getBuffer().str();
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, const char **argv) {
+  llvm::sys::PrintStackTraceOnErrorSignal();
+  llvm::llvm_shutdown_obj Y;
+
+  // Take the -header options out of the llvm-rs-cc ones.
+  slang::SlangRS::VirtualFileList Headers;
+  llvm::SmallVector<const char*, 16> ArgVector;
+  ArgVector.push_back(argv[0]);
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-header") != 0) {
+      ArgVector.push_back(argv[i]);
+      continue;
+    }
+    llvm::StringRef Header = (i + 1 < argc) ? argv[++i] : "";
+    std::pair<llvm::StringRef, llvm::StringRef> PathAndFile =
+        Header.split('=');
+    std::string Contents;
+    if (PathAndFile.first.empty() || PathAndFile.second.empty() ||
+        !ReadFile(PathAndFile.second, &Contents)) {
+      llvm::errs() << "error: invalid -header '" << Header << "'\n";
+      return 1;
+    }
+    Headers.push_back(std::make_pair(PathAndFile.first.str(), Contents));
+  }
+
+  slang::DiagnosticBuffer *DiagClient = new slang::DiagnosticBuffer();
+  llvm::IntrusiveRefCntPtr<clang::DiagnosticIDs> DiagIDs(
+      new clang::DiagnosticIDs());
+  llvm::IntrusiveRefCntPtr<clang::DiagnosticOptions> DiagOpts(
+      new clang::DiagnosticOptions());
+  clang::DiagnosticsEngine DiagEngine(DiagIDs, &*DiagOpts, DiagClient, true);
+
+  slang::RSCCOptions Opts;
+  llvm::SmallVector<const char*, 16> Inputs;
+  slang::ParseArguments(ArgVector, Inputs, Opts, DiagEngine);
+  if (DiagEngine.hasErrorOccurred()) {
+    llvm::errs() << DiagClient->str();
+    return 1;
+  }
+  if (Inputs.size() != 1) {
+    llvm::errs() << "error: expected a single input file\n";
+    return 1;
+  }
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > Source =
+      llvm::MemoryBuffer::getSTDIN();
+  if (Source.getError()) {
+    llvm::errs() << "error: unable to read the source from stdin\n";
+    return 1;
+  }
+
+  slang::MemoryOutputSink Outputs;
+  std::string Diagnostics;
+  bool Success = slang::SlangRS::CompileInMemory(
+      Inputs[0], Source.get()->getBuffer(), Opts, &Outputs, &Diagnostics,
+      Headers.empty() ? NULL : &Headers);
+  llvm::errs() << Diagnostics;
+
+  const slang::MemoryOutputSink::FileList &Files = Outputs.getFiles();
+  for (unsigned i = 0, e = Files.size(); i != e; i++) {
+    llvm::outs() << "output " << Files[i].first << " ("
+                 << Files[i].second.size() << " bytes)\n";
+  }
+  slang::OutputSink *FileSystem = slang::OutputSink::getFileSystemSink();
+  for (unsigned i = 0, e = Files.size(); i != e; i++) {
+    std::string Error;
+    if (!FileSystem->writeFile(Files[i].first, Files[i].second, &Error)) {
+      llvm::errs() << "error: unable to write '" << Files[i].first << "': "
+                   << Error << "\n";
+      Success = false;
+    }
+  }
+
+  return Success ? 0 : 1;
+}
@@ -0,0 +1,323 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+// Host-side replay of a forEach kernel of a script built with llvm-rs-cc
+// -fprofile-generate, to produce the profile of -fprofile-use without a
+// device.
+//
+//   rs-profile-replay <script .ll/.bc> -kernel <name> -input <file>
+//                     [-element-count <n>] [-o <profile>]
+//
+// The kernel is run by the LLVM interpreter once for each cell of a 1D
+// allocation, whose elements are read from -input (the raw bytes of an
+// allocation of the kernel's input type, as the script sees them). init() is
+// run first if the script has one. The counts are then added to the profile
+// -o, which is created if it does not exist.
+//
+// The interpreter lays out the memory of the script as the host does, so use
+// the bitcode built for the pointer size of the host (e.g. the bc64 output of
+// -target-api 21 and up on a 64-bit host). The usrData parameter is NULL and
+// the functions of the RenderScript runtime are not available: it is only
+// meant for the kernels doing their own arithmetic.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/ExecutionEngine/Interpreter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "slang_profile.h"
+#include "slang_rs_metadata.h"
+
+namespace {
+
+// The bits of the #rs_export_foreach signatures (see
+// RSExportForEach::setSignatureMetadata()).
+enum {
+  SIG_In = 0x01,
+  SIG_Out = 0x02,
+  SIG_UsrData = 0x04,
+  SIG_X = 0x08,
+  SIG_Y = 0x10,
+  SIG_Kernel = 0x20
+};
+
+llvm::cl::opt<std::string>
+InputModule(llvm::cl::Positional, llvm::cl::Required,
+            llvm::cl::desc("<script .ll/.bc built with -fprofile-generate>"));
+
+llvm::cl::opt<std::string>
+KernelName("kernel", llvm::cl::init("root"),
+           llvm::cl::desc("The forEach kernel to run (root by default)"));
+
+llvm::cl::opt<std::string>
+InputFilename("input", llvm::cl::value_desc("filename"),
+              llvm::cl::desc("The elements of the input allocation"));
+
+llvm::cl::opt<unsigned>
+ElementCount("element-count", llvm::cl::init(0),
+             llvm::cl::desc("Number of cells to run the kernel on (as many as "
+                            "there are elements in -input by default)"));
+
+llvm::cl::opt<std::string>
+OutputFilename("o", llvm::cl::init("default.rsprof"),
+               llvm::cl::value_desc("filename"),
+               llvm::cl::desc("The profile to add the counts to"));
+
+// Load the .ll or .bc file Path. Returns NULL (after printing why) on error.
+llvm::Module *LoadModule(const std::string &Path, llvm::LLVMContext &Context) {
+  if (llvm::sys::path::extension(Path) == ".ll") {
+    llvm::SMDiagnostic Err;
+    std::unique_ptr<llvm::Module> M(
+        llvm::ParseAssemblyFile(Path, Err, Context));
+    if (M.get() == NULL)
+      Err.print("rs-profile-replay", llvm::errs());
+    return M.release();
+  }
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buffer =
+      llvm::MemoryBuffer::getFile(Path);
+  if (Buffer.getError()) {
+    llvm::errs() << "error: unable to read '" << Path << "'\n";
+    return NULL;
+  }
+  llvm::ErrorOr<llvm::Module *> M =
+      llvm::parseBitcodeFile(Buffer.get().get(), Context);
+  if (M.getError()) {
+    llvm::errs() << "error: unable to parse '" << Path << "': "
+                 << M.getError().message() << "\n";
+    return NULL;
+  }
+  return M.get();
+}
+
+// Returns the #rs_export_foreach signature of the kernel Name, or -1 if M
+// does not export it.
+int GetForEachSignature(const llvm::Module &M, llvm::StringRef Name) {
+  const llvm::NamedMDNode *Names =
+      M.getNamedMetadata(RS_EXPORT_FOREACH_NAME_MN);
+  const llvm::NamedMDNode *Signatures =
+      M.getNamedMetadata(RS_EXPORT_FOREACH_MN);
+  if ((Names == NULL) || (Signatures == NULL))
+    return -1;
+
+  for (unsigned i = 0, e = Names->getNumOperands(); i != e; i++) {
+    llvm::MDString *KernelName =
+        llvm::dyn_cast<llvm::MDString>(Names->getOperand(i)->getOperand(0));
+    if ((KernelName == NULL) || (KernelName->getString() != Name))
+      continue;
+    llvm::MDString *Signature = llvm::dyn_cast<llvm::MDString>(
+        Signatures->getOperand(i)->getOperand(0));
+    unsigned Value;
+    if ((Signature == NULL) || Signature->getString().getAsInteger(10, Value))
+      return -1;
+    return Value;
+  }
+  return -1;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  llvm::sys::PrintStackTraceOnErrorSignal();
+  llvm::llvm_shutdown_obj Y;
+  llvm::cl::ParseCommandLineOptions(argc, argv,
+                                    "RenderScript profile replay\n");
+
+  llvm::LLVMContext Context;
+  llvm::Module *M = LoadModule(InputModule, Context);
+  if (M == NULL)
+    return 1;
+
+  llvm::GlobalVariable *Counters =
+      M->getGlobalVariable(slang::Profile::kCountersName, true);
+  llvm::GlobalVariable *Layout =
+      M->getGlobalVariable(slang::Profile::kLayoutName, true);
+  if ((Counters == NULL) || (Layout == NULL)) {
+    llvm::errs() << "error: '" << InputModule << "' was not built with "
+                 << "-fprofile-generate\n";
+    return 1;
+  }
+
+  int Signature = GetForEachSignature(*M, KernelName);
+  llvm::Function *Kernel = M->getFunction(KernelName);
+  if ((Signature < 0) || (Kernel == NULL) || Kernel->isDeclaration()) {
+    llvm::errs() << "error: '" << InputModule << "' exports no forEach "
+                 << "kernel '" << KernelName << "'\n";
+    return 1;
+  }
+
+  // The element types of the input and output allocations.
+  bool IsKernelStyle = (Signature & SIG_Kernel) != 0;
+  llvm::FunctionType *KernelTy = Kernel->getFunctionType();
+  llvm::Type *InTy = NULL;
+  llvm::Type *OutTy = NULL;
+  unsigned Param = 0;
+  if (Signature & SIG_In) {
+    InTy = KernelTy->getParamType(Param++);
+    if (!IsKernelStyle)
+      InTy = InTy->getPointerElementType();
+  }
+  if (IsKernelStyle) {
+    if (Signature & SIG_Out)
+      OutTy = KernelTy->getReturnType();
+  } else if (Signature & SIG_Out) {
+    OutTy = KernelTy->getParamType(Param++)->getPointerElementType();
+  }
+
+  std::string Error;
+  // The engine takes ownership of M.
+  std::unique_ptr<llvm::ExecutionEngine> EE(
+      llvm::EngineBuilder(M)
+          .setEngineKind(llvm::EngineKind::Interpreter)
+          .setErrorStr(&Error)
+          .create());
+  if (EE.get() == NULL) {
+    llvm::errs() << "error: unable to create the interpreter: " << Error
+                 << "\n";
+    return 1;
+  }
+  const llvm::DataLayout *DL = EE->getDataLayout();
+  if (DL->getPointerSize() != sizeof(void*)) {
+    llvm::errs() << "warning: the pointers of '" << InputModule << "' are "
+                 << DL->getPointerSize() << " bytes, not "
+                 << sizeof(void*) << " as on the host\n";
+  }
+
+  // Read the input allocation.
+  std::vector<char> InData;
+  uint64_t InSize = (InTy != NULL) ? DL->getTypeAllocSize(InTy) : 0;
+  if (InTy != NULL) {
+    if (InputFilename.empty()) {
+      llvm::errs() << "error: kernel '" << KernelName << "' needs an -input\n";
+      return 1;
+    }
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buffer =
+        llvm::MemoryBuffer::getFile(InputFilename);
+    if (Buffer.getError()) {
+      llvm::errs() << "error: unable to read '" << InputFilename << "'\n";
+      return 1;
+    }
+    llvm::StringRef Bytes = Buffer.get()->getBuffer();
+    InData.assign(Bytes.begin(), Bytes.end());
+    if (ElementCount == 0)
+      ElementCount = InData.size() / InSize;
+    if (InData.size() < ElementCount * InSize) {
+      llvm::errs() << "error: '" << InputFilename << "' holds less than "
+                   << ElementCount << " elements\n";
+      return 1;
+    }
+  }
+  if (ElementCount == 0) {
+    llvm::errs() << "error: no cells to run kernel '" << KernelName
+                 << "' on (see -element-count)\n";
+    return 1;
+  }
+  uint64_t OutSize = (OutTy != NULL) ? DL->getTypeAllocSize(OutTy) : 0;
+  std::vector<char> OutData(ElementCount * OutSize + 1);
+
+  llvm::Function *Init = M->getFunction("init");
+  if ((Init != NULL) && !Init->isDeclaration())
+    EE->runFunction(Init, std::vector<llvm::GenericValue>());
+
+  for (unsigned x = 0; x < ElementCount; x++) {
+    std::vector<llvm::GenericValue> Args;
+    char *In = InTy ? &InData[x * InSize] : NULL;
+    char *Out = OutTy ? &OutData[x * OutSize] : NULL;
+
+    if (IsKernelStyle) {
+      if (InTy != NULL) {
+        llvm::GenericValue InValue;
+        EE->LoadValueFromMemory(
+            InValue, reinterpret_cast<llvm::GenericValue*>(In), InTy);
+        Args.push_back(InValue);
+      }
+    } else {
+      if (Signature & SIG_In)
+        Args.push_back(llvm::GenericValue(In));
+      if (Signature & SIG_Out)
+        Args.push_back(llvm::GenericValue(Out));
+      if (Signature & SIG_UsrData)
+        Args.push_back(llvm::GenericValue(static_cast<void*>(NULL)));
+    }
+    if (Signature & SIG_X) {
+      llvm::GenericValue X;
+      X.IntVal = llvm::APInt(32, x);
+      Args.push_back(X);
+    }
+    if (Signature & SIG_Y) {
+      llvm::GenericValue Y;
+      Y.IntVal = llvm::APInt(32, 0);
+      Args.push_back(Y);
+    }
+
+    llvm::GenericValue Result = EE->runFunction(Kernel, Args);
+    if (IsKernelStyle && (OutTy != NULL)) {
+      EE->StoreValueToMemory(
+          Result, reinterpret_cast<llvm::GenericValue*>(Out), OutTy);
+    }
+  }
+
+  // Add the counts to the profile.
+  slang::Profile Profile;
+  if (llvm::sys::fs::exists(OutputFilename) &&
+      !Profile.read(OutputFilename, &Error)) {
+    llvm::errs() << "error: " << Error << "\n";
+    return 1;
+  }
+  llvm::ConstantDataSequential *LayoutInit =
+      llvm::cast<llvm::ConstantDataSequential>(Layout->getInitializer());
+  const uint64_t *CounterValues = static_cast<const uint64_t*>(
+      EE->getPointerToGlobal(Counters));
+  if (!Profile.addCounts(LayoutInit->getAsCString(), CounterValues, &Error)) {
+    llvm::errs() << "error: " << OutputFilename << ": " << Error << "\n";
+    return 1;
+  }
+
+  std::string ErrorInfo;
+  llvm::raw_fd_ostream OS(OutputFilename.c_str(), ErrorInfo,
+                          llvm::sys::fs::F_Text);
+  if (!ErrorInfo.empty()) {
+    llvm::errs() << "error: " << ErrorInfo << "\n";
+    return 1;
+  }
+  Profile.write(OS);
+  return 0;
+}
@@ -0,0 +1,30 @@
+#!/bin/bash -e
+
+# Benchmark the bitcode writers on the scripts of tests/P_* and on synthetic
+# modules. Run from this directory, after a host build of llvm-rs-cc and
+# bitcode-writer-bench.
+# Usage: run_bitcode_writer_bench.sh <results.json> [<bitcode-writer-bench args>]
+#
+# e.g. run_bitcode_writer_bench.sh bench.json -label=$(git rev-parse HEAD)
+
+RESULTS=$1
+shift
+
+ANDROID_ROOT=../../../..
+HOST_BIN=$ANDROID_ROOT/out/host/linux-x86/bin
+
+CORPUS=`mktemp -d`
+trap "rm -rf $CORPUS" EXIT
+
+# The scripts needing extra options are skipped.
+for rs in ../tests/P_*/*.rs; do
+  OUT=$CORPUS/`basename \`dirname $rs\``
+  $HOST_BIN/llvm-rs-cc -emit-llvm -o $OUT -p $OUT/java \
+      -I $ANDROID_ROOT/frameworks/rs/scriptc \
+      -I $ANDROID_ROOT/external/clang/lib/Headers \
+      $rs > /dev/null 2>&1 || true
+done
+
+$HOST_BIN/bitcode-writer-bench -o $RESULTS \
+    -synthetic=100 -synthetic=1000 -synthetic=10000 \
+    "$@" `find $CORPUS -name '*.ll' | sort`
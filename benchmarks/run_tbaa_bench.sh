@@ -0,0 +1,74 @@
+#!/bin/bash -e
+
+# Compare the optimized IR of the scripts of tests/P_* with and without the
+# struct-path TBAA of llvm-rs-cc (-no-struct-path-tbaa). Run from this
+# directory, after a host build of llvm-rs-cc.
+# Usage: run_tbaa_bench.sh <results.json> [<llvm-rs-cc args>]
+#
+# The results are printed as JSON, with the number of instructions, loads,
+# stores and instructions on vectors of the functions defined in each script:
+#
+#   {"results": [
+#     {"script": "<path>",
+#      "before": {"instructions": <n>, "loads": <n>, "stores": <n>,
+#                 "vector_instructions": <n>},
+#      "after": {...}}, ...]}
+#
+# "before" is compiled with -no-struct-path-tbaa, "after" without. The scripts
+# which do not compile (e.g. needing extra options) are skipped.
+
+RESULTS=$1
+shift
+
+ANDROID_ROOT=../../../..
+HOST_BIN=$ANDROID_ROOT/out/host/linux-x86/bin
+
+WORK=`mktemp -d`
+trap "rm -rf $WORK" EXIT
+
+# Print the statistics of the .ll file $1 as a JSON object.
+function ir_stats() {
+  awk '
+    /^define / { in_function = 1; next }
+    /^}/ { in_function = 0; next }
+    in_function && /^  [^ ;]/ {
+      instructions++
+      if ($0 ~ /(^  |= )load /) loads++
+      if ($0 ~ /^  store /) stores++
+      if ($0 ~ /<[0-9]+ x /) vectors++
+    }
+    END {
+      printf "{\"instructions\": %d, \"loads\": %d, \"stores\": %d, ", \
+             instructions, loads, stores
+      printf "\"vector_instructions\": %d}", vectors
+    }' $1
+}
+
+# Compile $1 to $2/<name>.ll with the remaining arguments.
+function compile() {
+  local rs=$1 out=$2
+  shift 2
+  $HOST_BIN/llvm-rs-cc -emit-llvm -o $out -p $out/java \
+      -I $ANDROID_ROOT/frameworks/rs/scriptc \
+      -I $ANDROID_ROOT/external/clang/lib/Headers \
+      "$@" $rs > /dev/null 2>&1
+}
+
+FIRST=1
+echo '{"results": [' > $RESULTS
+for rs in ../tests/P_*/*.rs; do
+  OUT=$WORK/`basename \`dirname $rs\``
+  compile $rs $OUT/before -no-struct-path-tbaa "$@" || continue
+  compile $rs $OUT/after "$@" || continue
+  BEFORE=`ls $OUT/before/*.ll | head -1`
+  AFTER=`ls $OUT/after/*.ll | head -1`
+
+  if [ $FIRST -eq 0 ]; then
+    echo ',' >> $RESULTS
+  fi
+  FIRST=0
+  echo -n "  {\"script\": \"$rs\", \"before\": `ir_stats $BEFORE`, " >> $RESULTS
+  echo -n "\"after\": `ir_stats $AFTER`}" >> $RESULTS
+done
+echo '' >> $RESULTS
+echo ']}' >> $RESULTS
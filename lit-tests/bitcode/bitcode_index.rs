@@ -0,0 +1,30 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: %Slang -target-api 19 -emit-bc -bitcode-index -o %t %s
+// RUN: %rs-bitcode-index-check %t/bitcode_index.bc | %FileCheck %s
+// CHECK-DAG: module block 'METADATA_BLOCK'
+// CHECK-DAG: named metadata '#rs_export_var'
+// CHECK-DAG: named metadata '#rs_export_func'
+// CHECK-DAG: named metadata '#rs_export_foreach'
+// CHECK-DAG: function block 'twice'
+// CHECK-DAG: function block 'add_offset'
+// CHECK-DAG: function block 'root'
+// CHECK-NOT: invalid
+// CHECK: index entries verified
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+int gOffset;
+float gScale;
+
+static int twice(int v) {
+  return v * 2;
+}
+
+int add_offset(int v) {
+  return twice(v) + gOffset;
+}
+
+void root(const int *in, int *out) {
+  *out = add_offset(*in);
+}
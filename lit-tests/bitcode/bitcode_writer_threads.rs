@@ -0,0 +1,24 @@
+// RUN: rm -rf %t && mkdir -p %t/serial %t/parallel
+// RUN: %Slang -target-api 19 -emit-bc -bitcode-writer-threads 1 -o %t/serial %s
+// RUN: %Slang -target-api 19 -emit-bc -bitcode-writer-threads 4 -o %t/parallel %s
+// RUN: cmp %t/serial/bitcode_writer_threads.bc %t/parallel/bitcode_writer_threads.bc
+// RUN: %llvm-dis %t/parallel/bitcode_writer_threads.bc -o - | %FileCheck %s
+// CHECK: define void @add0(
+// CHECK: define void @mul7(
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// Enough functions for each of the 4 threads to encode two of them. The
+// bitcode written in parallel must be the same, byte for byte, as the one
+// written on a single thread.
+int gValue;
+
+void add0(int x) { gValue += x; }
+void add1(int x) { gValue += x + 1; }
+void add2(int x) { gValue += x + 2; }
+void add3(int x) { gValue += x + 3; }
+void mul4(int x) { gValue *= x + 4; }
+void mul5(int x) { gValue *= x + 5; }
+void mul6(int x) { gValue *= x + 6; }
+void mul7(int x) { gValue *= x + 7; }
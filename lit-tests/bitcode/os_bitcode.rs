@@ -0,0 +1,35 @@
+// RUN: rm -rf %t && mkdir -p %t/default %t/os
+// RUN: %Slang -target-api 19 -emit-bc -o %t/default %s
+// RUN: %Slang -target-api 19 -emit-bc -Os-bitcode -o %t/os %s
+// RUN: bash -c 'test $(wc -c < %t/os/os_bitcode.bc) -lt $(wc -c < %t/default/os_bitcode.bc)'
+// RUN: %llvm-dis %t/os/os_bitcode.bc -o - | %FileCheck %s
+// CHECK: @gCount = global i32 0
+// CHECK-NOT: @sBias
+// CHECK: define void @root(
+// CHECK-NOT: @bias
+// CHECK-NOT: @sBias
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// -Os-bitcode makes the bitcode smaller, it stays readable and only the
+// values with local linkage lose their names.
+int gCount;
+float2 gScale;
+static float sBias = 0.5f;
+
+static float bias(float x) {
+  return x + sBias;
+}
+
+float2 scale(float2 v) {
+  return v * gScale;
+}
+
+void root(const float *in, float *out, uint32_t x) {
+  float acc = 0.f;
+  for (int i = 0; i < gCount; i++) {
+    acc += bias(in[i]) * (float) x;
+  }
+  *out = acc;
+}
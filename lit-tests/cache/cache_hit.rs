@@ -0,0 +1,19 @@
+// RUN: rm -rf %t.cache %t.out
+// RUN: %Slang -v -cache-dir %t.cache -o %t.out %s | %FileCheck -check-prefix=MISS %s
+// RUN: rm -rf %t.out
+// RUN: %Slang -v -cache-dir %t.cache -o %t.out %s | %FileCheck -check-prefix=HIT %s
+// RUN: %FileCheck -input-file %t.out/cache_hit.ll %s
+// MISS: Compilation cache {{.*}}: 0 hit(s), 1 miss(es)
+// HIT: Compilation cache {{.*}}: 1 hit(s), 0 miss(es)
+// CHECK: define void @root(
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+float gain;
+
+// The second compilation is served from the cache, which restores the
+// removed bitcode.
+void root(const float *in, float *out) {
+  *out = *in * gain;
+}
@@ -0,0 +1,19 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: sed 's/@PACKAGE@/foo/' %s > %t/cache_pragma.rs
+// RUN: %Slang -v -cache-dir %t/cache -o %t/out -java-reflection-path-base %t/java %t/cache_pragma.rs | %FileCheck -check-prefix=MISS %s
+// RUN: %Slang -v -cache-dir %t/cache -o %t/out -java-reflection-path-base %t/java %t/cache_pragma.rs | %FileCheck -check-prefix=HIT %s
+// RUN: sed 's/@PACKAGE@/bar/' %s > %t/cache_pragma.rs
+// RUN: %Slang -v -cache-dir %t/cache -o %t/out -java-reflection-path-base %t/java %t/cache_pragma.rs | %FileCheck -check-prefix=MISS %s
+// RUN: test -f %t/java/bar/ScriptC_cache_pragma.java
+// MISS: Compilation cache {{.*}}: 0 hit(s), 1 miss(es)
+// HIT: Compilation cache {{.*}}: 1 hit(s), 0 miss(es)
+
+#pragma version(1)
+// Only the argument of this pragma changes between the compilations.
+#pragma rs java_package_name(@PACKAGE@)
+
+int gCount;
+
+void root(const int *in, int *out) {
+  *out = *in + gCount;
+}
@@ -0,0 +1,27 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: %Slang -M -o %t/m -output-dep-dir %t/m %s
+// RUN: %FileCheck -input-file %t/m/deps_3264.d %s
+// RUN: %Slang -MD -o %t/md -output-dep-dir %t/md -java-reflection-path-base %t/java %s
+// RUN: %FileCheck -check-prefix=MD -input-file %t/md/deps_3264.d %s
+
+// With -emit-3264 (implied by the default target API), the dependency file
+// names the 64-bit bitcode, whether the bitcode is written or not.
+// CHECK-NOT: bc32
+// CHECK: {{.*}}/bc64/deps_3264.bc:
+// CHECK-NOT: bc32
+// CHECK: deps_3264.rs
+
+// MD-NOT: bc32
+// MD: {{.*}}/bc64/deps_3264.bc
+// MD: ScriptC_deps_3264.java
+// MD-NOT: bc32
+// MD: deps_3264.rs
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+int gCount;
+
+void root(const int *in, int *out) {
+  *out = *in + gCount;
+}
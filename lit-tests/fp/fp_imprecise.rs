@@ -0,0 +1,14 @@
+// RUN: %Slang -O 0 %s
+// RUN: %rs-filecheck-wrapper %s
+// CHECK: define float @madd(
+// CHECK: fmul fast float
+// CHECK: fadd fast float
+// CHECK: attributes #{{[0-9]+}} = { {{.*}}"unsafe-fp-math"="true"
+
+#pragma version(1)
+#pragma rs java_package_name(fp)
+#pragma rs_fp_imprecise
+
+float madd(float a, float b, float c) {
+  return a * b + c;
+}
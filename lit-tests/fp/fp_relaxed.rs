@@ -0,0 +1,19 @@
+// RUN: %Slang -O 0 %s
+// RUN: %rs-filecheck-wrapper %s
+// CHECK: define float @div(
+// CHECK: fdiv arcp float
+// CHECK: define float @madd(
+// CHECK-NOT: fast
+// CHECK: attributes #{{[0-9]+}} = { {{.*}}"less-precise-fpmad"="true"
+
+#pragma version(1)
+#pragma rs java_package_name(fp)
+#pragma rs_fp_relaxed
+
+float div(float a, float b) {
+  return a / b;
+}
+
+float madd(float a, float b, float c) {
+  return a * b + c;
+}
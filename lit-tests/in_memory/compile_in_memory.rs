@@ -0,0 +1,42 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: echo "#define GAIN 4.0f" > %t/gain.txt
+// RUN: %rs-compile-in-memory -header %t/virtual/gain.rsh=%t/gain.txt -I %t/virtual -target-api 19 -o %t/ll -java-reflection-path-base %t/ll/java %t/src/compile_in_memory.rs < %s | %FileCheck -check-prefix=LL-OUTPUTS %s
+// RUN: %FileCheck -input-file %t/ll/compile_in_memory.ll %s
+// RUN: %FileCheck -check-prefix=JAVA -input-file %t/ll/java/foo/ScriptC_compile_in_memory.java %s
+// RUN: %rs-compile-in-memory -header %t/virtual/gain.rsh=%t/gain.txt -I %t/virtual -emit-bc -MD -o %t/bc -output-dep-dir %t/bc -java-reflection-path-base %t/bc/java %t/src/compile_in_memory.rs < %s | %FileCheck -check-prefix=BC-OUTPUTS %s
+// RUN: %llvm-dis %t/bc/bc64/compile_in_memory.bc -o - | %FileCheck %s
+// RUN: %FileCheck -check-prefix=BITCODE-JAVA -input-file %t/bc/java/foo/compile_in_memoryBitCode.java %s
+// RUN: %FileCheck -check-prefix=DEPS -input-file %t/bc/compile_in_memory.d %s
+// RUN: bash -c '! test -e %t/src && ! test -e %t/virtual'
+
+// The script and its header only exist in memory: the source is read from
+// stdin and gain.rsh is handed to CompileInMemory() as a virtual file.
+// LL-OUTPUTS-DAG: output {{.*}}/ll/compile_in_memory.ll ({{[0-9]+}} bytes)
+// LL-OUTPUTS-DAG: output {{.*}}/ll/java/foo/ScriptC_compile_in_memory.java ({{[0-9]+}} bytes)
+
+// BC-OUTPUTS-DAG: output {{.*}}/bc/bc32/compile_in_memory.bc ({{[0-9]+}} bytes)
+// BC-OUTPUTS-DAG: output {{.*}}/bc/bc64/compile_in_memory.bc ({{[0-9]+}} bytes)
+// BC-OUTPUTS-DAG: output {{.*}}/bc/java/foo/compile_in_memoryBitCode.java ({{[0-9]+}} bytes)
+// BC-OUTPUTS-DAG: output {{.*}}/bc/compile_in_memory.d ({{[0-9]+}} bytes)
+
+// CHECK: define void @root(
+// CHECK: fmul float %{{.*}}, 4.000000e+00
+
+// JAVA: public class ScriptC_compile_in_memory extends ScriptC
+// JAVA: public void forEach_root(
+
+// BITCODE-JAVA: public static byte[] getBitCode32()
+// BITCODE-JAVA: public static byte[] getBitCode64()
+
+// DEPS: {{.*}}/bc64/compile_in_memory.bc
+// DEPS: {{.*}}/src/compile_in_memory.rs
+// DEPS: {{.*}}/virtual/gain.rsh
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+#include "gain.rsh"
+
+void root(const float *in, float *out) {
+  *out = *in * GAIN;
+}
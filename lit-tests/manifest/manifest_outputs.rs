@@ -0,0 +1,27 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: echo "-o %t/a -p %t/a" > %t/manifest.txt
+// RUN: echo "-o %t/b -p %t/b -target-api 9000" >> %t/manifest.txt
+// RUN: echo "-o %t/c -p %t/c -target-api 19 -emit-bc" >> %t/manifest.txt
+// RUN: %Slang -manifest %t/manifest.txt -jobs 2 %s > %t/stdout.txt 2> %t/stderr.txt || true
+// RUN: %FileCheck -check-prefix=SUMMARY -input-file %t/stdout.txt %s
+// RUN: %FileCheck -check-prefix=ERROR -input-file %t/stderr.txt %s
+// RUN: %FileCheck -input-file %t/a/manifest_outputs.ll %s
+// RUN: test -f %t/a/foo/ScriptC_manifest_outputs.java
+// RUN: test ! -e %t/b
+// RUN: test -f %t/c/manifest_outputs.bc
+// RUN: test -f %t/c/foo/ScriptC_manifest_outputs.java
+// SUMMARY: manifest.txt:1: ok
+// SUMMARY-NEXT: manifest.txt:2: failed
+// SUMMARY-NEXT: manifest.txt:3: ok
+// SUMMARY-NEXT: 3 manifest entries, 1 failed
+// ERROR: error: target API level '9000' is out of range
+// CHECK: define void @root(
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+int i;
+
+void root(const int *in, int *out) {
+  *out = *in + i;
+}
@@ -0,0 +1,25 @@
+// RUN: %Slang -O 2 %s
+// RUN: %rs-filecheck-wrapper %s
+// CHECK: define void @root(%struct.Quad* {{.*}}noalias{{.*}}, %struct.Quad* {{.*}}noalias
+// CHECK-NOT: <4 x float>
+// CHECK: ret void
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// The same kernel as foreach_noalias.rs, whose fields are combined into
+// vectors at -O3. The vectorizers only run at -O3: at -O2 the fields are
+// still accessed one at a time.
+typedef struct Quad {
+  float a;
+  float b;
+  float c;
+  float d;
+} Quad;
+
+void root(const Quad *in, Quad *out) {
+  out->a = in->a * 2.f;
+  out->b = in->b * 2.f;
+  out->c = in->c * 2.f;
+  out->d = in->d * 2.f;
+}
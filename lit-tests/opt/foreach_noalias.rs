@@ -0,0 +1,25 @@
+// RUN: %Slang -O 3 %s
+// RUN: %rs-filecheck-wrapper %s
+// CHECK: define void @root(%struct.Quad* {{.*}}noalias{{.*}}, %struct.Quad* {{.*}}noalias
+// CHECK: load <4 x float>
+// CHECK: fmul <4 x float>
+// CHECK: store <4 x float>
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// Without noalias on in and out, the store to out->a could change in->b, and
+// the loads and stores of the fields could not be combined.
+typedef struct Quad {
+  float a;
+  float b;
+  float c;
+  float d;
+} Quad;
+
+void root(const Quad *in, Quad *out) {
+  out->a = in->a * 2.f;
+  out->b = in->b * 2.f;
+  out->c = in->c * 2.f;
+  out->d = in->d * 2.f;
+}
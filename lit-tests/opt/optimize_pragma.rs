@@ -0,0 +1,26 @@
+// RUN: %Slang -O 0 %s
+// RUN: %rs-filecheck-wrapper %s
+// CHECK: define void @fast(
+// CHECK-NOT: alloca
+// CHECK: ret void
+// CHECK: define void @slow({{.*}}) #[[SLOW:[0-9]+]]
+// CHECK: alloca
+// CHECK: ret void
+// CHECK-NOT: attributes #[[SLOW]] = {{.*}}noinline
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// Only fast() is optimized, slow() stays at the -O 0 of the file. The optnone
+// and noinline keeping it so are not written to the bitcode.
+#pragma rs optimize(fast, O3)
+
+void fast(float *out, float in) {
+  float t = in * 2.f;
+  *out = t;
+}
+
+void slow(float *out, float in) {
+  float t = in * 2.f;
+  *out = t;
+}
@@ -0,0 +1,17 @@
+// RUN: %Slang -O 0 -fprofile-generate %s
+// RUN: %rs-filecheck-wrapper %s
+// CHECK: @.rs.profile.counters = internal global [[COUNTERS:\[[0-9]+ x i64\]]] zeroinitializer
+// CHECK: @.rs.profile.layout = private unnamed_addr constant {{.*}} c"script profile_generate\0Afilter {{[0-9]+}}\0A\00"
+// CHECK: define void @filter(
+// CHECK: load i64* getelementptr inbounds ([[COUNTERS]]* @.rs.profile.counters, i32 0, i32 0)
+// CHECK: define void @.rs.dtor()
+// CHECK: call void @__rs_profile_dump(i8* getelementptr inbounds ({{.*}}* @.rs.profile.layout, i32 0, i32 0), i64* getelementptr inbounds ([[COUNTERS]]* @.rs.profile.counters, i32 0, i32 0))
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+void filter(int x, int *out) {
+  if (x > 100) {
+    *out = 1;
+  }
+}
@@ -0,0 +1,28 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: %Slang -O 0 -fprofile-generate -o %t/generate -java-reflection-path-base %t/java %s
+// RUN: bash -c "printf '\x05\x00\x00\x00\xc8\x00\x00\x00\x2c\x01\x00\x00\x90\x01\x00\x00' > %t/in.bin"
+// RUN: %rs-profile-replay %t/generate/bc64/profile_loop.ll -kernel root -input %t/in.bin -o %t/profile_loop.rsprof
+// RUN: %rs-profile-replay %t/generate/bc64/profile_loop.ll -kernel root -input %t/in.bin -o %t/profile_loop.rsprof
+// RUN: %FileCheck -check-prefix=PROFILE -input-file %t/profile_loop.rsprof %s
+// RUN: %Slang -O 0 -fprofile-use=%t/profile_loop.rsprof -o %t/use -java-reflection-path-base %t/java %s
+// RUN: %FileCheck -input-file %t/use/bc64/profile_loop.ll %s
+
+// The kernel is replayed twice over the 4 ints of in.bin (5, 200, 300 and
+// 400), and the counts of both runs are added up. The blocks of root() are
+// entry, the edge from entry to if.end, if.then and if.end.
+// PROFILE: script profile_loop
+// PROFILE: root 8 2 6 8
+
+// The weights of the branch come from the replayed counts.
+// CHECK: define void @root(
+// CHECK: br i1 %{{.*}}, label %if.then, label %{{.*}}, !prof ![[PROF:[0-9]+]]
+// CHECK: ![[PROF]] = metadata !{metadata !"branch_weights", i32 6, i32 2}
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+void root(const int *in, int *out) {
+  if (*in > 100) {
+    *out = 1;
+  }
+}
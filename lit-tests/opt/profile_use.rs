@@ -0,0 +1,18 @@
+// RUN: echo "script profile_use" > %t.prof
+// RUN: echo "filter 1000 990 10 1000" >> %t.prof
+// RUN: %Slang -O 0 -fprofile-use=%t.prof %s
+// RUN: %rs-filecheck-wrapper %s
+// CHECK: define void @filter(
+// CHECK: br i1 %{{.*}}, label %if.then, label %{{.*}}, !prof ![[PROF:[0-9]+]]
+// CHECK: ![[PROF]] = metadata !{metadata !"branch_weights", i32 10, i32 990}
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// The blocks of filter() are entry, the edge from entry to if.end, if.then and
+// if.end.
+void filter(int x, int *out) {
+  if (x > 100) {
+    *out = 1;
+  }
+}
@@ -0,0 +1,42 @@
+// RUN: rm -rf %t && mkdir -p %t/default %t/scalar
+// RUN: %Slang -O 3 -o %t/default %s
+// RUN: %FileCheck -input-file %t/default/struct_path_tbaa.ll %s
+// RUN: %FileCheck -check-prefix=WRITTEN -input-file %t/default/struct_path_tbaa.ll %s
+// RUN: %Slang -O 3 -no-struct-path-tbaa -o %t/scalar %s
+// RUN: %FileCheck -check-prefix=SCALAR -input-file %t/scalar/struct_path_tbaa.ll %s
+
+// With the struct-path tags emitted for the fields, the store to gQ->b does
+// not alias gP->a, and the load of gP->a is forwarded from the first store.
+// CHECK-LABEL: define void @set_fields()
+// CHECK: store i32 1, {{.*}}, !tbaa ![[INT:[0-9]+]]
+// CHECK: store i32 2, {{.*}}, !tbaa ![[INT]]
+// CHECK-NOT: load i32*
+// CHECK: store i32 1, i32* @gResult, {{.*}}!tbaa ![[INT]]
+// CHECK: ![[INT]] = metadata !{metadata !"int", metadata !{{[0-9]+}}, i64 0}
+
+// ScalarizeTBAA leaves no <base type, access type, offset> tag in the output.
+// WRITTEN-NOT: = metadata !{metadata !{{[0-9]+}}, metadata !{{[0-9]+}}, i64 {{[0-9]+}}}
+
+// With scalar tags only, both fields are ints which may alias.
+// SCALAR-LABEL: define void @set_fields()
+// SCALAR: store i32 2,
+// SCALAR: load i32*
+// SCALAR: store i32 %{{.*}}, i32* @gResult
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+typedef struct Pair {
+  int a;
+  int b;
+} Pair;
+
+Pair *gP;
+Pair *gQ;
+int gResult;
+
+void set_fields() {
+  gP->a = 1;
+  gQ->b = 2;
+  gResult = gP->a;
+}
@@ -0,0 +1,23 @@
+// RUN: %Slang -O 3 %s
+// RUN: %rs-filecheck-wrapper %s
+// CHECK: define float @horner(
+// CHECK: fmul
+// CHECK: fmul
+// CHECK: fmul
+// CHECK: fmul
+// CHECK-NOT: fmul
+// CHECK: ret float
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// Without the pragma, the 16 iterations would be unrolled completely.
+#pragma rs unroll(horner, 4)
+
+float horner(float x) {
+  float s = 0.f;
+  for (int i = 0; i < 16; i++) {
+    s = s * x + 1.f;
+  }
+  return s;
+}
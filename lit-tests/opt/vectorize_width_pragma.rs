@@ -0,0 +1,15 @@
+// RUN: %Slang -O 3 %s
+// RUN: %rs-filecheck-wrapper %s
+// CHECK: define void @scale(
+// CHECK: fmul <8 x float>
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+#pragma rs vectorize_width(scale, 8)
+
+void scale(float *out, const float *in, int n) {
+  for (int i = 0; i < n; i++) {
+    out[i] = in[i] * 2.f;
+  }
+}
@@ -0,0 +1,17 @@
+// RUN: rm -rf %t
+// RUN: %Slang -v -target-api 19 -pch-dir %t/pch -o %t/out %s | %FileCheck -check-prefix=FIRST %s
+// RUN: bash -c 'test -f %t/pch/*.pch'
+// RUN: %Slang -v -target-api 19 -pch-dir %t/pch -o %t/out %s | %FileCheck -check-prefix=SECOND %s
+// RUN: %FileCheck -input-file %t/out/pch_reuse.ll %s
+// FIRST: Precompiled header {{.*}}.pch: generated, loaded for 1 input(s)
+// SECOND: Precompiled header {{.*}}.pch: reused, loaded for 1 input(s)
+// CHECK: define void @root(
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+rs_allocation a;
+
+void root(const float4 *in, float4 *out, uint32_t x) {
+  *out = rsGetElementAt_float4(a, x) + *in;
+}
@@ -0,0 +1,31 @@
+#!/bin/bash -e
+
+# Sends the same compile request twice to an llvm-rs-cc compile server,
+# replacing the contents of a file once the first request was served (but
+# not its modification time), and prints both responses.
+# Usage: edit_between_requests.sh <file> <new file> <llvm-rs-cc> <arguments>
+
+FILE=$1
+NEWFILE=$2
+SLANG=$3
+shift 3
+
+coproc SERVER { "$SLANG" -server; }
+
+request() {
+  echo "$*" >&${SERVER[1]}
+  read -r HEADER STATUS SIZE <&${SERVER[0]}
+  echo "$HEADER $STATUS"
+  if [ "$SIZE" -gt 0 ]; then
+    read -r -N "$SIZE" OUTPUT <&${SERVER[0]}
+    echo -n "$OUTPUT"
+  fi
+}
+
+request "$@"
+touch -r "$FILE" "$NEWFILE"
+cp -p "$NEWFILE" "$FILE"
+request "$@"
+
+exec {SERVER[1]}>&-
+wait
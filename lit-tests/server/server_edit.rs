@@ -0,0 +1,20 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: echo "#define GAIN 2.0f" > %t/gain.rsh
+// RUN: echo "#define GAIN 3.0f" > %t/gain.rsh.new
+// RUN: bash %S/Inputs/edit_between_requests.sh %t/gain.rsh %t/gain.rsh.new %Slang -I %t -o %t %s | %FileCheck %s
+// RUN: %FileCheck -check-prefix=IR -input-file %t/server_edit.ll %s
+// CHECK: llvm-rs-cc-result 0
+// CHECK: llvm-rs-cc-result 0
+// IR: fmul float %{{.*}}, 3.000000e+00
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// gain.rsh is edited between the two requests, the second one must not
+// compile the contents cached by the first one. The edit keeps the size and
+// the modification time of the file, so only its contents tell it apart.
+#include "gain.rsh"
+
+void root(const float *in, float *out) {
+  *out = *in * GAIN;
+}
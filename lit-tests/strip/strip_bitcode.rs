@@ -0,0 +1,29 @@
+// RUN: %Slang -O 0 -strip-bitcode %s
+// RUN: %rs-filecheck-wrapper %s
+// CHECK: define internal float @helper(float)
+// CHECK-NOT: %sum = alloca
+// CHECK-NOT: !llvm.ident
+// CHECK-DAG: !\23pragma =
+// CHECK-DAG: !\23rs_export_var =
+// CHECK-DAG: !\23rs_export_type =
+// CHECK-NOT: !\25Point
+
+#pragma version(1)
+#pragma rs java_package_name(strip)
+
+typedef struct Point {
+  float x;
+  float y;
+} Point_t;
+
+Point_t gPoint;
+float gScale;
+
+static float helper(float v) {
+  float sum = v * gScale;
+  return sum + gPoint.x;
+}
+
+void root(const float *in, float *out) {
+  *out = helper(*in);
+}
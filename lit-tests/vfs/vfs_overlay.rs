@@ -0,0 +1,18 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: echo "#define GAIN 3.0f" > %t/real_gain.rsh
+// RUN: echo "{ 'version': 0, 'roots': [ { 'name': '%t/virtual', 'type': 'directory', 'contents': [ { 'name': 'gain.rsh', 'type': 'file', 'external-contents': '%t/real_gain.rsh' } ] } ] }" > %t/overlay.yaml
+// RUN: %Slang -ivfsoverlay %t/overlay.yaml -I %t/virtual %s
+// RUN: %rs-filecheck-wrapper %s
+// CHECK: define void @root(
+// CHECK: fmul float %{{.*}}, 3.000000e+00
+
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// gain.rsh only exists in the overlay, under a directory that is not on the
+// disk either.
+#include "gain.rsh"
+
+void root(const float *in, float *out) {
+  *out = *in * GAIN;
+}
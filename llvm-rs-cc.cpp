@@ -35,12 +35,24 @@
 #include "slang.h"
 #include "slang_assert.h"
 #include "slang_diagnostic_buffer.h"
+#include "slang_phase_report.h"
 #include "slang_rs.h"
 #include "slang_rs_reflect_utils.h"
+#include "slang_utils.h"
 
+#include <algorithm>
+#include <cstdio>
 #include <list>
 #include <set>
 #include <string>
+#include <vector>
+
+#ifndef USE_MINGW
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 // SaveStringInSet, ExpandArgsFromBuf and ExpandArgv are all copied from
 // $(CLANG_ROOT)/tools/driver/driver.cpp for processing argc/argv passed in
@@ -52,6 +64,9 @@ static inline const char *SaveStringInSet(std::set<std::string> &SavedStrings,
 static void ExpandArgsFromBuf(const char *Arg,
                               llvm::SmallVectorImpl<const char*> &ArgVector,
                               std::set<std::string> &SavedStrings);
+static void ExpandArgsFromString(const char *Buf,
+                                 llvm::SmallVectorImpl<const char*> &ArgVector,
+                                 std::set<std::string> &SavedStrings);
 static void ExpandArgv(int argc, const char **argv,
                        llvm::SmallVectorImpl<const char*> &ArgVector,
                        std::set<std::string> &SavedStrings);
@@ -64,58 +79,341 @@ static const char *DetermineOutputFile(const std::string &OutputDir,
   if (OutputType == slang::Slang::OT_Nothing)
     return "/dev/null";
 
-  std::string OutputFile(OutputDir);
+  return SaveStringInSet(SavedStrings,
+                         slang::SlangRS::GetOutputFileName(
+                             OutputDir, PathSuffix, InputFile, OutputType));
+}
+
+// The lookups and the contents of the files, shared by all the compilations
+// of this process: the inputs of the command line, the entries of a manifest
+// and the requests of a compile server.
+static slang::FileCache *getFileCache() {
+  static llvm::IntrusiveRefCntPtr<slang::FileCache> Cache(
+      new slang::FileCache());
+  return Cache.get();
+}
+
+// Set in the worker processes of -jobs, which already share the cores of the
+// host between them, and in the compile server, which runs next to the other
+// steps of the build. Each of their compilations writes its bitcode on a
+// single thread.
+static bool SingleThreadedBitcode = false;
+
+typedef std::list<std::pair<const char*, const char*> > NamePairList;
+
+#ifndef USE_MINGW
+// State of a worker process spawned by compileFilesInParallel().
+struct CompileWorker {
+  pid_t Pid;
+  // The range [Begin, End) of the input files compiled by this worker.
+  unsigned Begin, End;
+  // Capture the stdout/stderr of the worker, so that they can be replayed in
+  // the order of the inputs.
+  FILE *Out;
+  FILE *Err;
+  // Record types reflected by the worker, which the next workers check their
+  // own against (see CheckDefinitions()).
+  FILE *Defs;
+  // The serialized phase report of the worker (NULL if not reporting).
+  FILE *Phases;
+  // Pipes chaining the workers in the order of the inputs: a worker reads
+  // from PrevFd whether all the previous workers succeeded, and passes the
+  // result, combined with its own, to the next worker through NextFd (-1 for
+  // the first and the last worker).
+  int PrevFd;
+  int NextFd;
+  int Status;
+};
 
-  // Append '/' to Opts.mBitcodeOutputDir if not presents
-  if (!OutputFile.empty() &&
-      (OutputFile[OutputFile.size() - 1]) != OS_PATH_SEPARATOR)
-    OutputFile.append(1, OS_PATH_SEPARATOR);
+// Return the sublist [Begin, End) of List.
+static NamePairList SliceNamePairList(const NamePairList &List, unsigned Begin,
+                                      unsigned End) {
+  NamePairList Slice;
+  if (List.empty())
+    return Slice;
+  NamePairList::const_iterator I = List.begin();
+  std::advance(I, Begin);
+  for (unsigned i = Begin; i != End; i++, I++)
+    Slice.push_back(*I);
+  return Slice;
+}
 
-  if (!PathSuffix.empty()) {
-    OutputFile.append(PathSuffix);
-    OutputFile.append(1, OS_PATH_SEPARATOR);
+static std::string ReadStream(FILE *From) {
+  std::string Contents;
+  char Buf[4096];
+  size_t N;
+  rewind(From);
+  while ((N = fread(Buf, 1, sizeof(Buf), From)) > 0)
+    Contents.append(Buf, N);
+  return Contents;
+}
+
+// Check the record types of Definitions (one per line: <name> <signature>\t
+// <input file>) with Checker, after the ones it checked before. Returns the
+// input file of the first one conflicting with them, or "" if none does.
+static std::string CheckDefinitions(slang::SlangRS *Checker,
+                                    llvm::StringRef Definitions) {
+  llvm::SmallVector<llvm::StringRef, 64> Lines;
+  Definitions.split(Lines, "\n", -1, /* KeepEmpty = */false);
+  for (unsigned i = 0, e = Lines.size(); i != e; i++) {
+    std::pair<llvm::StringRef, llvm::StringRef> NameAndRest =
+        Lines[i].split(' ');
+    std::pair<llvm::StringRef, llvm::StringRef> SigAndFile =
+        NameAndRest.second.split('\t');
+    if (!Checker->checkODR(NameAndRest.first, SigAndFile.first,
+                           SigAndFile.second.str()))
+      return SigAndFile.second.str();
   }
+  return "";
+}
 
-  if (OutputType == slang::Slang::OT_Dependency) {
-    // The build system wants the .d file name stem to be exactly the same as
-    // the source .rs file, instead of the .bc file.
-    OutputFile.append(slang::RSSlangReflectUtils::GetFileNameStem(InputFile));
-  } else {
-    OutputFile.append(
-        slang::RSSlangReflectUtils::BCFileNameFromRSFileName(InputFile));
+static void CopyStream(FILE *From, FILE *To) {
+  char Buf[4096];
+  size_t N;
+  rewind(From);
+  while ((N = fread(Buf, 1, sizeof(Buf), From)) > 0)
+    fwrite(Buf, 1, N, To);
+  fflush(To);
+}
+
+// Wait for the previous worker (if any) to tell whether all the inputs before
+// the ones of W compiled successfully.
+static bool PreviousWorkersSucceeded(const CompileWorker &W) {
+  if (W.PrevFd < 0)
+    return true;
+  char Succeeded;
+  return (read(W.PrevFd, &Succeeded, 1) == 1) && Succeeded;
+}
+
+static void NotifyNextWorker(const CompileWorker &W, bool Succeeded) {
+  if (W.NextFd < 0)
+    return;
+  char C = Succeeded;
+  if (write(W.NextFd, &C, 1) != 1) {
+    // The next worker treats a closed pipe as a failure.
   }
+}
 
-  switch (OutputType) {
-    case slang::Slang::OT_Dependency: {
-      OutputFile.append(".d");
-      break;
-    }
-    case slang::Slang::OT_Assembly: {
-      OutputFile.append(".S");
-      break;
+/*
+ * Compile the inputs given in IOFiles with up to Opts.mJobs worker processes.
+ *
+ * Returns 0 on success and nonzero on failure.
+ *
+ * Each worker compiles a contiguous range of the inputs with its own SlangRS,
+ * holding its outputs back in a DeferredOutputSink. Once all the workers
+ * before it succeeded, a worker checks the record types it reflected against
+ * theirs for ODR violations, and writes the outputs of its inputs before the
+ * first conflicting one. So, the same way a serial compilation stops at the
+ * first failing input, nothing is written for a conflicting input or the
+ * inputs after a failing one. Once all workers finished, their diagnostics and
+ * verbose output are replayed in the order of the inputs. The phase reports
+ * of all the workers are merged into Report.
+ */
+static int compileFilesInParallel(const NamePairList &IOFiles,
+    const NamePairList &IOFiles32, const NamePairList &DepFiles,
+    slang::RSCCOptions &Opts, clang::DiagnosticsEngine *DiagEngine,
+    slang::DiagnosticBuffer *DiagClient, slang::PhaseReport *Report,
+    bool SuppressWarnings) {
+  unsigned NumInputs = IOFiles.size();
+  unsigned NumWorkers = std::min(Opts.mJobs, NumInputs);
+  std::vector<CompileWorker> Workers(NumWorkers);
+
+  // Make sure nothing buffered gets written twice by the children.
+  fflush(stdout);
+  fflush(stderr);
+  llvm::outs().flush();
+  llvm::errs().flush();
+
+  for (unsigned w = 0; w < NumWorkers; w++) {
+    Workers[w].PrevFd = -1;
+    Workers[w].NextFd = -1;
+  }
+  for (unsigned w = 1; w < NumWorkers; w++) {
+    int Fds[2];
+    if (pipe(Fds) == 0) {
+      Workers[w].PrevFd = Fds[0];
+      Workers[w - 1].NextFd = Fds[1];
     }
-    case slang::Slang::OT_LLVMAssembly: {
-      OutputFile.append(".ll");
-      break;
+  }
+
+  for (unsigned w = 0; w < NumWorkers; w++) {
+    CompileWorker &W = Workers[w];
+    W.Begin = (NumInputs * w) / NumWorkers;
+    W.End = (NumInputs * (w + 1)) / NumWorkers;
+    W.Out = tmpfile();
+    W.Err = tmpfile();
+    W.Defs = tmpfile();
+    W.Phases = (Report != NULL) ? tmpfile() : NULL;
+    W.Status = 1;
+    if ((W.Out == NULL) || (W.Err == NULL) || (W.Defs == NULL) ||
+        ((Report != NULL) && (W.Phases == NULL)) ||
+        ((w > 0) && (W.PrevFd < 0))) {
+      W.Pid = -1;
+      continue;
     }
-    case slang::Slang::OT_Object: {
-      OutputFile.append(".o");
-      break;
+
+    W.Pid = fork();
+    if (W.Pid != 0)
+      continue;
+
+    // Child
+    dup2(fileno(W.Out), STDOUT_FILENO);
+    dup2(fileno(W.Err), STDERR_FILENO);
+    // Outlive a next worker that died before reading our status.
+    signal(SIGPIPE, SIG_IGN);
+    SingleThreadedBitcode = true;
+    Opts.mBitcodeWriterThreads = 1;
+    for (unsigned i = 0; i < NumWorkers; i++) {
+      if ((i != w) && (Workers[i].PrevFd >= 0))
+        close(Workers[i].PrevFd);
+      if ((i != w) && (Workers[i].NextFd >= 0))
+        close(Workers[i].NextFd);
     }
-    case slang::Slang::OT_Bitcode: {
-      OutputFile.append(".bc");
-      break;
+
+    int CompileFailed;
+    {
+      NamePairList IOFilesSlice = SliceNamePairList(IOFiles, W.Begin, W.End);
+      NamePairList IOFiles32Slice =
+          SliceNamePairList(IOFiles32, W.Begin, W.End);
+      NamePairList DepFilesSlice = SliceNamePairList(DepFiles, W.Begin, W.End);
+
+      // Only report the phases of this worker (the parent already has the
+      // ones recorded before the fork).
+      if (Report != NULL) {
+        Report->clear();
+        Report->setLane(w + 1);
+      }
+
+      slang::DeferredOutputSink Outputs;
+      std::string Definitions;
+      {
+        std::unique_ptr<slang::SlangRS> Compiler(new slang::SlangRS());
+        Compiler->setFileCache(getFileCache());
+        Compiler->init(Opts.mBitWidth, DiagEngine, DiagClient);
+        Compiler->setPhaseReport(Report);
+        Compiler->setOutputSink(&Outputs);
+        CompileFailed = !Compiler->compile(IOFilesSlice, IOFiles32Slice,
+                                           DepFilesSlice, Opts);
+        Compiler->reset(SuppressWarnings);
+
+        // One record type per line, in the order they were first reflected:
+        // <name> <signature>\t<input file>
+        llvm::raw_string_ostream DefsOS(Definitions);
+        for (slang::SlangRS::const_reflected_definition_iterator
+                 I = Compiler->reflected_definitions_begin(),
+                 E = Compiler->reflected_definitions_end();
+             I != E;
+             I++) {
+          DefsOS << (*I)->getKey() << ' ' << (*I)->getValue().first << '\t'
+                 << (*I)->getValue().second << '\n';
+        }
+        DefsOS.flush();
+      }
+
+      // Even when this worker failed, the outputs of its inputs before the
+      // failing one are written, as in a serial compilation.
+      bool Succeeded = PreviousWorkersSucceeded(W);
+      if (Succeeded) {
+        // The previous workers are done with their record types, and checked
+        // them against each other.
+        std::string ConflictingInput;
+        {
+          std::unique_ptr<slang::SlangRS> Checker(new slang::SlangRS());
+          Checker->init(Opts.mBitWidth, DiagEngine, DiagClient);
+          for (unsigned i = 0; i != w; i++)
+            CheckDefinitions(Checker.get(), ReadStream(Workers[i].Defs));
+          ConflictingInput = CheckDefinitions(Checker.get(), Definitions);
+          Checker->reset(SuppressWarnings);
+        }
+
+        std::string Error;
+        if (!Outputs.commitInputsBefore(ConflictingInput, &Error)) {
+          llvm::errs() << "error: " << Error << "\n";
+          CompileFailed = 1;
+        }
+
+        if (!ConflictingInput.empty()) {
+          // Remove the stale bitcode of the conflicting input, as a serial
+          // compilation does.
+          for (NamePairList::const_iterator I = IOFilesSlice.begin(),
+                                            E = IOFilesSlice.end();
+               I != E;
+               I++) {
+            if (ConflictingInput == I->first)
+              slang::OutputSink::getFileSystemSink()->removeFile(I->second);
+          }
+          CompileFailed = 1;
+        }
+      }
+
+      fputs(Definitions.c_str(), W.Defs);
+      fflush(W.Defs);
+      NotifyNextWorker(W, Succeeded && !CompileFailed);
+
+      if (Report != NULL) {
+        llvm::raw_fd_ostream PhasesOS(fileno(W.Phases),
+                                      /* shouldClose = */false);
+        Report->serialize(PhasesOS);
+      }
     }
-    case slang::Slang::OT_Nothing:
-    default: {
-      slangAssert(false && "Invalid output type!");
+
+    fflush(stdout);
+    llvm::outs().flush();
+    llvm::errs().flush();
+    _exit(CompileFailed);
+  }
+
+  // Only the workers may still use the pipes.
+  for (unsigned w = 0; w < NumWorkers; w++) {
+    if (Workers[w].PrevFd >= 0)
+      close(Workers[w].PrevFd);
+    if (Workers[w].NextFd >= 0)
+      close(Workers[w].NextFd);
+  }
+
+  for (unsigned w = 0; w < NumWorkers; w++) {
+    CompileWorker &W = Workers[w];
+    if (W.Pid <= 0)
+      continue;
+    int Status;
+    if ((waitpid(W.Pid, &Status, 0) == W.Pid) && WIFEXITED(Status))
+      W.Status = WEXITSTATUS(Status);
+  }
+
+  // Replay the output of the workers in the order of the inputs, up to the
+  // first one which failed.
+  int CompileFailed = 0;
+  for (unsigned w = 0; w < NumWorkers; w++) {
+    CompileWorker &W = Workers[w];
+
+    if ((W.Phases != NULL) && (W.Pid > 0))
+      Report->merge(ReadStream(W.Phases));
+
+    if (!CompileFailed) {
+      CopyStream(W.Out, stdout);
+      CopyStream(W.Err, stderr);
+
+      if (W.Pid < 0) {
+        llvm::errs() << "error: unable to start a compilation worker\n";
+        CompileFailed = 1;
+      } else if (W.Status != 0) {
+        CompileFailed = 1;
+      }
     }
+
+    if (W.Out != NULL)
+      fclose(W.Out);
+    if (W.Err != NULL)
+      fclose(W.Err);
+    if (W.Defs != NULL)
+      fclose(W.Defs);
+    if (W.Phases != NULL)
+      fclose(W.Phases);
   }
 
-  return SaveStringInSet(SavedStrings, OutputFile);
+  return CompileFailed;
 }
-
-typedef std::list<std::pair<const char*, const char*> > NamePairList;
+#endif
 
 /*
  * Compile the Inputs.
@@ -129,6 +427,7 @@ typedef std::list<std::pair<const char*, const char*> > NamePairList;
  * DiagEngine - Clang diagnostic engine (for creating diagnostics).
  * DiagClient - Slang diagnostic consumer (collects and displays diagnostics).
  * SavedStrings - expanded strings copied from argv source input files.
+ * Report - accounts the time spent in each phase (NULL if not reporting).
  *
  * We populate IOFiles dynamically while working through the list of Inputs.
  * On any 64-bit compilation, we pass back in the 32-bit pairs of files as
@@ -139,7 +438,7 @@ typedef std::list<std::pair<const char*, const char*> > NamePairList;
 static int compileFiles(NamePairList *IOFiles, NamePairList *IOFiles32,
     const llvm::SmallVector<const char*, 16> &Inputs, slang::RSCCOptions &Opts,
     clang::DiagnosticsEngine *DiagEngine, slang::DiagnosticBuffer *DiagClient,
-    std::set<std::string> *SavedStrings) {
+    std::set<std::string> *SavedStrings, slang::PhaseReport *Report) {
   NamePairList DepFiles;
   std::string PathSuffix = "";
   bool CompileSecondTimeFor64Bit = false;
@@ -181,8 +480,18 @@ static int compileFiles(NamePairList *IOFiles, NamePairList *IOFiles32,
     IOFiles->push_back(std::make_pair(InputFile, OutputFile));
   }
 
+#ifndef USE_MINGW
+  if ((Opts.mJobs > 1) && (Inputs.size() > 1)) {
+    return compileFilesInParallel(*IOFiles, *IOFiles32, DepFiles, Opts,
+                                  DiagEngine, DiagClient, Report,
+                                  CompileSecondTimeFor64Bit);
+  }
+#endif
+
   std::unique_ptr<slang::SlangRS> Compiler(new slang::SlangRS());
+  Compiler->setFileCache(getFileCache());
   Compiler->init(Opts.mBitWidth, DiagEngine, DiagClient);
+  Compiler->setPhaseReport(Report);
   int CompileFailed = !Compiler->compile(*IOFiles, *IOFiles32, DepFiles, Opts);
   // We suppress warnings (via reset) if we are doing a second compilation.
   Compiler->reset(CompileSecondTimeFor64Bit);
@@ -208,17 +517,27 @@ static void llvm_rs_cc_VersionPrinter() {
 #undef wrap_str
 #undef str
 
-int main(int argc, const char **argv) {
-  std::set<std::string> SavedStrings;
-  llvm::SmallVector<const char*, 256> ArgVector;
+#ifndef USE_MINGW
+static int runServer(const char *Argv0);
+#endif
+static int runManifest(const llvm::SmallVectorImpl<const char*> &ArgVector,
+                       const slang::RSCCOptions &Opts);
+
+/*
+ * Run the llvm-rs-cc invocation described by ArgVector (ArgVector[0] being
+ * the program name).
+ *
+ * Returns the exit status of the invocation. Nested is set when the
+ * invocation is a request served by runServer() or an entry of a manifest
+ * run by runManifest(). Those cannot start a server or a manifest again.
+ */
+static int executeCompilation(llvm::SmallVectorImpl<const char*> &ArgVector,
+                              std::set<std::string> &SavedStrings,
+                              bool Nested) {
   slang::RSCCOptions Opts;
   llvm::SmallVector<const char*, 16> Inputs;
   std::string Argv0;
 
-  llvm::llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
-
-  ExpandArgv(argc, argv, ArgVector, SavedStrings);
-
   // Argv0
   Argv0 = llvm::sys::path::stem(ArgVector[0]);
 
@@ -232,9 +551,9 @@ int main(int argc, const char **argv) {
     new clang::DiagnosticOptions());
   clang::DiagnosticsEngine DiagEngine(DiagIDs, &*DiagOpts, DiagClient, true);
 
-  slang::Slang::GlobalInitialization();
-
   slang::ParseArguments(ArgVector, Inputs, Opts, DiagEngine);
+  if (SingleThreadedBitcode)
+    Opts.mBitcodeWriterThreads = 1;
 
   // Exits when there's any error occurred during parsing the arguments
   if (DiagEngine.hasErrorOccurred()) {
@@ -254,6 +573,32 @@ int main(int argc, const char **argv) {
     return 0;
   }
 
+  if (Opts.mServer) {
+#ifndef USE_MINGW
+    if (!Nested)
+      return runServer(ArgVector[0]);
+    DiagEngine.Report(DiagEngine.getCustomDiagID(
+        clang::DiagnosticsEngine::Error,
+        "-server cannot be used in a compile request or a manifest entry"));
+#else
+    DiagEngine.Report(DiagEngine.getCustomDiagID(
+        clang::DiagnosticsEngine::Error,
+        "-server is not supported on this platform"));
+#endif
+    llvm::errs() << DiagClient->str();
+    return 1;
+  }
+
+  if (!Opts.mManifestFile.empty()) {
+    if (!Nested)
+      return runManifest(ArgVector, Opts);
+    DiagEngine.Report(DiagEngine.getCustomDiagID(
+        clang::DiagnosticsEngine::Error,
+        "-manifest cannot be used in a compile request or a manifest entry"));
+    llvm::errs() << DiagClient->str();
+    return 1;
+  }
+
   // No input file
   if (Inputs.empty()) {
     DiagEngine.Report(clang::diag::err_drv_no_input_files);
@@ -265,19 +610,363 @@ int main(int argc, const char **argv) {
   NamePairList IOFiles64;
   NamePairList IOFiles32;
 
+  std::unique_ptr<slang::PhaseReport> Report;
+  if (Opts.mTimeReport || !Opts.mTimeTraceFile.empty() ||
+      !Opts.mMemoryReportFile.empty()) {
+    Report.reset(new slang::PhaseReport(!Opts.mTimeTraceFile.empty(),
+                                        !Opts.mMemoryReportFile.empty()));
+  }
+
   int CompileFailed = compileFiles(&IOFiles32, &IOFiles32, Inputs, Opts,
-                                   &DiagEngine, DiagClient, &SavedStrings);
+                                   &DiagEngine, DiagClient, &SavedStrings,
+                                   Report.get());
 
-  // Handle the 64-bit case too!
+  // Handle the 64-bit case too! It writes the dependency files, with -M too.
   if (Opts.mEmit3264 && !CompileFailed) {
     Opts.mBitWidth = 64;
     CompileFailed = compileFiles(&IOFiles64, &IOFiles32, Inputs, Opts,
-                                 &DiagEngine, DiagClient, &SavedStrings);
+                                 &DiagEngine, DiagClient, &SavedStrings,
+                                 Report.get());
+  }
+
+  if (Opts.mTimeReport) {
+    Report->print(llvm::errs());
+  }
+
+  if (!Opts.mTimeTraceFile.empty()) {
+    std::string Trace;
+    llvm::raw_string_ostream TraceOS(Trace);
+    Report->writeTrace(TraceOS);
+    if (!slang::SlangUtils::WriteFileAtomically(Opts.mTimeTraceFile,
+                                                TraceOS.str())) {
+      llvm::errs() << "error: unable to write the time trace to '"
+                   << Opts.mTimeTraceFile << "'\n";
+      CompileFailed = 1;
+    }
+  }
+
+  if (!Opts.mMemoryReportFile.empty()) {
+    std::string MemoryReport;
+    llvm::raw_string_ostream MemoryReportOS(MemoryReport);
+    Report->writeMemoryReport(MemoryReportOS);
+    if (!slang::SlangUtils::WriteFileAtomically(Opts.mMemoryReportFile,
+                                                MemoryReportOS.str())) {
+      llvm::errs() << "error: unable to write the memory report to '"
+                   << Opts.mMemoryReportFile << "'\n";
+      CompileFailed = 1;
+    }
   }
 
   return CompileFailed;
 }
 
+#ifndef USE_MINGW
+/*
+ * Serve the compile requests read from stdin until it is closed.
+ *
+ * Each request is a single line holding the arguments of an llvm-rs-cc
+ * invocation, quoted the same way as in an @file. For each request, the
+ * server writes the header
+ *
+ *   llvm-rs-cc-result <exit status> <size>\n
+ *
+ * to stdout, followed by the <size> bytes printed by the compilation
+ * (diagnostics, verbose output, ...).
+ *
+ * The targets stay initialized between the requests, while everything
+ * allocated for a request is released once it is served.
+ */
+static int runServer(const char *Argv0) {
+  fflush(stdout);
+  llvm::outs().flush();
+
+  // Keep the original stdout for the responses, the output of the
+  // compilations is captured.
+  int ResponseFD = dup(STDOUT_FILENO);
+  int StderrFD = dup(STDERR_FILENO);
+  FILE *Response = (ResponseFD < 0) ? NULL : fdopen(ResponseFD, "w");
+  if ((Response == NULL) || (StderrFD < 0)) {
+    llvm::errs() << "error: unable to set up the compile server\n";
+    return 1;
+  }
+
+  SingleThreadedBitcode = true;
+
+  int Status = 0;
+  bool Done = false;
+  std::string Request;
+  while (!Done) {
+    int C;
+    Request.clear();
+    while (((C = getchar()) != EOF) && (C != '\n'))
+      Request.push_back(static_cast<char>(C));
+    Done = (C == EOF);
+
+    if (llvm::StringRef(Request).trim().empty())
+      continue;
+
+    FILE *Capture = tmpfile();
+    if (Capture == NULL) {
+      Status = 1;
+      break;
+    }
+    dup2(fileno(Capture), STDOUT_FILENO);
+    dup2(fileno(Capture), STDERR_FILENO);
+
+    // The files may have been edited since the previous request.
+    getFileCache()->revalidate();
+
+    int RequestStatus;
+    {
+      std::set<std::string> SavedStrings;
+      llvm::SmallVector<const char*, 256> ArgVector;
+      ArgVector.push_back(Argv0);
+      ExpandArgsFromString(Request.c_str(), ArgVector, SavedStrings);
+      RequestStatus = executeCompilation(ArgVector, SavedStrings,
+                                         /* Nested = */true);
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    llvm::outs().flush();
+    llvm::errs().flush();
+
+    fseek(Capture, 0, SEEK_END);
+    fprintf(Response, "llvm-rs-cc-result %d %ld\n", RequestStatus,
+            ftell(Capture));
+    CopyStream(Capture, Response);
+    fclose(Capture);
+  }
+
+  // Restore stdout and stderr.
+  dup2(ResponseFD, STDOUT_FILENO);
+  dup2(StderrFD, STDERR_FILENO);
+  fclose(Response);
+  close(StderrFD);
+
+  if (Status != 0)
+    llvm::errs() << "error: unable to capture the output of a request\n";
+  return Status;
+}
+#endif
+
+// An entry of a -manifest file.
+struct ManifestEntry {
+  // The line of the entry in the manifest.
+  unsigned Line;
+  // The arguments of the entry, quoted the same way as in an @file.
+  std::string Args;
+  // The exit status of the compilation of the entry.
+  int Status;
+};
+
+// Run the compilation of Entry, with CommonArgs (starting with the program
+// name) before the arguments of the entry. Returns its exit status.
+static int runManifestEntry(
+    const llvm::SmallVectorImpl<const char*> &CommonArgs,
+    const ManifestEntry &Entry) {
+  std::set<std::string> SavedStrings;
+  llvm::SmallVector<const char*, 256> ArgVector(CommonArgs.begin(),
+                                                CommonArgs.end());
+  ExpandArgsFromString(Entry.Args.c_str(), ArgVector, SavedStrings);
+  return executeCompilation(ArgVector, SavedStrings, /* Nested = */true);
+}
+
+#ifndef USE_MINGW
+// State of a worker process spawned by runManifestEntriesInParallel().
+struct ManifestWorker {
+  pid_t Pid;
+  // The range [Begin, End) of the entries run by this worker.
+  unsigned Begin, End;
+  // Capture the stdout/stderr of the worker, so that they can be replayed in
+  // the order of the entries.
+  FILE *Out;
+  FILE *Err;
+  // The exit status of each entry, one per line.
+  FILE *Statuses;
+};
+
+/*
+ * Run the Entries with up to Jobs worker processes, each of them running a
+ * contiguous range of the entries. The output of the workers is replayed in
+ * the order of the entries, and the Status of each entry is set.
+ */
+static void runManifestEntriesInParallel(
+    const llvm::SmallVectorImpl<const char*> &CommonArgs,
+    std::vector<ManifestEntry> &Entries, unsigned Jobs) {
+  unsigned NumEntries = Entries.size();
+  unsigned NumWorkers = std::min(Jobs, NumEntries);
+  std::vector<ManifestWorker> Workers(NumWorkers);
+
+  // Make sure nothing buffered gets written twice by the children.
+  fflush(stdout);
+  fflush(stderr);
+  llvm::outs().flush();
+  llvm::errs().flush();
+
+  for (unsigned w = 0; w < NumWorkers; w++) {
+    ManifestWorker &W = Workers[w];
+    W.Begin = (NumEntries * w) / NumWorkers;
+    W.End = (NumEntries * (w + 1)) / NumWorkers;
+    W.Out = tmpfile();
+    W.Err = tmpfile();
+    W.Statuses = tmpfile();
+    if ((W.Out == NULL) || (W.Err == NULL) || (W.Statuses == NULL)) {
+      W.Pid = -1;
+      continue;
+    }
+
+    W.Pid = fork();
+    if (W.Pid != 0)
+      continue;
+
+    // Child
+    dup2(fileno(W.Out), STDOUT_FILENO);
+    dup2(fileno(W.Err), STDERR_FILENO);
+    SingleThreadedBitcode = true;
+
+    for (unsigned i = W.Begin; i != W.End; i++) {
+      int Status = runManifestEntry(CommonArgs, Entries[i]);
+      fprintf(W.Statuses, "%d\n", Status);
+    }
+
+    fflush(W.Statuses);
+    fflush(stdout);
+    llvm::outs().flush();
+    llvm::errs().flush();
+    _exit(0);
+  }
+
+  for (unsigned w = 0; w < NumWorkers; w++) {
+    ManifestWorker &W = Workers[w];
+    if (W.Pid > 0)
+      waitpid(W.Pid, NULL, 0);
+  }
+
+  for (unsigned w = 0; w < NumWorkers; w++) {
+    ManifestWorker &W = Workers[w];
+
+    if (W.Pid < 0) {
+      llvm::errs() << "error: unable to start a compilation worker\n";
+    } else {
+      CopyStream(W.Out, stdout);
+      CopyStream(W.Err, stderr);
+
+      // The entries of a worker that died keep their failure status.
+      rewind(W.Statuses);
+      for (unsigned i = W.Begin; i != W.End; i++) {
+        if (fscanf(W.Statuses, "%d", &Entries[i].Status) != 1)
+          break;
+      }
+    }
+
+    if (W.Out != NULL)
+      fclose(W.Out);
+    if (W.Err != NULL)
+      fclose(W.Err);
+    if (W.Statuses != NULL)
+      fclose(W.Statuses);
+  }
+}
+#endif
+
+/*
+ * Compile the entries of the manifest Opts.mManifestFile in this process.
+ *
+ * Each non-empty line of the manifest, except the ones starting with '#', is
+ * an entry holding the inputs and options of one compilation, quoted the same
+ * way as in an @file. The arguments given on the command line, except
+ * -manifest and -jobs, come before the ones of each entry, so that the
+ * entries can override them.
+ *
+ * With -jobs <N>, up to N entries are compiled at the same time. Their output
+ * is still printed in the order of the entries.
+ *
+ * Once all entries ran, the status of each of them is printed to stdout:
+ *
+ *   <manifest>:<line>: ok|failed
+ *   <N> manifest entries, <M> failed
+ *
+ * Returns nonzero if any entry failed.
+ */
+static int runManifest(const llvm::SmallVectorImpl<const char*> &ArgVector,
+                       const slang::RSCCOptions &Opts) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> MBOrErr =
+      llvm::MemoryBuffer::getFile(Opts.mManifestFile);
+  if (MBOrErr.getError()) {
+    llvm::errs() << "error: unable to read the manifest '"
+                 << Opts.mManifestFile << "'\n";
+    return 1;
+  }
+
+  std::vector<ManifestEntry> Entries;
+  llvm::SmallVector<llvm::StringRef, 64> Lines;
+  MBOrErr.get()->getBuffer().split(Lines, "\n", -1, /* KeepEmpty = */true);
+  for (unsigned i = 0, e = Lines.size(); i != e; i++) {
+    llvm::StringRef Line = Lines[i].trim();
+    if (Line.empty() || Line.startswith("#"))
+      continue;
+    ManifestEntry Entry;
+    Entry.Line = i + 1;
+    Entry.Args = Line.str();
+    Entry.Status = 1;
+    Entries.push_back(Entry);
+  }
+
+  llvm::SmallVector<const char*, 256> CommonArgs;
+  CommonArgs.push_back(ArgVector[0]);
+  for (unsigned i = 1, e = ArgVector.size(); i < e; i++) {
+    llvm::StringRef Arg(ArgVector[i]);
+    if ((Arg == "-manifest") || (Arg == "-jobs")) {
+      i++;  // Skip the value
+      continue;
+    }
+    if (Arg.startswith("-manifest=") || Arg.startswith("-jobs="))
+      continue;
+    CommonArgs.push_back(ArgVector[i]);
+  }
+
+#ifndef USE_MINGW
+  if ((Opts.mJobs > 1) && (Entries.size() > 1)) {
+    runManifestEntriesInParallel(CommonArgs, Entries, Opts.mJobs);
+  } else
+#endif
+  {
+    for (unsigned i = 0, e = Entries.size(); i != e; i++)
+      Entries[i].Status = runManifestEntry(CommonArgs, Entries[i]);
+  }
+
+  fflush(stdout);
+  fflush(stderr);
+  llvm::errs().flush();
+
+  unsigned NumFailed = 0;
+  llvm::raw_ostream &OS = llvm::outs();
+  for (unsigned i = 0, e = Entries.size(); i != e; i++) {
+    OS << Opts.mManifestFile << ":" << Entries[i].Line << ": "
+       << ((Entries[i].Status == 0) ? "ok" : "failed") << "\n";
+    if (Entries[i].Status != 0)
+      NumFailed++;
+  }
+  OS << Entries.size() << " manifest entries, " << NumFailed << " failed\n";
+  OS.flush();
+
+  return (NumFailed != 0);
+}
+
+int main(int argc, const char **argv) {
+  std::set<std::string> SavedStrings;
+  llvm::SmallVector<const char*, 256> ArgVector;
+
+  llvm::llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+
+  ExpandArgv(argc, argv, ArgVector, SavedStrings);
+
+  slang::Slang::GlobalInitialization();
+
+  return executeCompilation(ArgVector, SavedStrings, /* Nested = */false);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 // ExpandArgsFromBuf -
@@ -294,7 +983,13 @@ static void ExpandArgsFromBuf(const char *Arg,
   }
   std::unique_ptr<llvm::MemoryBuffer> MemBuf = std::move(MBOrErr.get());
 
-  const char *Buf = MemBuf->getBufferStart();
+  ExpandArgsFromString(MemBuf->getBufferStart(), ArgVector, SavedStrings);
+}
+
+// ExpandArgsFromString -
+static void ExpandArgsFromString(const char *Buf,
+                                 llvm::SmallVectorImpl<const char*> &ArgVector,
+                                 std::set<std::string> &SavedStrings) {
   char InQuote = ' ';
   std::string CurArg;
 
@@ -23,11 +23,14 @@
 #include "llvm/Option/ArgList.h"
 #include "llvm/Option/Option.h"
 #include "llvm/Option/OptTable.h"
+#include "llvm/Support/FileSystem.h"
 
 #include "rs_cc_options.h"
 #include "slang.h"
 #include "slang_assert.h"
 
+#include <stdint.h>
+
 #include <cstdlib>
 #include <string>
 #include <utility>
@@ -99,6 +102,8 @@ void slang::ParseArguments(llvm::SmallVectorImpl<const char *> &ArgVector,
     DiagOpts.IgnoreWarnings = Args->hasArg(OPT_w);
     DiagOpts.Warnings = Args->getAllArgValues(OPT_W);
     clang::ProcessWarningOptions(DiagEngine, DiagOpts);
+    Opts.mIgnoreWarnings = DiagOpts.IgnoreWarnings;
+    Opts.mWarningOptions = DiagOpts.Warnings;
 
     // Issue errors on unknown arguments.
     for (llvm::opt::arg_iterator it = Args->filtered_begin(OPT_UNKNOWN),
@@ -116,6 +121,7 @@ void slang::ParseArguments(llvm::SmallVectorImpl<const char *> &ArgVector,
     }
 
     Opts.mIncludePaths = Args->getAllArgValues(OPT_I);
+    Opts.mVFSOverlayFiles = Args->getAllArgValues(OPT_ivfsoverlay);
 
     Opts.mBitcodeOutputDir = Args->getLastArgValue(OPT_o);
 
@@ -215,18 +221,64 @@ void slang::ParseArguments(llvm::SmallVectorImpl<const char *> &ArgVector,
     Opts.mAdditionalDepTargets =
         Args->getAllArgValues(OPT_additional_dep_target);
 
+    Opts.mPCHDir = Args->getLastArgValue(OPT_pch_dir);
+    Opts.mCacheDir = Args->getLastArgValue(OPT_cache_dir);
+    if (!Opts.mCacheDir.empty()) {
+      Opts.mCompilerPath = llvm::sys::fs::getMainExecutable(
+          ArgVector[0], (void *)(intptr_t) &slang::createRSCCOptTable);
+    }
+
     Opts.mShowHelp = Args->hasArg(OPT_help);
     Opts.mShowVersion = Args->hasArg(OPT_version);
     Opts.mDebugEmission = Args->hasArg(OPT_emit_g);
+    Opts.mStructPathTBAA = !Args->hasArg(OPT_no_struct_path_tbaa);
+    Opts.mProfileGenerate = Args->hasArg(OPT_fprofile_generate);
+    Opts.mProfileUseFile = Args->getLastArgValue(OPT_fprofile_use);
+    if (Opts.mProfileGenerate && !Opts.mProfileUseFile.empty()) {
+      DiagEngine.Report(clang::diag::err_drv_argument_not_allowed_with)
+          << "-fprofile-generate" << "-fprofile-use";
+    }
+    Opts.mOptimizeBitcodeSize = Args->hasArg(OPT_Os_bitcode);
+    Opts.mStripBitcode = Args->hasArg(OPT_strip_bitcode);
+    Opts.mEmitBitcodeIndex = Args->hasArg(OPT_bitcode_index);
     Opts.mVerbose = Args->hasArg(OPT_verbose);
+    Opts.mServer = Args->hasArg(OPT_server);
+    Opts.mManifestFile = Args->getLastArgValue(OPT_manifest);
+    Opts.mTimeReport = Args->hasArg(OPT_ftime_report);
+    Opts.mTimeTraceFile = Args->getLastArgValue(OPT_ftime_trace);
+    Opts.mMemoryReportFile = Args->getLastArgValue(OPT_fmemory_report);
+
+    Opts.mJobs = clang::getLastArgIntValue(*Args, OPT_jobs, 1, DiagEngine);
+    if (Opts.mJobs == 0) {
+      Opts.mJobs = 1;
+    }
+
+    Opts.mBitcodeWriterThreads = clang::getLastArgIntValue(
+        *Args, OPT_bitcode_writer_threads, 0, DiagEngine);
 
     // If we are emitting both 32-bit and 64-bit bitcode, we must embed it.
 
     size_t OptLevel =
         clang::getLastArgIntValue(*Args, OPT_optimization_level, 3, DiagEngine);
 
-    Opts.mOptimizationLevel =
-        OptLevel == 0 ? llvm::CodeGenOpt::None : llvm::CodeGenOpt::Aggressive;
+    switch (OptLevel) {
+      case 0: {
+        Opts.mOptimizationLevel = llvm::CodeGenOpt::None;
+        break;
+      }
+      case 1: {
+        Opts.mOptimizationLevel = llvm::CodeGenOpt::Less;
+        break;
+      }
+      case 2: {
+        Opts.mOptimizationLevel = llvm::CodeGenOpt::Default;
+        break;
+      }
+      default: {
+        Opts.mOptimizationLevel = llvm::CodeGenOpt::Aggressive;
+        break;
+      }
+    }
 
     Opts.mTargetAPI = clang::getLastArgIntValue(*Args, OPT_target_api,
                                                 RS_VERSION, DiagEngine);
@@ -41,6 +41,10 @@ class RSCCOptions {
   // User-defined include paths.
   std::vector<std::string> mIncludePaths;
 
+  // YAML files describing virtual filesystems to lay over the real one, in
+  // increasing order of precedence.
+  std::vector<std::string> mVFSOverlayFiles;
+
   // The output directory for writing the bitcode files
   // (i.e. out/target/common/obj/APPS/.../src/renderscript/res/raw).
   std::string mBitcodeOutputDir;
@@ -92,12 +96,72 @@ class RSCCOptions {
   // The optimization level used in CodeGen, and encoded in emitted bitcode.
   llvm::CodeGenOpt::Level mOptimizationLevel;
 
+  // Tell the type-based alias analysis which structure fields are accessed
+  // (disabled by -no-struct-path-tbaa).
+  bool mStructPathTBAA;
+
+  // Instrument the scripts to count the executions of their blocks
+  // (-fprofile-generate).
+  bool mProfileGenerate;
+
+  // The profile guiding the optimization (-fprofile-use, none if empty).
+  std::string mProfileUseFile;
+
+  // Use the size-optimized encoding of the 3.2 bitcode writer (-Os-bitcode).
+  bool mOptimizeBitcodeSize;
+
+  // Strip what the runtime does not read from the bitcode (-strip-bitcode).
+  bool mStripBitcode;
+
+  // Append a BitcodeIndex to the bitcode (-bitcode-index).
+  bool mEmitBitcodeIndex;
+
   // Display verbose information about the compilation on stdout.
   bool mVerbose;
 
   // Emit both 32-bit and 64-bit bitcode (embedded in the reflected sources).
   bool mEmit3264;
 
+  // The directory holding the precompiled RenderScript headers (none if
+  // empty).
+  std::string mPCHDir;
+
+  // The directory of the compilation cache (disabled if empty).
+  std::string mCacheDir;
+
+  // The path of the running llvm-rs-cc. Its contents identify the compiler in
+  // the keys of the compilation cache (only set with a cache).
+  std::string mCompilerPath;
+
+  // Warning options (-W and -w). They only matter to the compilation cache,
+  // the diagnostics engine is set up from them while parsing the arguments.
+  std::vector<std::string> mWarningOptions;
+  bool mIgnoreWarnings;
+
+  // The maximum number of input files compiled in parallel.
+  unsigned int mJobs;
+
+  // The number of threads writing the bitcode (0 lets the writer choose).
+  // llvm-rs-cc sets it to 1 in its -jobs worker processes and in the compile
+  // server, whatever -bitcode-writer-threads says.
+  unsigned int mBitcodeWriterThreads;
+
+  // Serve compile requests read from stdin instead of compiling the inputs.
+  bool mServer;
+
+  // Compile the entries of this manifest instead of the inputs (none if
+  // empty).
+  std::string mManifestFile;
+
+  // Print the time spent in each phase of the compilation (-ftime-report).
+  bool mTimeReport;
+
+  // The file receiving the phases as Chrome trace events (none if empty).
+  std::string mTimeTraceFile;
+
+  // The file receiving the memory used by each phase (none if empty).
+  std::string mMemoryReportFile;
+
   RSCCOptions() {
     mOutputType = slang::Slang::OT_Bitcode;
     mBitWidth = 32;
@@ -108,8 +172,18 @@ class RSCCOptions {
     mTargetAPI = RS_VERSION;
     mDebugEmission = 0;
     mOptimizationLevel = llvm::CodeGenOpt::Aggressive;
+    mStructPathTBAA = true;
+    mProfileGenerate = false;
+    mOptimizeBitcodeSize = false;
+    mStripBitcode = false;
+    mEmitBitcodeIndex = false;
     mVerbose = false;
     mEmit3264 = false;
+    mIgnoreWarnings = false;
+    mJobs = 1;
+    mBitcodeWriterThreads = 0;
+    mServer = false;
+    mTimeReport = false;
   }
 };
 
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "scalarize_tbaa.h"
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+
+namespace slang {
+
+ScalarizeTBAA::ScalarizeTBAA() : ModulePass(ID) {
+}
+
+
+// A struct-path tag starts with its base type node, a scalar one with the
+// name of its type.
+static bool isStructPathTag(const llvm::MDNode *Tag) {
+  return (Tag->getNumOperands() >= 3) &&
+         llvm::isa<llvm::MDNode>(Tag->getOperand(0));
+}
+
+
+bool ScalarizeTBAA::runOnFunction(llvm::Function &F) {
+  bool Changed = false;
+  for (llvm::Function::iterator BB = F.begin(), BE = F.end(); BB != BE; ++BB) {
+    for (llvm::BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E;
+         ++I) {
+      llvm::MDNode *Tag = I->getMetadata(llvm::LLVMContext::MD_tbaa);
+      if (Tag == NULL || !isStructPathTag(Tag)) {
+        continue;
+      }
+      // The access type node (<name, parent, offset 0>) reads as a scalar
+      // type node (<name, parent, is constant>) to the older optimizers. The
+      // constness of the tag, if any, is dropped.
+      I->setMetadata(llvm::LLVMContext::MD_tbaa,
+                     llvm::cast<llvm::MDNode>(Tag->getOperand(1)));
+      Changed = true;
+    }
+  }
+  return Changed;
+}
+
+
+bool ScalarizeTBAA::runOnModule(llvm::Module &M) {
+  bool Changed = false;
+  for (llvm::Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    Changed |= runOnFunction(*I);
+  }
+  return Changed;
+}
+
+
+llvm::ModulePass *createScalarizeTBAAPass() {
+  return new ScalarizeTBAA();
+}
+
+
+char ScalarizeTBAA::ID = 0;
+static llvm::RegisterPass<ScalarizeTBAA> RPST(
+    "ScalarizeTBAA", "Scalarize TBAA Pass");
+
+}  // namespace slang
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SCALARIZE_TBAA_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SCALARIZE_TBAA_H_
+
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+namespace slang {
+
+// Replace the struct-path TBAA access tags (<base type, access type, offset>)
+// by their access type, i.e. the scalar TBAA of the LLVM the bitcode formats
+// we write come from. Their optimizers would take two struct-path tags of the
+// same root for types which do not alias. This runs once our optimizer made
+// use of the access paths (see Slang::setStructPathTBAA()).
+class ScalarizeTBAA : public llvm::ModulePass {
+ public:
+  static char ID;
+
+  ScalarizeTBAA();
+
+  bool runOnFunction(llvm::Function &F);
+
+  virtual bool runOnModule(llvm::Module &M);
+};
+
+llvm::ModulePass *createScalarizeTBAAPass();
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SCALARIZE_TBAA_H_  NOLINT
@@ -18,6 +18,7 @@
 
 #include <stdlib.h>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -32,9 +33,9 @@
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/TargetInfo.h"
 #include "clang/Basic/TargetOptions.h"
+#include "clang/Basic/VirtualFileSystem.h"
 
 #include "clang/Frontend/CodeGenOptions.h"
-#include "clang/Frontend/DependencyOutputOptions.h"
 #include "clang/Frontend/FrontendDiagnostic.h"
 #include "clang/Frontend/FrontendOptions.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
@@ -47,10 +48,17 @@
 
 #include "clang/Parse/ParseAST.h"
 
+#include "clang/Sema/SemaConsumer.h"
+
+#include "clang/Serialization/ASTReader.h"
+#include "clang/Serialization/ASTWriter.h"
+
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 
 #include "llvm/Bitcode/ReaderWriter.h"
 
+#include "llvm/IR/LLVMContext.h"
+
 // More force linking
 #include "llvm/Linker/Linker.h"
 
@@ -61,10 +69,11 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/TargetSelect.h"
-#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/ThreadLocal.h"
 
 #include "slang_assert.h"
 #include "slang_backend.h"
@@ -98,75 +107,67 @@ struct ForceSlangLinking {
 
 namespace slang {
 
-bool Slang::GlobalInitialized = false;
-
-// Language option (define the language feature for compiler such as C99)
-clang::LangOptions Slang::LangOpts;
-
-// Code generation option for the compiler
-clang::CodeGenOptions Slang::CodeGenOpts;
+// The diagnostics engine of the Slang instance initialized last on this
+// thread. LLVMErrorHandler() reports the fatal errors of the thread there.
+static llvm::sys::ThreadLocal<clang::DiagnosticsEngine> ThreadDiagEngine;
 
 // The named of metadata node that pragma resides (should be synced with
 // bcc.cpp)
 const llvm::StringRef Slang::PragmaMetadataName = "#pragma";
 
-static inline llvm::tool_output_file *
-OpenOutputFile(const char *OutputFile,
-               llvm::sys::fs::OpenFlags Flags,
-               std::string* Error,
-               clang::DiagnosticsEngine *DiagEngine) {
-  slangAssert((OutputFile != NULL) && (Error != NULL) &&
-              (DiagEngine != NULL) && "Invalid parameter!");
-
-  if (SlangUtils::CreateDirectoryWithParents(
-                        llvm::sys::path::parent_path(OutputFile), Error)) {
-    llvm::tool_output_file *F =
-          new llvm::tool_output_file(OutputFile, *Error, Flags);
-    if (F != NULL)
-      return F;
-  }
+// Write Contents to OutputFile through Sink. On the filesystem, OutputFile is
+// left untouched if it already holds Contents. Keeping the modification time
+// of unchanged outputs saves the build steps that depend on them.
+static bool WriteOutputFile(OutputSink *Sink, const std::string &OutputFile,
+                            llvm::StringRef Contents,
+                            clang::DiagnosticsEngine *DiagEngine) {
+  slangAssert((DiagEngine != NULL) && "Invalid parameter!");
+
+  std::string Error;
+  if (Sink->writeFile(OutputFile, Contents, &Error))
+    return true;
 
   // Report error here.
   DiagEngine->Report(clang::diag::err_fe_error_opening)
-    << OutputFile << *Error;
+    << OutputFile << Error;
+
+  return false;
+}
 
-  return NULL;
+bool Slang::InitializeGlobalState() {
+  // We only support x86, x64 and ARM target
+
+  // For ARM
+  LLVMInitializeARMTargetInfo();
+  LLVMInitializeARMTarget();
+  LLVMInitializeARMAsmPrinter();
+
+  // For x86 and x64
+  LLVMInitializeX86TargetInfo();
+  LLVMInitializeX86Target();
+  LLVMInitializeX86AsmPrinter();
+
+  // The handler is shared by all threads, and reports to ThreadDiagEngine.
+  llvm::install_fatal_error_handler(LLVMErrorHandler, NULL);
+
+  return true;
 }
 
 void Slang::GlobalInitialization() {
-  if (!GlobalInitialized) {
-    // We only support x86, x64 and ARM target
-
-    // For ARM
-    LLVMInitializeARMTargetInfo();
-    LLVMInitializeARMTarget();
-    LLVMInitializeARMAsmPrinter();
-
-    // For x86 and x64
-    LLVMInitializeX86TargetInfo();
-    LLVMInitializeX86Target();
-    LLVMInitializeX86AsmPrinter();
-
-    // Please refer to include/clang/Basic/LangOptions.h to setup
-    // the options.
-    LangOpts.RTTI = 0;  // Turn off the RTTI information support
-    LangOpts.C99 = 1;
-    LangOpts.Renderscript = 1;
-    LangOpts.LaxVectorConversions = 0;  // Do not bitcast vectors!
-    LangOpts.CharIsSigned = 1;  // Signed char is our default.
-
-    CodeGenOpts.OptimizationLevel = 3;
-
-    GlobalInitialized = true;
-  }
+  // The initialization of a local static is thread-safe: this runs once, even
+  // when several threads create their first Slang at the same time.
+  static const bool GlobalInitialized = InitializeGlobalState();
+  (void) GlobalInitialized;
 }
 
 void Slang::LLVMErrorHandler(void *UserData, const std::string &Message,
                              bool GenCrashDialog) {
-  clang::DiagnosticsEngine* DiagEngine =
-    static_cast<clang::DiagnosticsEngine *>(UserData);
+  clang::DiagnosticsEngine* DiagEngine = ThreadDiagEngine.get();
 
-  DiagEngine->Report(clang::diag::err_fe_error_backend) << Message;
+  if (DiagEngine != NULL)
+    DiagEngine->Report(clang::diag::err_fe_error_backend) << Message;
+  else
+    llvm::errs() << "error: " << Message << "\n";
   exit(1);
 }
 
@@ -186,30 +187,42 @@ void Slang::createTarget(uint32_t BitWidth) {
                                                     mTargetOpts));
 }
 
+llvm::IntrusiveRefCntPtr<clang::vfs::FileSystem>
+Slang::getBaseFileSystem() const {
+  if (mFileCache)
+    return mFileCache;
+  return clang::vfs::getRealFileSystem();
+}
+
 void Slang::createFileManager() {
   mFileSysOpt.reset(new clang::FileSystemOptions());
-  mFileMgr.reset(new clang::FileManager(*mFileSysOpt));
+
+  mOverlayFS = new clang::vfs::OverlayFileSystem(getBaseFileSystem());
+  mVirtualFiles = new MemoryFileSystem();
+  mOverlayFS->pushOverlay(mVirtualFiles);
+
+  mFileMgr.reset(new clang::FileManager(*mFileSysOpt, mOverlayFS));
 }
 
 void Slang::createSourceManager() {
   mSourceMgr.reset(new clang::SourceManager(*mDiagEngine, *mFileMgr));
 }
 
-void Slang::createPreprocessor() {
+void Slang::createPreprocessor(bool RecordPragmaTexts) {
   // Default only search header file in current dir
   llvm::IntrusiveRefCntPtr<clang::HeaderSearchOptions> HSOpts =
       new clang::HeaderSearchOptions();
   clang::HeaderSearch *HeaderInfo = new clang::HeaderSearch(HSOpts,
                                                             *mSourceMgr,
                                                             *mDiagEngine,
-                                                            LangOpts,
+                                                            mLangOpts,
                                                             mTarget.get());
 
   llvm::IntrusiveRefCntPtr<clang::PreprocessorOptions> PPOpts =
       new clang::PreprocessorOptions();
   mPP.reset(new clang::Preprocessor(PPOpts,
                                     *mDiagEngine,
-                                    LangOpts,
+                                    mLangOpts,
                                     *mSourceMgr,
                                     *HeaderInfo,
                                     *this,
@@ -221,7 +234,11 @@ void Slang::createPreprocessor() {
   clang::InitializePreprocessor(*mPP, *PPOpts, FEOpts);
 
   mPragmas.clear();
-  mPP->AddPragmaHandler(new PragmaRecorder(&mPragmas));
+  mPragmaTexts.clear();
+  if (RecordPragmaTexts)
+    mPP->AddPragmaHandler(new PragmaTextRecorder(&mPragmaTexts));
+  else
+    mPP->AddPragmaHandler(new PragmaRecorder(&mPragmas));
 
   std::vector<clang::DirectoryLookup> SearchList;
   for (unsigned i = 0, e = mIncludePaths.size(); i != e; i++) {
@@ -242,25 +259,192 @@ void Slang::createPreprocessor() {
 }
 
 void Slang::createASTContext() {
-  mASTContext.reset(new clang::ASTContext(LangOpts,
+  mASTContext.reset(new clang::ASTContext(mLangOpts,
                                           *mSourceMgr,
                                           mPP->getIdentifierTable(),
                                           mPP->getSelectorTable(),
                                           mPP->getBuiltinInfo()));
   mASTContext->InitBuiltinTypes(getTargetInfo());
+
+  mPCHLoaded = false;
+  if (!mPCHFileName.empty()) {
+    mPCHLoaded = loadPCH();
+    if (mPCHLoaded) {
+      mNumPCHLoads++;
+    } else {
+      // The precompiled header is out-of-date (or unreadable). Start over and
+      // parse the headers, until reset() replaces the file.
+      mStalePCHFileName = mPCHFileName;
+      mPCHFileName.clear();
+      mPCHDependencies.clear();
+
+      mASTContext.reset();
+      createPreprocessor();
+      createASTContext();
+      return;
+    }
+  }
+
   initASTContext();
 }
 
+bool Slang::loadPCH() {
+  clang::ASTReader *Reader =
+      new clang::ASTReader(*mPP, *mASTContext,
+                           /* isysroot = */"",
+                           /* DisableValidation = */false,
+                           /* AllowASTWithCompilerErrors = */false,
+                           /* AllowConfigurationMismatch = */false,
+                           /* ValidateSystemInputs = */true,
+                           /* UseGlobalIndex = */false);
+  llvm::IntrusiveRefCntPtr<clang::ExternalASTSource> Source(Reader);
+  mPP->setExternalSource(Reader);
+  mASTContext->setExternalSource(Source);
+
+  // Don't complain about a precompiled header we can't use, we silently fall
+  // back to parsing the headers instead.
+  switch (Reader->ReadAST(mPCHFileName, clang::serialization::MK_PCH,
+                          clang::SourceLocation(),
+                          clang::ASTReader::ARR_Missing |
+                          clang::ASTReader::ARR_OutOfDate |
+                          clang::ASTReader::ARR_VersionMismatch |
+                          clang::ASTReader::ARR_ConfigurationMismatch)) {
+    case clang::ASTReader::Success: {
+      // The headers included by the predefines come from the precompiled
+      // header now.
+      mPP->setPredefines(Reader->getSuggestedPredefines());
+      return true;
+    }
+    default: {
+      mPP->setExternalSource(NULL);
+      return false;
+    }
+  }
+}
+
+bool Slang::generatePCH(const std::string &PCHFile) {
+  // Precompile a translation unit made of the predefines only. Its
+  // diagnostics are dropped: the same headers will be parsed (and their
+  // errors reported) by the compilation if we fail.
+  clang::DiagnosticConsumer *Client = mDiagEngine->getClient();
+  bool OwnsClient = mDiagEngine->ownsClient();
+  if (OwnsClient)
+    mDiagEngine->takeClient();
+  clang::IgnoringDiagConsumer IgnoreDiags;
+  mDiagEngine->setClient(&IgnoreDiags, /* ShouldOwnClient = */false);
+
+  mSourceMgr->clearIDTables();
+  mSourceMgr->setMainFileID(mSourceMgr->createFileID(
+      llvm::MemoryBuffer::getMemBuffer("", "<rs pch>")));
+
+  createPreprocessor();
+  DependencyList Headers;
+  mPP->addPPCallbacks(new DependencyRecorder(*mSourceMgr, &Headers));
+
+  mASTContext.reset(new clang::ASTContext(mLangOpts,
+                                          *mSourceMgr,
+                                          mPP->getIdentifierTable(),
+                                          mPP->getSelectorTable(),
+                                          mPP->getBuiltinInfo()));
+  mASTContext->InitBuiltinTypes(getTargetInfo());
+
+  std::string Buffer;
+  llvm::raw_string_ostream OS(Buffer);
+  {
+    clang::PCHGenerator Generator(*mPP, PCHFile, NULL, /* isysroot = */"",
+                                  &OS);
+    clang::ParseAST(*mPP, &Generator, *mASTContext,
+                    /* PrintStats = */false, clang::TU_Prefix);
+  }
+  OS.flush();
+
+  bool Failed = mDiagEngine->hasErrorOccurred() || Buffer.empty();
+
+  mASTContext.reset();
+  mPP.reset();
+  mSourceMgr->clearIDTables();
+  mDiagEngine->setClient(Client, OwnsClient);
+  mDiagEngine->Reset();
+
+  if (Failed)
+    return false;
+
+  // Write the list of headers first, so that PCHFile is never seen without
+  // it. Both are written to a temporary file renamed once complete, so that
+  // concurrent compilers never see a partial file.
+  std::string HeaderList;
+  for (DependencyList::const_iterator I = Headers.begin(), E = Headers.end();
+       I != E;
+       I++) {
+    HeaderList.append(*I).append(1, '\n');
+  }
+
+  bool Written =
+      SlangUtils::WriteFileAtomically(PCHFile + ".deps", HeaderList) &&
+      SlangUtils::WriteFileAtomically(PCHFile, Buffer);
+
+  // Any earlier lookup of PCHFile is stale now.
+  if (mFileCache)
+    mFileCache->invalidate(PCHFile);
+  return Written;
+}
+
+bool Slang::usePCH(const std::string &PCHFile) {
+  mPCHFileName.clear();
+  mPCHDependencies.clear();
+  mPCHGenerated = false;
+  mNumPCHLoads = 0;
+
+  if (!llvm::sys::fs::exists(PCHFile)) {
+    if (!generatePCH(PCHFile))
+      return false;
+    mPCHGenerated = true;
+  }
+  return setPCH(PCHFile);
+}
+
+// Use the existing PCHFile for the next translation units.
+bool Slang::setPCH(const std::string &PCHFile) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > HeaderList =
+      llvm::MemoryBuffer::getFile(PCHFile + ".deps");
+  if (HeaderList.getError())
+    return false;
+
+  llvm::SmallVector<llvm::StringRef, 32> Headers;
+  HeaderList.get()->getBuffer().split(Headers, "\n", -1, false);
+  for (unsigned i = 0, e = Headers.size(); i != e; i++)
+    mPCHDependencies.push_back(Headers[i].str());
+
+  mPCHFileName = PCHFile;
+  return true;
+}
+
 clang::ASTConsumer *
 Slang::createBackend(const clang::CodeGenOptions& CodeGenOpts,
-                     llvm::raw_ostream *OS, OutputType OT) {
-  return new Backend(mDiagEngine, CodeGenOpts, getTargetOptions(),
-                     &mPragmas, OS, OT);
+                     llvm::raw_string_ostream *OS, OutputType OT) {
+  return new Backend(getLLVMContext(), mDiagEngine, CodeGenOpts,
+                     getTargetOptions(), &mPragmas, OS, OT, mPhaseReport,
+                     mBackendOpts);
 }
 
 Slang::Slang() : mInitialized(false), mDiagClient(NULL),
-  mTargetOpts(new clang::TargetOptions()), mOT(OT_Default) {
+  mTargetOpts(new clang::TargetOptions()), mPCHLoaded(false),
+  mPCHGenerated(false), mNumPCHLoads(0),
+  mOT(OT_Default), mDependenciesRecorded(false), mPhaseReport(NULL),
+  mOutputSink(OutputSink::getFileSystemSink()),
+  mDiagnosticsOS(&llvm::errs()), mPrevThreadDiagEngine(NULL) {
   GlobalInitialization();
+
+  // Please refer to include/clang/Basic/LangOptions.h to setup
+  // the options.
+  mLangOpts.RTTI = 0;  // Turn off the RTTI information support
+  mLangOpts.C99 = 1;
+  mLangOpts.Renderscript = 1;
+  mLangOpts.LaxVectorConversions = 0;  // Do not bitcast vectors!
+  mLangOpts.CharIsSigned = 1;  // Signed char is our default.
+
+  setOptimizationLevel(llvm::CodeGenOpt::Aggressive);
+  mCodeGenOpts.StructPathTBAA = 1;
 }
 
 void Slang::init(uint32_t BitWidth, clang::DiagnosticsEngine *DiagEngine,
@@ -272,9 +456,11 @@ void Slang::init(uint32_t BitWidth, clang::DiagnosticsEngine *DiagEngine,
   mDiagClient = DiagClient;
   mDiag.reset(new clang::Diagnostic(mDiagEngine));
   initDiagnostic();
-  llvm::install_fatal_error_handler(LLVMErrorHandler, mDiagEngine);
+  mPrevThreadDiagEngine = ThreadDiagEngine.get();
+  ThreadDiagEngine.set(mDiagEngine);
 
   createTarget(BitWidth);
+  mLLVMContext.reset(new llvm::LLVMContext());
   createFileManager();
   createSourceManager();
 
@@ -290,6 +476,38 @@ clang::ModuleLoadResult Slang::loadModule(
   return clang::ModuleLoadResult();
 }
 
+bool Slang::addVirtualFile(llvm::StringRef Path, llvm::StringRef Contents) {
+  mVirtualFiles->addFile(Path, Contents);
+  return true;
+}
+
+bool Slang::addVFSOverlay(const std::string &OverlayFile) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buffer =
+      llvm::MemoryBuffer::getFile(OverlayFile);
+  if (Buffer.getError()) {
+    mDiagEngine->Report(clang::diag::err_missing_vfs_overlay_file)
+        << OverlayFile;
+    return false;
+  }
+
+  // The files the overlay remaps to are read from the filesystem under it.
+  llvm::IntrusiveRefCntPtr<clang::vfs::FileSystem> Overlay =
+      clang::vfs::getVFSFromYAML(std::move(Buffer.get()),
+                                 /* DiagHandler = */NULL,
+                                 /* DiagContext = */NULL,
+                                 getBaseFileSystem());
+  if (!Overlay) {
+    mDiagEngine->Report(clang::diag::err_invalid_vfs_overlay) << OverlayFile;
+    return false;
+  }
+
+  // Keep the virtual files on top. Missing files are then looked up in
+  // mVirtualFiles twice, which is cheap.
+  mOverlayFS->pushOverlay(Overlay);
+  mOverlayFS->pushOverlay(mVirtualFiles);
+  return true;
+}
+
 bool Slang::setInputSource(llvm::StringRef InputFile,
                            const char *Text,
                            size_t TextLength) {
@@ -330,48 +548,35 @@ bool Slang::setInputSource(llvm::StringRef InputFile) {
 }
 
 bool Slang::setOutput(const char *OutputFile) {
-  std::string Error;
-  llvm::tool_output_file *OS = NULL;
+  mOS.reset();
+  mOSBuffer.clear();
 
   switch (mOT) {
     case OT_Dependency:
     case OT_Assembly:
-    case OT_LLVMAssembly: {
-      OS = OpenOutputFile(OutputFile, llvm::sys::fs::F_Text, &Error,
-          mDiagEngine);
+    case OT_LLVMAssembly:
+    case OT_Object:
+    case OT_Bitcode: {
+      mOS.reset(new llvm::raw_string_ostream(mOSBuffer));
       break;
     }
     case OT_Nothing: {
       break;
     }
-    case OT_Object:
-    case OT_Bitcode: {
-      OS = OpenOutputFile(OutputFile, llvm::sys::fs::F_None,
-                          &Error, mDiagEngine);
-      break;
-    }
     default: {
       llvm_unreachable("Unknown compiler output type");
     }
   }
 
-  if (!Error.empty())
-    return false;
-
-  mOS.reset(OS);
-
   mOutputFileName = OutputFile;
 
   return true;
 }
 
 bool Slang::setDepOutput(const char *OutputFile) {
-  std::string Error;
-
-  mDOS.reset(
-      OpenOutputFile(OutputFile, llvm::sys::fs::F_Text, &Error, mDiagEngine));
-  if (!Error.empty() || (mDOS.get() == NULL))
-    return false;
+  mDOS.reset();
+  mDOSBuffer.clear();
+  mDOS.reset(new llvm::raw_string_ostream(mDOSBuffer));
 
   mDepOutputFileName = OutputFile;
 
@@ -384,42 +589,64 @@ int Slang::generateDepFile() {
   if (mDOS.get() == NULL)
     return 1;
 
-  // Initialize options for generating dependency file
-  clang::DependencyOutputOptions DepOpts;
-  DepOpts.IncludeSystemHeaders = 1;
-  DepOpts.OutputFile = mDepOutputFileName;
-  DepOpts.Targets = mAdditionalDepTargets;
-  DepOpts.Targets.push_back(mDepTargetBCFileName);
-  for (std::vector<std::string>::const_iterator
-           I = mGeneratedFileNames.begin(), E = mGeneratedFileNames.end();
-       I != E;
-       I++) {
-    DepOpts.Targets.push_back(*I);
-  }
-  mGeneratedFileNames.clear();
+  PhaseTimer Timer(mPhaseReport, PhaseReport::PH_Dependency);
 
-  // Per-compilation needed initialization
-  createPreprocessor();
-  clang::DependencyFileGenerator::CreateAndAttachToPreprocessor(*mPP.get(), DepOpts);
+  if (!mDependenciesRecorded) {
+    // Per-compilation needed initialization
+    createPreprocessor();
+    mDependencies.clear();
+    mPP->addPPCallbacks(new DependencyRecorder(*mSourceMgr, &mDependencies));
 
-  // Inform the diagnostic client we are processing a source file
-  mDiagClient->BeginSourceFile(LangOpts, mPP.get());
+    // Inform the diagnostic client we are processing a source file
+    mDiagClient->BeginSourceFile(mLangOpts, mPP.get());
 
-  // Go through the source file (no operations necessary)
-  clang::Token Tok;
-  mPP->EnterMainSourceFile();
-  do {
-    mPP->Lex(Tok);
-  } while (Tok.isNot(clang::tok::eof));
+    // Go through the source file (no operations necessary)
+    clang::Token Tok;
+    mPP->EnterMainSourceFile();
+    do {
+      mPP->Lex(Tok);
+    } while (Tok.isNot(clang::tok::eof));
 
-  mPP->EndSourceFile();
+    mPP->EndSourceFile();
+    mPP.reset();
+  }
+
+  if (mDependenciesRecorded && mPCHLoaded) {
+    // The headers read from the precompiled header were never entered by the
+    // preprocessor. They come right after the input file, the same way they
+    // would if they had been parsed.
+    DependencyList::iterator Pos = mDependencies.begin();
+    if (Pos != mDependencies.end())
+      Pos++;
+    for (DependencyList::const_iterator I = mPCHDependencies.begin(),
+             E = mPCHDependencies.end();
+         I != E;
+         I++) {
+      if (std::find(mDependencies.begin(), mDependencies.end(), *I) ==
+          mDependencies.end()) {
+        Pos = mDependencies.insert(Pos, *I);
+        Pos++;
+      }
+    }
+  }
 
-  // Declare success if no error
-  if (!mDiagEngine->hasErrorOccurred())
-    mDOS->keep();
+  if (!mDiagEngine->hasErrorOccurred()) {
+    std::vector<std::string> Targets = mAdditionalDepTargets;
+    Targets.push_back(mDepTargetBCFileName);
+    Targets.insert(Targets.end(), mGeneratedFileNames.begin(),
+                   mGeneratedFileNames.end());
+
+    DependencyRecorder::WriteDependencyFile(*mDOS, Targets, mDependencies);
+
+    // Declare success if no error
+    WriteOutputFile(mOutputSink, mDepOutputFileName, mDOS->str(),
+                    mDiagEngine);
+  }
 
   // Clean up after compilation
-  mPP.reset();
+  mGeneratedFileNames.clear();
+  mDependencies.clear();
+  mDependenciesRecorded = false;
   mDOS.reset();
 
   return mDiagEngine->hasErrorOccurred() ? 1 : 0;
@@ -432,42 +659,128 @@ int Slang::compile() {
     return 1;
 
   // Here is per-compilation needed initialization
-  createPreprocessor();
-  createASTContext();
+  {
+    PhaseTimer Timer(mPhaseReport, PhaseReport::PH_Preprocess);
+    createPreprocessor();
+    createASTContext();
+  }
 
-  mBackend.reset(createBackend(CodeGenOpts, &mOS->os(), mOT));
+  // Collect the dependencies while compiling, so that generateDepFile() does
+  // not need to preprocess the input again.
+  mDependencies.clear();
+  mDependenciesRecorded = (mDOS.get() != NULL);
+  if (mDependenciesRecorded) {
+    mPP->addPPCallbacks(new DependencyRecorder(*mSourceMgr, &mDependencies));
+  }
+
+  mBackend.reset(createBackend(mCodeGenOpts, mOS.get(), mOT));
 
   // Inform the diagnostic client we are processing a source file
-  mDiagClient->BeginSourceFile(LangOpts, mPP.get());
+  mDiagClient->BeginSourceFile(mLangOpts, mPP.get());
 
   // The core of the slang compiler
-  ParseAST(*mPP, mBackend.get(), *mASTContext);
+  {
+    PhaseTimer Timer(mPhaseReport, PhaseReport::PH_Parse);
+    ParseAST(*mPP, mBackend.get(), *mASTContext);
+  }
+
+  if (mPhaseReport != NULL) {
+    mPhaseReport->recordSize("ast-context",
+                             mASTContext->getASTAllocatedMemory());
+    mPhaseReport->recordSize("ast-side-tables",
+                             mASTContext->getSideTableAllocatedMemory());
+    mPhaseReport->recordSize("source-manager",
+                             mSourceMgr->getDataStructureSizes());
+  }
 
   // Inform the diagnostic client we are done with previous source file
   mDiagClient->EndSourceFile();
 
-  // Declare success if no error
-  if (!mDiagEngine->hasErrorOccurred())
-    mOS->keep();
-
-  // The compilation ended, clear
+  // The compilation ended, clear (the backend may still flush some output)
   mBackend.reset();
   mASTContext.reset();
   mPP.reset();
+
+  // Declare success if no error. Otherwise, do not leave a stale output
+  // behind. With -M, the output is the dependency file, which is written by
+  // generateDepFile().
+  if (!mDiagEngine->hasErrorOccurred()) {
+    if (mOT != OT_Dependency)
+      WriteOutputFile(mOutputSink, mOutputFileName, mOS->str(), mDiagEngine);
+  } else {
+    mOutputSink->removeFile(mOutputFileName);
+  }
   mOS.reset();
 
   return mDiagEngine->hasErrorOccurred() ? 1 : 0;
 }
 
+void Slang::preprocess(llvm::raw_ostream &OS) {
+  PhaseTimer Timer(mPhaseReport, PhaseReport::PH_Preprocess);
+
+  // The handlers of the RenderScript pragmas are only added for a
+  // compilation, so all the pragmas, arguments included, are recorded as
+  // text.
+  createPreprocessor(/* RecordPragmaTexts = */true);
+
+  // The diagnostics are reported by the actual compilation of the input.
+  bool SuppressAllDiagnostics = mDiagEngine->getSuppressAllDiagnostics();
+  mDiagEngine->setSuppressAllDiagnostics(true);
+
+  mDiagClient->BeginSourceFile(mLangOpts, mPP.get());
+
+  clang::Token Tok;
+  mPP->EnterMainSourceFile();
+  mPP->Lex(Tok);
+  while (Tok.isNot(clang::tok::eof)) {
+    // Locate each line, as the locations end up in the diagnostics and the
+    // debug information.
+    if (Tok.isAtStartOfLine()) {
+      clang::PresumedLoc PLoc = mSourceMgr->getPresumedLoc(Tok.getLocation());
+      OS << '\n';
+      if (PLoc.isValid()) {
+        OS << PLoc.getFilename() << ':' << PLoc.getLine() << ':'
+           << PLoc.getColumn() << ':';
+      }
+    } else if (Tok.hasLeadingSpace()) {
+      OS << ' ';
+    }
+    OS << mPP->getSpelling(Tok);
+    mPP->Lex(Tok);
+  }
+
+  mPP->EndSourceFile();
+  mDiagClient->EndSourceFile();
+
+  for (PragmaTextList::const_iterator I = mPragmaTexts.begin(),
+                                      E = mPragmaTexts.end();
+       I != E;
+       I++) {
+    OS << "\n#pragma " << *I;
+  }
+  OS << '\n';
+
+  mDiagEngine->setSuppressAllDiagnostics(SuppressAllDiagnostics);
+  mPP.reset();
+}
+
 void Slang::setDebugMetadataEmission(bool EmitDebug) {
   if (EmitDebug)
-    CodeGenOpts.setDebugInfo(clang::CodeGenOptions::FullDebugInfo);
+    mCodeGenOpts.setDebugInfo(clang::CodeGenOptions::FullDebugInfo);
   else
-    CodeGenOpts.setDebugInfo(clang::CodeGenOptions::NoDebugInfo);
+    mCodeGenOpts.setDebugInfo(clang::CodeGenOptions::NoDebugInfo);
 }
 
 void Slang::setOptimizationLevel(llvm::CodeGenOpt::Level OptimizationLevel) {
-  CodeGenOpts.OptimizationLevel = OptimizationLevel;
+  mCodeGenOpts.OptimizationLevel = OptimizationLevel;
+  // The loop and SLP vectorizers only run at -O3.
+  bool Vectorize = (OptimizationLevel == llvm::CodeGenOpt::Aggressive);
+  mCodeGenOpts.VectorizeLoop = Vectorize;
+  mCodeGenOpts.VectorizeSLP = Vectorize;
+}
+
+void Slang::setStructPathTBAA(bool StructPath) {
+  mCodeGenOpts.StructPathTBAA = StructPath;
 }
 
 void Slang::reset(bool SuppressWarnings) {
@@ -479,13 +792,35 @@ void Slang::reset(bool SuppressWarnings) {
   // the 32-bit and 64-bit compiles, but that is a more substantial feature.
   // Bug: 17052573
   if (!SuppressWarnings || mDiagEngine->hasErrorOccurred()) {
-    llvm::errs() << mDiagClient->str();
+    *mDiagnosticsOS << mDiagClient->str();
   }
   mDiagEngine->Reset();
   mDiagClient->reset();
+  mDOS.reset();
+  mDependencies.clear();
+  mDependenciesRecorded = false;
+
+  // Nothing refers to the types and constants of the previous translation
+  // unit anymore.
+  if (mInitialized)
+    mLLVMContext.reset(new llvm::LLVMContext());
+
+  // Nor to its source manager: replace the out-of-date precompiled header
+  // (generatePCH() renames the new one over it). Other compilers sharing it
+  // always see either of them in full.
+  if (mInitialized && !mStalePCHFileName.empty()) {
+    std::string PCHFile;
+    PCHFile.swap(mStalePCHFileName);
+    if (generatePCH(PCHFile)) {
+      mPCHGenerated = true;
+      setPCH(PCHFile);
+    }
+  }
 }
 
 Slang::~Slang() {
+  if (mInitialized)
+    ThreadDiagEngine.set(mPrevThreadDiagEngine);
 }
 
 }  // namespace slang
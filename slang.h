@@ -25,18 +25,28 @@
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 using llvm::RefCountedBase;
 
+#include "clang/Basic/LangOptions.h"
 #include "clang/Basic/TargetOptions.h"
+#include "clang/Frontend/CodeGenOptions.h"
 #include "clang/Lex/ModuleLoader.h"
 
 #include "llvm/ADT/StringRef.h"
 
 #include "llvm/Target/TargetMachine.h"
 
+#include "slang_backend_options.h"
+#include "slang_dependency_recorder.h"
 #include "slang_diagnostic_buffer.h"
+#include "slang_file_cache.h"
+#include "slang_memory_file_system.h"
+#include "slang_output_sink.h"
+#include "slang_phase_report.h"
 #include "slang_pragma_recorder.h"
 
 namespace llvm {
-  class tool_output_file;
+  class LLVMContext;
+  class raw_ostream;
+  class raw_string_ostream;
 }
 
 namespace clang {
@@ -57,10 +67,14 @@ namespace clang {
 namespace slang {
 
 class Slang : public clang::ModuleLoader {
-  static clang::LangOptions LangOpts;
-  static clang::CodeGenOptions CodeGenOpts;
+  // Language option (define the language feature for compiler such as C99)
+  clang::LangOptions mLangOpts;
+  // Code generation option for the compiler
+  clang::CodeGenOptions mCodeGenOpts;
 
-  static bool GlobalInitialized;
+  // Initialize the LLVM targets and install LLVMErrorHandler() (once per
+  // process, see GlobalInitialization()).
+  static bool InitializeGlobalState();
 
   static void LLVMErrorHandler(void *UserData, const std::string &Message,
                                bool GenCrashDialog);
@@ -96,9 +110,24 @@ class Slang : public clang::ModuleLoader {
   void createTarget(uint32_t BitWidth);
 
 
+  // The LLVM context holding the types and constants of the module being
+  // compiled. It is recreated for every translation unit (see reset()), so
+  // that they don't accumulate when the same instance compiles many files.
+  std::unique_ptr<llvm::LLVMContext> mLLVMContext;
+
+
   // File manager (for prepocessor doing the job such as header file search)
   std::unique_ptr<clang::FileManager> mFileMgr;
   std::unique_ptr<clang::FileSystemOptions> mFileSysOpt;
+  // Where the FileManager looks up the files (the real filesystem if NULL).
+  llvm::IntrusiveRefCntPtr<FileCache> mFileCache;
+  // The filesystem of the FileManager: mFileCache (or the real filesystem),
+  // under the overlays added by addVFSOverlay() and mVirtualFiles.
+  llvm::IntrusiveRefCntPtr<clang::vfs::OverlayFileSystem> mOverlayFS;
+  // The files added by addVirtualFile().
+  llvm::IntrusiveRefCntPtr<MemoryFileSystem> mVirtualFiles;
+  // Returns mFileCache, or the real filesystem if there is none.
+  llvm::IntrusiveRefCntPtr<clang::vfs::FileSystem> getBaseFileSystem() const;
   void createFileManager();
 
 
@@ -109,7 +138,12 @@ class Slang : public clang::ModuleLoader {
 
   // Preprocessor (source code preprocessor)
   std::unique_ptr<clang::Preprocessor> mPP;
-  void createPreprocessor();
+  // With RecordPragmaTexts, the pragmas are recorded as text in
+  // mPragmaTexts instead of as name/value pairs in mPragmas.
+  void createPreprocessor(bool RecordPragmaTexts = false);
+
+  // The pragmas of the last preprocess().
+  PragmaTextList mPragmaTexts;
 
 
   // AST context (the context to hold long-lived AST nodes)
@@ -117,6 +151,25 @@ class Slang : public clang::ModuleLoader {
   void createASTContext();
 
 
+  // Precompiled header for the headers included by the predefines (see
+  // usePCH())
+  std::string mPCHFileName;
+  // Headers in mPCHFileName, for the dependency file.
+  DependencyList mPCHDependencies;
+  // Whether mPCHFileName was loaded for the current translation unit.
+  bool mPCHLoaded;
+  // Whether a precompiled header was generated since usePCH(), and the number
+  // of translation units which loaded one.
+  bool mPCHGenerated;
+  unsigned mNumPCHLoads;
+  // A precompiled header found out-of-date, generated again by reset() (it is
+  // never removed, other compilers may be using it).
+  std::string mStalePCHFileName;
+  bool generatePCH(const std::string &PCHFile);
+  bool setPCH(const std::string &PCHFile);
+  bool loadPCH();
+
+
   // AST consumer, responsible for code generation
   std::unique_ptr<clang::ASTConsumer> mBackend;
 
@@ -133,14 +186,38 @@ class Slang : public clang::ModuleLoader {
 
   OutputType mOT;
 
-  // Output stream
-  std::unique_ptr<llvm::tool_output_file> mOS;
+  // Output stream. The output is rendered in memory, and only written to
+  // mOutputFileName at the end of a successful compile() if it changed.
+  std::string mOSBuffer;
+  std::unique_ptr<llvm::raw_string_ostream> mOS;
+
+  // Dependency output stream (written out the same way by generateDepFile())
+  std::string mDOSBuffer;
+  std::unique_ptr<llvm::raw_string_ostream> mDOS;
 
-  // Dependency output stream
-  std::unique_ptr<llvm::tool_output_file> mDOS;
+  // Files entered by the preprocessor of the last compile(), recorded when a
+  // dependency output was set up beforehand.
+  DependencyList mDependencies;
+  bool mDependenciesRecorded;
 
   std::vector<std::string> mIncludePaths;
 
+  // Accounts the time spent in each phase (NULL if not reporting).
+  PhaseReport *mPhaseReport;
+
+  // Handed to each Backend (see createBackend()).
+  BackendOptions mBackendOpts;
+
+  // Receives the output files (the filesystem by default).
+  OutputSink *mOutputSink;
+
+  // Where reset() prints the diagnostics (stderr by default).
+  llvm::raw_ostream *mDiagnosticsOS;
+
+  // The engine LLVMErrorHandler() reported to on this thread before init(),
+  // restored by the destructor.
+  clang::DiagnosticsEngine *mPrevThreadDiagEngine;
+
  protected:
   PragmaList mPragmas;
 
@@ -150,6 +227,11 @@ class Slang : public clang::ModuleLoader {
   clang::SourceManager &getSourceManager() { return *mSourceMgr; }
   clang::Preprocessor &getPreprocessor() { return *mPP; }
   clang::ASTContext &getASTContext() { return *mASTContext; }
+  DiagnosticBuffer *getDiagnosticBuffer() { return mDiagClient; }
+  llvm::LLVMContext &getLLVMContext() { return *mLLVMContext; }
+  PhaseReport *getPhaseReport() { return mPhaseReport; }
+  const BackendOptions &getBackendOptions() const { return mBackendOpts; }
+  OutputSink *getOutputSink() { return mOutputSink; }
 
   inline clang::TargetOptions const &getTargetOptions() const
     { return *mTargetOpts.get(); }
@@ -160,7 +242,7 @@ class Slang : public clang::ModuleLoader {
 
   virtual clang::ASTConsumer *
     createBackend(const clang::CodeGenOptions& CodeGenOpts,
-                  llvm::raw_ostream *OS,
+                  llvm::raw_string_ostream *OS,
                   OutputType OT);
 
  public:
@@ -170,6 +252,11 @@ class Slang : public clang::ModuleLoader {
 
   Slang();
 
+  // Look up the input and header files through Cache, which may be shared
+  // with other instances, instead of the filesystem. Must be called before
+  // init().
+  void setFileCache(FileCache *Cache) { mFileCache = Cache; }
+
   void init(uint32_t BitWidth, clang::DiagnosticsEngine *DiagEngine,
             DiagnosticBuffer *DiagClient);
 
@@ -179,6 +266,19 @@ class Slang : public clang::ModuleLoader {
       clang::Module::NameVisibilityKind VK,
       bool IsInclusionDirective);
 
+  // Make Path read as Contents, whether or not it exists on disk. This
+  // applies to the input as well as to the included files (wherever they are
+  // found through the include paths), for the lifetime of this instance. The
+  // file is never read from the disk. Must be called before the file is
+  // first looked up.
+  bool addVirtualFile(llvm::StringRef Path, llvm::StringRef Contents);
+
+  // Lay the virtual filesystem described by the YAML file OverlayFile (as
+  // taken by clang -ivfsoverlay) over the filesystem. Overlays added later
+  // take precedence, and the files added by addVirtualFile() over all of
+  // them. Must be called before compile().
+  bool addVFSOverlay(const std::string &OverlayFile);
+
   bool setInputSource(llvm::StringRef InputFile, const char *Text,
                       size_t TextLength);
 
@@ -223,16 +323,60 @@ class Slang : public clang::ModuleLoader {
     mGeneratedFileNames.push_back(GeneratedFileName);
   }
 
+  // Write the dependency file set up by setDepOutput(). If it was set up
+  // before compile(), the dependencies recorded during the compilation are
+  // used. Otherwise (i.e. -M), the input is preprocessed once more to collect
+  // them.
   int generateDepFile();
 
   int compile();
 
+  // Run the preprocessor alone on the input and print its output to OS, in a
+  // form similar to the one of clang -E. The text of the pragmas follows the
+  // tokens. No diagnostics are reported.
+  void preprocess(llvm::raw_ostream &OS);
+
+  // Use the precompiled header PCHFile instead of parsing the headers
+  // included by the predefines (see initPreprocessor()) for each translation
+  // unit. PCHFile is generated if it does not exist yet, and compile() falls
+  // back to parsing the headers if it turns out to be out-of-date.
+  //
+  // Returns false (and keeps on parsing the headers) if PCHFile can not be
+  // used.
+  bool usePCH(const std::string &PCHFile);
+
+  bool isPCHGenerated() const { return mPCHGenerated; }
+  unsigned getNumPCHLoads() const { return mNumPCHLoads; }
+
   char const *getErrorMessage() { return mDiagClient->str().c_str(); }
 
   void setDebugMetadataEmission(bool EmitDebug);
 
   void setOptimizationLevel(llvm::CodeGenOpt::Level OptimizationLevel);
 
+  // Tag the loads and stores of the fields of structures (e.g. of the exported
+  // records) with their access path for the type-based alias analysis, so
+  // that the fields of two structures are told apart. On by default. The tags
+  // are reduced to the types accessed before the bitcode is written (see
+  // ScalarizeTBAA).
+  void setStructPathTBAA(bool StructPath);
+
+  // Set how the backends write the bitcode and use the profiles (see
+  // BackendOptions).
+  void setBackendOptions(const BackendOptions &Opts) { mBackendOpts = Opts; }
+
+  // Account the time spent in each phase of the compilation to Report (not
+  // owned). NULL disables the accounting.
+  void setPhaseReport(PhaseReport *Report) { mPhaseReport = Report; }
+
+  // Hand the output files (bitcode, dependency and reflected files) to Sink
+  // (not owned) instead of writing them to the filesystem.
+  void setOutputSink(OutputSink *Sink) { mOutputSink = Sink; }
+
+  // Print the diagnostics of each compilation to OS (not owned) instead of
+  // stderr.
+  void setDiagnosticsOutput(llvm::raw_ostream *OS) { mDiagnosticsOS = OS; }
+
   // Reset the slang compiler state such that it can be reused to compile
   // another file
   virtual void reset(bool SuppressWarnings = false);
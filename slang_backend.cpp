@@ -16,6 +16,7 @@
 
 #include "slang_backend.h"
 
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -50,11 +51,16 @@
 #include "llvm/IR/DataLayout.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/TargetRegistry.h"
 
 #include "llvm/MC/SubtargetFeature.h"
 
+#include "scalarize_tbaa.h"
 #include "slang_assert.h"
+#include "slang_bitcode_index.h"
+#include "strip_bitcode.h"
 #include "strip_unknown_attributes.h"
 #include "BitWriter_2_9/ReaderWriter_2_9.h"
 #include "BitWriter_2_9_func/ReaderWriter_2_9_func.h"
@@ -62,13 +68,18 @@
 
 namespace slang {
 
+// The default scheduler and register allocator are process-wide. They are set
+// and consumed by addPassesToEmitFile() under this lock, so that concurrent
+// compilations with different optimization levels do not race.
+static llvm::ManagedStatic<llvm::sys::Mutex> CodeGenDefaultsLock;
+
 void Backend::CreateFunctionPasses() {
   if (!mPerFunctionPasses) {
     mPerFunctionPasses = new llvm::FunctionPassManager(mpModule);
     mPerFunctionPasses->add(new llvm::DataLayoutPass(mpModule));
 
     llvm::PassManagerBuilder PMBuilder;
-    PMBuilder.OptLevel = mCodeGenOpts.OptimizationLevel;
+    PMBuilder.OptLevel = mOptimizationLevel;
     PMBuilder.populateFunctionPassManager(*mPerFunctionPasses);
   }
 }
@@ -79,7 +90,7 @@ void Backend::CreateModulePasses() {
     mPerModulePasses->add(new llvm::DataLayoutPass(mpModule));
 
     llvm::PassManagerBuilder PMBuilder;
-    PMBuilder.OptLevel = mCodeGenOpts.OptimizationLevel;
+    PMBuilder.OptLevel = mOptimizationLevel;
     PMBuilder.SizeLevel = mCodeGenOpts.OptimizeSize;
     if (mCodeGenOpts.UnitAtATime) {
       PMBuilder.DisableUnitAtATime = 0;
@@ -87,15 +98,25 @@ void Backend::CreateModulePasses() {
       PMBuilder.DisableUnitAtATime = 1;
     }
 
-    if (mCodeGenOpts.UnrollLoops) {
+    if (mUnrollLoops) {
       PMBuilder.DisableUnrollLoops = 0;
     } else {
       PMBuilder.DisableUnrollLoops = 1;
     }
 
+    PMBuilder.LoopVectorize = mVectorizeLoop;
+    PMBuilder.SLPVectorize = mVectorizeSLP;
+
     PMBuilder.populateModulePassManager(*mPerModulePasses);
     // Add a pass to strip off unknown/unsupported attributes.
     mPerModulePasses->add(createStripUnknownAttributesPass());
+    // And one to bring the TBAA access tags back to what the bitcode readers
+    // of the runtime know.
+    mPerModulePasses->add(createScalarizeTBAAPass());
+    // And one for what the runtime does not read, if asked to.
+    if (mBackendOpts.StripBitcode) {
+      mPerModulePasses->add(createStripBitcodePass());
+    }
   }
 }
 
@@ -170,6 +191,8 @@ bool Backend::CreateCodeGenPasses() {
     TargetInfo->createTargetMachine(Triple, mTargetOpts.CPU, FeaturesStr,
                                     Options, RM, CM);
 
+  llvm::sys::ScopedLock Lock(*CodeGenDefaultsLock);
+
   // Register scheduler
   llvm::RegisterScheduler::setDefault(llvm::createDefaultScheduler);
 
@@ -201,12 +224,15 @@ bool Backend::CreateCodeGenPasses() {
   return true;
 }
 
-Backend::Backend(clang::DiagnosticsEngine *DiagEngine,
+Backend::Backend(llvm::LLVMContext &LLVMContext,
+                 clang::DiagnosticsEngine *DiagEngine,
                  const clang::CodeGenOptions &CodeGenOpts,
                  const clang::TargetOptions &TargetOpts,
                  PragmaList *Pragmas,
-                 llvm::raw_ostream *OS,
-                 Slang::OutputType OT)
+                 llvm::raw_string_ostream *OS,
+                 Slang::OutputType OT,
+                 PhaseReport *Report,
+                 const BackendOptions &BackendOpts)
     : ASTConsumer(),
       mTargetOpts(TargetOpts),
       mpModule(NULL),
@@ -216,9 +242,15 @@ Backend::Backend(clang::DiagnosticsEngine *DiagEngine,
       mPerFunctionPasses(NULL),
       mPerModulePasses(NULL),
       mCodeGenPasses(NULL),
-      mLLVMContext(llvm::getGlobalContext()),
+      mPhaseReport(Report),
+      mLLVMContext(LLVMContext),
       mDiagEngine(*DiagEngine),
       mCodeGenOpts(CodeGenOpts),
+      mBackendOpts(BackendOpts),
+      mOptimizationLevel(CodeGenOpts.OptimizationLevel),
+      mUnrollLoops(CodeGenOpts.UnrollLoops),
+      mVectorizeLoop(CodeGenOpts.VectorizeLoop),
+      mVectorizeSLP(CodeGenOpts.VectorizeSLP),
       mPragmas(Pragmas) {
   FormattedOutStream.setStream(*mpOS,
                                llvm::formatted_raw_ostream::PRESERVE_STREAM);
@@ -232,30 +264,65 @@ void Backend::Initialize(clang::ASTContext &Ctx) {
   mpModule = mGen->GetModule();
 }
 
-// Encase the Bitcode in a wrapper containing RS version information.
-void Backend::WrapBitcode(llvm::raw_string_ostream &Bitcode) {
+uint64_t Backend::ReserveBitcodeWrapper() {
+  // The bitcode is written to mpOS directly, behind FormattedOutStream.
+  FormattedOutStream.flush();
+
+  uint64_t WrapperOffset = mpOS->tell();
+  bcinfo::AndroidBitcodeWrapper wrapper;
+  memset(&wrapper, 0, sizeof(wrapper));
+  mpOS->write(reinterpret_cast<char*>(&wrapper), sizeof(wrapper));
+  return WrapperOffset;
+}
+
+// Encase the Bitcode in a wrapper containing RS version information. The
+// bitcode was written in place after the room reserved for the wrapper, so
+// that it is not copied again.
+void Backend::WrapBitcode(uint64_t WrapperOffset, uint64_t BitcodeSize) {
   bcinfo::AndroidBitcodeWrapper wrapper;
   size_t actualWrapperLen = bcinfo::writeAndroidBitcodeWrapper(
-      &wrapper, Bitcode.str().length(), getTargetAPI(),
+      &wrapper, BitcodeSize, getTargetAPI(),
       SlangVersion::CURRENT, mCodeGenOpts.OptimizationLevel);
 
-  slangAssert(actualWrapperLen > 0);
-
-  // Write out the bitcode wrapper.
-  FormattedOutStream.write(reinterpret_cast<char*>(&wrapper), actualWrapperLen);
+  slangAssert(actualWrapperLen == sizeof(wrapper));
+
+  if (mBackendOpts.EmitBitcodeIndex) {
+    // The bitcode ends on a 32-bit boundary, and so does the index.
+    slangAssert(mpOS->tell() == WrapperOffset + actualWrapperLen + BitcodeSize);
+    BitcodeIndex Index;
+    llvm::StringRef Bitcode(mpOS->str().data() + WrapperOffset +
+                            actualWrapperLen, BitcodeSize);
+    if (Index.build(Bitcode, *mpModule)) {
+      Index.write(*mpOS);
+      // See BitcodeIndex for why the flag goes in the Version field.
+      wrapper.Version |= BitcodeIndex::kWrapperFlag;
+    } else {
+      // Fail the compilation rather than write the bitcode unindexed.
+      mDiagEngine.Report(mDiagEngine.getCustomDiagID(
+          clang::DiagnosticsEngine::Error,
+          "unable to index the bitcode written (-bitcode-index)"));
+    }
+  }
 
-  // Write out the actual encoded bitcode.
-  FormattedOutStream << Bitcode.str();
+  // Overwrite the placeholder in the output buffer.
+  std::string &Output = mpOS->str();
+  slangAssert(Output.size() >= WrapperOffset + actualWrapperLen + BitcodeSize);
+  Output.replace(WrapperOffset, actualWrapperLen,
+                 reinterpret_cast<char*>(&wrapper), actualWrapperLen);
 }
 
 bool Backend::HandleTopLevelDecl(clang::DeclGroupRef D) {
+  PhaseTimer Timer(mPhaseReport, PhaseReport::PH_IRGen);
   return mGen->HandleTopLevelDecl(D);
 }
 
 void Backend::HandleTranslationUnit(clang::ASTContext &Ctx) {
   HandleTranslationUnitPre(Ctx);
 
-  mGen->HandleTranslationUnit(Ctx);
+  {
+    PhaseTimer Timer(mPhaseReport, PhaseReport::PH_IRGen);
+    mGen->HandleTranslationUnit(Ctx);
+  }
 
   // Here, we complete a translation unit (whole translation unit is now in LLVM
   // IR). Now, interact with LLVM backend to generate actual machine code (asm
@@ -301,6 +368,8 @@ void Backend::HandleTranslationUnit(clang::ASTContext &Ctx) {
   // Create and run per-function passes
   CreateFunctionPasses();
   if (mPerFunctionPasses) {
+    PhaseTimer Timer(mPhaseReport, PhaseReport::PH_FunctionPasses);
+
     mPerFunctionPasses->doInitialization();
 
     for (llvm::Module::iterator I = mpModule->begin(), E = mpModule->end();
@@ -314,8 +383,10 @@ void Backend::HandleTranslationUnit(clang::ASTContext &Ctx) {
 
   // Create and run module passes
   CreateModulePasses();
-  if (mPerModulePasses)
+  if (mPerModulePasses) {
+    PhaseTimer Timer(mPhaseReport, PhaseReport::PH_ModulePasses);
     mPerModulePasses->run(*mpModule);
+  }
 
   switch (mOT) {
     case Slang::OT_Assembly:
@@ -323,6 +394,7 @@ void Backend::HandleTranslationUnit(clang::ASTContext &Ctx) {
       if (!CreateCodeGenPasses())
         return;
 
+      PhaseTimer Timer(mPhaseReport, PhaseReport::PH_CodeEmission);
       mCodeGenPasses->doInitialization();
 
       for (llvm::Module::iterator I = mpModule->begin(), E = mpModule->end();
@@ -335,6 +407,7 @@ void Backend::HandleTranslationUnit(clang::ASTContext &Ctx) {
       break;
     }
     case Slang::OT_LLVMAssembly: {
+      PhaseTimer Timer(mPhaseReport, PhaseReport::PH_CodeEmission);
       llvm::PassManager *LLEmitPM = new llvm::PassManager();
       LLEmitPM->add(llvm::createPrintModulePass(FormattedOutStream));
       LLEmitPM->run(*mpModule);
@@ -342,8 +415,8 @@ void Backend::HandleTranslationUnit(clang::ASTContext &Ctx) {
     }
     case Slang::OT_Bitcode: {
       llvm::PassManager *BCEmitPM = new llvm::PassManager();
-      std::string BCStr;
-      llvm::raw_string_ostream Bitcode(BCStr);
+      uint64_t WrapperOffset = ReserveBitcodeWrapper();
+      llvm::raw_ostream &Bitcode = *mpOS;
       unsigned int TargetAPI = getTargetAPI();
       switch (TargetAPI) {
         case SLANG_HC_TARGET_API:
@@ -367,14 +440,27 @@ void Backend::HandleTranslationUnit(clang::ASTContext &Ctx) {
           }
           // Switch to the 3.2 BitcodeWriter by default, and don't use
           // LLVM's included BitcodeWriter at all (for now).
-          BCEmitPM->add(llvm_3_2::createBitcodeWriterPass(Bitcode));
+          BCEmitPM->add(llvm_3_2::createBitcodeWriterPass(
+              Bitcode, mBackendOpts.OptimizeBitcodeSize,
+              mBackendOpts.BitcodeWriterThreads));
           //BCEmitPM->add(llvm::createBitcodeWriterPass(Bitcode));
           break;
         }
       }
 
-      BCEmitPM->run(*mpModule);
-      WrapBitcode(Bitcode);
+      {
+        PhaseTimer Timer(mPhaseReport, PhaseReport::PH_BitcodeWriting);
+        BCEmitPM->run(*mpModule);
+      }
+      uint64_t BitcodeSize = mpOS->tell() - WrapperOffset -
+                             sizeof(bcinfo::AndroidBitcodeWrapper);
+      if (mPhaseReport != NULL) {
+        mPhaseReport->recordSize("bitcode-buffer", BitcodeSize);
+      }
+      {
+        PhaseTimer Timer(mPhaseReport, PhaseReport::PH_WrapBitcode);
+        WrapBitcode(WrapperOffset, BitcodeSize);
+      }
       break;
     }
     case Slang::OT_Nothing: {
@@ -389,10 +475,12 @@ void Backend::HandleTranslationUnit(clang::ASTContext &Ctx) {
 }
 
 void Backend::HandleTagDeclDefinition(clang::TagDecl *D) {
+  PhaseTimer Timer(mPhaseReport, PhaseReport::PH_IRGen);
   mGen->HandleTagDeclDefinition(D);
 }
 
 void Backend::CompleteTentativeDefinition(clang::VarDecl *D) {
+  PhaseTimer Timer(mPhaseReport, PhaseReport::PH_IRGen);
   mGen->CompleteTentativeDefinition(D);
 }
 
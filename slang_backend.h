@@ -50,8 +50,9 @@ class Backend : public clang::ASTConsumer {
 
   llvm::Module *mpModule;
 
-  // Output stream
-  llvm::raw_ostream *mpOS;
+  // Output stream. The output is rendered in memory (see Slang::compile()),
+  // which lets WrapBitcode() fill in the wrapper after the bitcode.
+  llvm::raw_string_ostream *mpOS;
   Slang::OutputType mOT;
 
   // This helps us translate Clang AST using into LLVM IR
@@ -68,19 +69,41 @@ class Backend : public clang::ASTConsumer {
 
   llvm::formatted_raw_ostream FormattedOutStream;
 
+  // Accounts the time spent in each phase (may be NULL)
+  PhaseReport *mPhaseReport;
+
   void CreateFunctionPasses();
   void CreateModulePasses();
   bool CreateCodeGenPasses();
 
-  void WrapBitcode(llvm::raw_string_ostream &Bitcode);
+  // Reserve room for the wrapper of the bitcode in the output, and return its
+  // offset. The bitcode is then written right after it.
+  uint64_t ReserveBitcodeWrapper();
+  // Fill in the wrapper reserved at WrapperOffset, for BitcodeSize bytes of
+  // bitcode. If mBackendOpts.EmitBitcodeIndex is set, the index of the bitcode is
+  // appended after it, and flagged in the wrapper (an error is reported if the
+  // bitcode cannot be indexed).
+  void WrapBitcode(uint64_t WrapperOffset, uint64_t BitcodeSize);
 
  protected:
   llvm::LLVMContext &mLLVMContext;
   clang::DiagnosticsEngine &mDiagEngine;
   const clang::CodeGenOptions &mCodeGenOpts;
+  const BackendOptions mBackendOpts;
+
+  // The optimization level of the function and module passes, and whether
+  // they unroll and vectorize loops. They come from mCodeGenOpts, but a
+  // subclass may raise them for some functions in HandleTranslationUnitPost(),
+  // e.g. with optnone on the others.
+  unsigned mOptimizationLevel;
+  bool mUnrollLoops;
+  bool mVectorizeLoop;
+  bool mVectorizeSLP;
 
   PragmaList *mPragmas;
 
+  PhaseReport *getPhaseReport() const { return mPhaseReport; }
+
   virtual unsigned int getTargetAPI() const {
     return SLANG_MAXIMUM_TARGET_API;
   }
@@ -99,12 +122,15 @@ class Backend : public clang::ASTConsumer {
   virtual void HandleTranslationUnitPost(llvm::Module *M) { }
 
  public:
-  Backend(clang::DiagnosticsEngine *DiagEngine,
+  Backend(llvm::LLVMContext &LLVMContext,
+          clang::DiagnosticsEngine *DiagEngine,
           const clang::CodeGenOptions &CodeGenOpts,
           const clang::TargetOptions &TargetOpts,
           PragmaList *Pragmas,
-          llvm::raw_ostream *OS,
-          Slang::OutputType OT);
+          llvm::raw_string_ostream *OS,
+          Slang::OutputType OT,
+          PhaseReport *Report,
+          const BackendOptions &BackendOpts);
 
   // Initialize - This is called to initialize the consumer, providing the
   // ASTContext.
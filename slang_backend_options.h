@@ -0,0 +1,71 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_BACKEND_OPTIONS_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SLANG_BACKEND_OPTIONS_H_
+
+#include <cstddef>
+#include <string>
+
+namespace slang {
+
+class Profile;
+
+// The options of the Backend that are not part of the clang CodeGenOptions:
+// how the bitcode is written and how the script is instrumented or optimized
+// from a profile. They are set once per compilation (see
+// Slang::setBackendOptions()), except for ScriptName which names each input.
+struct BackendOptions {
+  // Use the size-optimized encoding of the 3.2 bitcode writer (-Os-bitcode).
+  bool OptimizeBitcodeSize;
+
+  // Strip what the runtime does not read from the module before writing it
+  // (-strip-bitcode, see StripBitcode).
+  bool StripBitcode;
+
+  // Append the index of the blocks of the bitcode after it (-bitcode-index,
+  // see BitcodeIndex).
+  bool EmitBitcodeIndex;
+
+  // The number of threads encoding the function bodies in the 3.2 bitcode
+  // writer. 0 lets the writer pick one from the size of the module and the
+  // cores of the host.
+  unsigned BitcodeWriterThreads;
+
+  // The name of the script in the profiles (the stem of the input file).
+  std::string ScriptName;
+
+  // Instrument the script to count the executions of its blocks
+  // (-fprofile-generate).
+  bool ProfileGenerate;
+
+  // The profile guiding the optimization (-fprofile-use, not owned). NULL if
+  // none.
+  const Profile *ProfileUse;
+
+  BackendOptions()
+      : OptimizeBitcodeSize(false),
+        StripBitcode(false),
+        EmitBitcodeIndex(false),
+        BitcodeWriterThreads(0),
+        ProfileGenerate(false),
+        ProfileUse(NULL) {
+  }
+};
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_BACKEND_OPTIONS_H_  NOLINT
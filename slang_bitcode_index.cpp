@@ -0,0 +1,248 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "slang_bitcode_index.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Bitcode/BitstreamReader.h"
+#include "llvm/Bitcode/LLVMBitCodes.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "slang_assert.h"
+
+namespace slang {
+
+namespace {
+
+const char *getBlockName(unsigned BlockID) {
+  switch (BlockID) {
+    case llvm::bitc::BLOCKINFO_BLOCK_ID: return "BLOCKINFO_BLOCK";
+    case llvm::bitc::PARAMATTR_BLOCK_ID: return "PARAMATTR_BLOCK";
+    case llvm::bitc::PARAMATTR_GROUP_BLOCK_ID: return "PARAMATTR_GROUP_BLOCK";
+    case llvm::bitc::CONSTANTS_BLOCK_ID: return "CONSTANTS_BLOCK";
+    case llvm::bitc::VALUE_SYMTAB_BLOCK_ID: return "VALUE_SYMTAB_BLOCK";
+    case llvm::bitc::METADATA_BLOCK_ID: return "METADATA_BLOCK";
+    case llvm::bitc::METADATA_ATTACHMENT_ID: return "METADATA_ATTACHMENT";
+    case llvm::bitc::TYPE_BLOCK_ID_NEW: return "TYPE_BLOCK";
+    case llvm::bitc::USELIST_BLOCK_ID: return "USELIST_BLOCK";
+    default: return "";
+  }
+}
+
+void writeWord(llvm::raw_ostream &OS, uint64_t Word) {
+  slangAssert(Word <= 0xffffffffULL && "Bitcode index field overflow");
+  char Bytes[4] = {
+    static_cast<char>(Word & 0xff),
+    static_cast<char>((Word >> 8) & 0xff),
+    static_cast<char>((Word >> 16) & 0xff),
+    static_cast<char>((Word >> 24) & 0xff)
+  };
+  OS.write(Bytes, sizeof(Bytes));
+}
+
+// Read the 32-bit word at Data[Offset], advancing Offset. Returns false past
+// the end of Data.
+bool readWord(llvm::StringRef Data, size_t *Offset, uint32_t *Word) {
+  if (Data.size() < *Offset + 4)
+    return false;
+  const unsigned char *Bytes =
+      reinterpret_cast<const unsigned char*>(Data.data() + *Offset);
+  *Word = Bytes[0] | (Bytes[1] << 8) | (Bytes[2] << 16) |
+          (static_cast<uint32_t>(Bytes[3]) << 24);
+  *Offset += 4;
+  return true;
+}
+
+}  // namespace
+
+bool BitcodeIndex::indexMetadataBlock(llvm::BitstreamCursor &Stream) {
+  llvm::SmallVector<uint64_t, 64> Record;
+  while (true) {
+    uint64_t RecordBit = Stream.GetCurrentBitNo();
+    llvm::BitstreamEntry E = Stream.advance();
+    switch (E.Kind) {
+      case llvm::BitstreamEntry::Error: {
+        return false;
+      }
+      case llvm::BitstreamEntry::EndBlock: {
+        return true;
+      }
+      case llvm::BitstreamEntry::SubBlock: {
+        if (Stream.SkipBlock())
+          return false;
+        break;
+      }
+      case llvm::BitstreamEntry::Record: {
+        Record.clear();
+        if (Stream.readRecord(E.ID, Record) != llvm::bitc::METADATA_NAME)
+          break;
+        std::string Name(Record.begin(), Record.end());
+        if (llvm::StringRef(Name).startswith("#rs_export_")) {
+          Entry NamedMetadata;
+          NamedMetadata.Kind = EK_NamedMetadata;
+          NamedMetadata.BlockID = llvm::bitc::METADATA_BLOCK_ID;
+          NamedMetadata.BitOffset = RecordBit;
+          NamedMetadata.BitSize = Stream.GetCurrentBitNo() - RecordBit;
+          NamedMetadata.Name = Name;
+          mEntries.push_back(NamedMetadata);
+        }
+        break;
+      }
+    }
+  }
+}
+
+bool BitcodeIndex::build(llvm::StringRef Bitcode, const llvm::Module &M) {
+  mEntries.clear();
+
+  // The function blocks come in the order of the function definitions.
+  std::vector<const llvm::Function*> Definitions;
+  for (llvm::Module::const_iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    if (!I->isDeclaration())
+      Definitions.push_back(I);
+  }
+  unsigned NumFunctionBlocks = 0;
+
+  const unsigned char *Start =
+      reinterpret_cast<const unsigned char*>(Bitcode.data());
+  llvm::BitstreamReader Reader(Start, Start + Bitcode.size());
+  llvm::BitstreamCursor Stream(Reader);
+
+  if (Bitcode.size() < 4 ||
+      Stream.Read(8) != 'B' || Stream.Read(8) != 'C' ||
+      Stream.Read(4) != 0x0 || Stream.Read(4) != 0xC ||
+      Stream.Read(4) != 0xE || Stream.Read(4) != 0xD)
+    return false;
+
+  llvm::BitstreamEntry E = Stream.advance();
+  if (E.Kind != llvm::BitstreamEntry::SubBlock ||
+      E.ID != llvm::bitc::MODULE_BLOCK_ID ||
+      Stream.EnterSubBlock(llvm::bitc::MODULE_BLOCK_ID))
+    return false;
+
+  while (true) {
+    E = Stream.advance();
+    switch (E.Kind) {
+      case llvm::BitstreamEntry::Error: {
+        return false;
+      }
+      case llvm::BitstreamEntry::EndBlock: {
+        return NumFunctionBlocks == Definitions.size();
+      }
+      case llvm::BitstreamEntry::Record: {
+        Stream.skipRecord(E.ID);
+        break;
+      }
+      case llvm::BitstreamEntry::SubBlock: {
+        Entry Block;
+        Block.BlockID = E.ID;
+        Block.BitOffset = Stream.GetCurrentBitNo();
+        if (E.ID == llvm::bitc::FUNCTION_BLOCK_ID) {
+          if (NumFunctionBlocks == Definitions.size())
+            return false;
+          Block.Kind = EK_FunctionBlock;
+          Block.Name = Definitions[NumFunctionBlocks++]->getName();
+        } else {
+          Block.Kind = EK_ModuleBlock;
+          Block.Name = getBlockName(E.ID);
+        }
+
+        // The named metadata go after the block holding them.
+        size_t BlockEntry = mEntries.size();
+        mEntries.push_back(Block);
+        if (E.ID == llvm::bitc::METADATA_BLOCK_ID) {
+          if (Stream.EnterSubBlock(E.ID) || !indexMetadataBlock(Stream))
+            return false;
+        } else if (Stream.SkipBlock()) {
+          return false;
+        }
+        mEntries[BlockEntry].BitSize =
+            Stream.GetCurrentBitNo() - mEntries[BlockEntry].BitOffset;
+        break;
+      }
+    }
+  }
+}
+
+void BitcodeIndex::write(llvm::raw_ostream &OS) const {
+  std::string Strings;
+  for (unsigned i = 0, e = mEntries.size(); i != e; i++)
+    Strings.append(mEntries[i].Name);
+  Strings.resize((Strings.size() + 3) & ~3, '\0');
+
+  writeWord(OS, kMagic);
+  writeWord(OS, kVersion);
+  writeWord(OS, mEntries.size());
+  writeWord(OS, Strings.size());
+
+  uint64_t NameOffset = 0;
+  for (unsigned i = 0, e = mEntries.size(); i != e; i++) {
+    const Entry &Ent = mEntries[i];
+    writeWord(OS, Ent.Kind);
+    writeWord(OS, Ent.BlockID);
+    writeWord(OS, Ent.BitOffset);
+    writeWord(OS, Ent.BitSize);
+    writeWord(OS, NameOffset);
+    writeWord(OS, Ent.Name.size());
+    NameOffset += Ent.Name.size();
+  }
+
+  OS << Strings;
+}
+
+bool BitcodeIndex::read(llvm::StringRef Data) {
+  mEntries.clear();
+
+  size_t Offset = 0;
+  uint32_t Magic, Version, NumEntries, StringsSize;
+  if (!readWord(Data, &Offset, &Magic) || (Magic != kMagic) ||
+      !readWord(Data, &Offset, &Version) || (Version != kVersion) ||
+      !readWord(Data, &Offset, &NumEntries) ||
+      !readWord(Data, &Offset, &StringsSize))
+    return false;
+
+  // The string table follows the entries (6 words each).
+  uint64_t StringsOffset = Offset + uint64_t(NumEntries) * 6 * 4;
+  if (Data.size() < StringsOffset + StringsSize)
+    return false;
+  llvm::StringRef Strings = Data.substr(StringsOffset, StringsSize);
+
+  for (uint32_t i = 0; i != NumEntries; i++) {
+    uint32_t Kind, BlockID, BitOffset, BitSize, NameOffset, NameSize;
+    if (!readWord(Data, &Offset, &Kind) ||
+        !readWord(Data, &Offset, &BlockID) ||
+        !readWord(Data, &Offset, &BitOffset) ||
+        !readWord(Data, &Offset, &BitSize) ||
+        !readWord(Data, &Offset, &NameOffset) ||
+        !readWord(Data, &Offset, &NameSize) ||
+        (Kind > EK_NamedMetadata) ||
+        (uint64_t(NameOffset) + NameSize > Strings.size()))
+      return false;
+
+    Entry Ent;
+    Ent.Kind = static_cast<EntryKind>(Kind);
+    Ent.BlockID = BlockID;
+    Ent.BitOffset = BitOffset;
+    Ent.BitSize = BitSize;
+    Ent.Name = Strings.substr(NameOffset, NameSize);
+    mEntries.push_back(Ent);
+  }
+
+  return true;
+}
+
+}  // namespace slang
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_BITCODE_INDEX_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SLANG_BITCODE_INDEX_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+
+namespace llvm {
+  class BitstreamCursor;
+  class Module;
+  class raw_ostream;
+}
+
+namespace slang {
+
+// Index of the blocks of a bitcode module, appended after the bitcode in the
+// output (-bitcode-index) so that the runtime can load the export metadata
+// and the function bodies without scanning the whole bitcode.
+//
+// The index is only there when kWrapperFlag is set in the Version field of
+// the AndroidBitcodeWrapper. Readers unaware of it find the bitcode through
+// the BitcodeOffset and BitcodeSize fields of the wrapper, and never look
+// past it.
+//
+// The flag is a bit of Version rather than a new field of the wrapper
+// (bcinfo/BitcodeWrapper.h): the wrapper has a fixed size that every runtime
+// and LLVM's SkipBitcodeWrapperHeader() rely on, while Version has always
+// been written as 0 and is not interpreted by any of them. Readers must still
+// check that the index starts with kMagic before using it, should a future
+// wrapper give Version a meaning.
+//
+// Layout (all the fields are 32-bit little-endian words):
+//
+//   Header:  kMagic, kVersion, <number of entries>, <string table size>
+//   Entries: <kind>, <block id>, <bit offset>, <size in bits>,
+//            <name offset>, <name size>
+//   The string table holding the names, padded to 32 bits.
+//
+// The offsets are in bits from the start of the bitcode (the first byte
+// after the wrapper). For a block, it is the position right after its
+// ENTER_SUBBLOCK abbrev id and block id, which is what the LLVM reader
+// remembers of the function blocks it loads lazily: a reader jumps there and
+// enters the block. For a named metadata, it is the position of its
+// METADATA_NAME record in the module METADATA_BLOCK (which defines the
+// abbrevs in use there).
+class BitcodeIndex {
+ public:
+  static const uint32_t kWrapperFlag = 0x1;
+  static const uint32_t kMagic = 0x49425352;  // "RSBI"
+  static const uint32_t kVersion = 1;
+
+  enum EntryKind {
+    // A block nested in the MODULE_BLOCK other than a function body, named
+    // after its block id (e.g. METADATA_BLOCK).
+    EK_ModuleBlock = 0,
+    // A function body, named after the function.
+    EK_FunctionBlock = 1,
+    // One of the #rs_export_* named metadata.
+    EK_NamedMetadata = 2
+  };
+
+  struct Entry {
+    EntryKind Kind;
+    unsigned BlockID;
+    uint64_t BitOffset;
+    uint64_t BitSize;
+    std::string Name;
+  };
+
+ private:
+  std::vector<Entry> mEntries;
+
+  // Record the #rs_export_* named metadata of the METADATA_BLOCK Stream just
+  // entered.
+  bool indexMetadataBlock(llvm::BitstreamCursor &Stream);
+
+ public:
+  // Index Bitcode, written from M (which names its function blocks). Returns
+  // false if Bitcode can not be parsed.
+  bool build(llvm::StringRef Bitcode, const llvm::Module &M);
+
+  const std::vector<Entry> &getEntries() const { return mEntries; }
+
+  // Append the index to OS.
+  void write(llvm::raw_ostream &OS) const;
+
+  // Read back an index written by write() at the start of Data (the bytes
+  // following the bitcode). Returns false if Data does not hold one.
+  bool read(llvm::StringRef Data);
+};
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_BITCODE_INDEX_H_  NOLINT
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "slang_dependency_recorder.h"
+
+#include <string>
+#include <vector>
+
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/SourceManager.h"
+
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace slang {
+
+namespace {
+
+// Escape the special characters of Filename for make.
+void PrintFilename(llvm::raw_ostream &OS, llvm::StringRef Filename) {
+  for (unsigned i = 0, e = Filename.size(); i != e; ++i) {
+    if (Filename[i] == ' ' || Filename[i] == '#')
+      OS << '\\';
+    else if (Filename[i] == '$')  // $ is escaped by $$.
+      OS << '$';
+    OS << Filename[i];
+  }
+}
+
+}  // namespace
+
+DependencyRecorder::DependencyRecorder(clang::SourceManager &SourceMgr,
+                                       DependencyList *Dependencies)
+    : PPCallbacks(),
+      mSourceMgr(SourceMgr),
+      mDependencies(Dependencies) {
+}
+
+void DependencyRecorder::FileChanged(clang::SourceLocation Loc,
+                                     FileChangeReason Reason,
+                                     clang::SrcMgr::CharacteristicKind FileType,
+                                     clang::FileID PrevFID) {
+  if (Reason != clang::PPCallbacks::EnterFile)
+    return;
+
+  const clang::FileEntry *FE = mSourceMgr.getFileEntryForID(
+      mSourceMgr.getFileID(mSourceMgr.getExpansionLoc(Loc)));
+  if (FE == NULL)
+    return;
+
+  llvm::StringRef Filename = FE->getName();
+
+  // Remove leading "./" (or ".//" or "././" etc.)
+  while ((Filename.size() > 2) && (Filename[0] == '.') &&
+         llvm::sys::path::is_separator(Filename[1])) {
+    Filename = Filename.substr(1);
+    while (llvm::sys::path::is_separator(Filename[0]))
+      Filename = Filename.substr(1);
+  }
+
+  if (mSeen.insert(Filename))
+    mDependencies->push_back(Filename.str());
+}
+
+void DependencyRecorder::WriteDependencyFile(
+    llvm::raw_ostream &OS,
+    const std::vector<std::string> &Targets,
+    const DependencyList &Dependencies) {
+  // Write out the dependency targets, trying to avoid overly long lines when
+  // possible. We try our best to emit exactly the same dependency file as
+  // clang's DependencyFileGenerator.
+  const unsigned MaxColumns = 75;
+  unsigned Columns = 0;
+
+  for (std::vector<std::string>::const_iterator I = Targets.begin(),
+           E = Targets.end();
+       I != E;
+       I++) {
+    unsigned N = I->length();
+    if (Columns == 0) {
+      Columns += N;
+    } else if (Columns + N + 2 > MaxColumns) {
+      Columns = N + 2;
+      OS << " \\\n  ";
+    } else {
+      Columns += N + 1;
+      OS << ' ';
+    }
+    // Targets already quoted as needed.
+    OS << *I;
+  }
+
+  OS << ':';
+  Columns += 1;
+
+  for (DependencyList::const_iterator I = Dependencies.begin(),
+           E = Dependencies.end();
+       I != E;
+       I++) {
+    // Start a new line if this would exceed the column limit. Make sure to
+    // leave space for a trailing " \" in case we need to break the line on the
+    // next iteration.
+    unsigned N = I->length();
+    if (Columns + (N + 1) + 2 > MaxColumns) {
+      OS << " \\\n ";
+      Columns = 2;
+    }
+    OS << ' ';
+    PrintFilename(OS, *I);
+    Columns += N + 1;
+  }
+  OS << '\n';
+}
+
+}  // namespace slang
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_DEPENDENCY_RECORDER_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SLANG_DEPENDENCY_RECORDER_H_
+
+#include <string>
+#include <vector>
+
+#include "clang/Lex/PPCallbacks.h"
+
+#include "llvm/ADT/StringSet.h"
+
+namespace clang {
+  class SourceManager;
+}
+
+namespace llvm {
+  class raw_ostream;
+}
+
+namespace slang {
+
+// The files entered by the preprocessor, in the order they were first seen.
+typedef std::vector<std::string> DependencyList;
+
+// Records the dependencies of a translation unit while it is being
+// preprocessed, so that the .d file can be written once the compilation (and
+// the reflection, whose outputs are targets of the .d file) is done.
+class DependencyRecorder : public clang::PPCallbacks {
+ private:
+  clang::SourceManager &mSourceMgr;
+  DependencyList *mDependencies;
+  llvm::StringSet<> mSeen;
+
+ public:
+  DependencyRecorder(clang::SourceManager &SourceMgr,
+                     DependencyList *Dependencies);
+
+  virtual void FileChanged(clang::SourceLocation Loc,
+                           FileChangeReason Reason,
+                           clang::SrcMgr::CharacteristicKind FileType,
+                           clang::FileID PrevFID);
+
+  // Write the Makefile rule "Targets: Dependencies" to OS. The output is
+  // formatted the same way as the one of clang's DependencyFileGenerator.
+  static void WriteDependencyFile(llvm::raw_ostream &OS,
+                                  const std::vector<std::string> &Targets,
+                                  const DependencyList &Dependencies);
+};
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_DEPENDENCY_RECORDER_H_  NOLINT
@@ -56,6 +56,12 @@ class DiagnosticBuffer : public clang::DiagnosticConsumer {
   inline void reset() {
     this->mSOS->str().clear();
   }
+
+  // Add diagnostics printed by an earlier compilation (e.g. restored from the
+  // compilation cache).
+  inline void append(llvm::StringRef Diags) {
+    *mSOS << Diags;
+  }
 };
 
 }  // namespace slang
@@ -0,0 +1,229 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "slang_file_cache.h"
+
+#include <string>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Twine.h"
+
+namespace slang {
+
+namespace {
+
+// A view of the cached contents of a file, keeping them alive.
+class SharedMemoryBuffer : public llvm::MemoryBuffer {
+ private:
+  std::shared_ptr<llvm::MemoryBuffer> mContents;
+  std::string mName;
+
+ public:
+  SharedMemoryBuffer(const std::shared_ptr<llvm::MemoryBuffer> &Contents,
+                     const llvm::Twine &Name)
+      : mContents(Contents), mName(Name.str()) {
+    // The cached contents are always read with a null terminator.
+    init(mContents->getBufferStart(), mContents->getBufferEnd(),
+         /* RequiresNullTerminator = */true);
+  }
+
+  virtual const char *getBufferIdentifier() const { return mName.c_str(); }
+
+  virtual BufferKind getBufferKind() const {
+    return mContents->getBufferKind();
+  }
+};
+
+// A file opened through the FileCache.
+class CachedFile : public clang::vfs::File {
+ private:
+  clang::vfs::Status mStatus;
+  std::shared_ptr<llvm::MemoryBuffer> mContents;
+
+ public:
+  CachedFile(const clang::vfs::Status &Status,
+             const std::shared_ptr<llvm::MemoryBuffer> &Contents)
+      : mStatus(Status), mContents(Contents) { }
+
+  virtual llvm::ErrorOr<clang::vfs::Status> status() { return mStatus; }
+
+  virtual llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+      getBuffer(const llvm::Twine &Name, int64_t FileSize,
+                bool RequiresNullTerminator, bool IsVolatile) {
+    return std::unique_ptr<llvm::MemoryBuffer>(
+        new SharedMemoryBuffer(mContents, Name));
+  }
+
+  virtual std::error_code close() {
+    mContents.reset();
+    return std::error_code();
+  }
+
+  virtual void setName(llvm::StringRef Name) { mStatus.setName(Name); }
+};
+
+}  // namespace
+
+FileCache::FileCache(llvm::IntrusiveRefCntPtr<clang::vfs::FileSystem> FS)
+    : mFS(FS), mGeneration(1), mContentsSize(0) {
+  if (!mFS)
+    mFS = clang::vfs::getRealFileSystem();
+}
+
+FileCache::Entry &FileCache::lookup(llvm::StringRef Path) {
+  Entry &E = mEntries[Path];
+  if (E.Generation == mGeneration)
+    return E;
+
+  llvm::ErrorOr<clang::vfs::Status> Status = mFS->status(Path);
+  if (!Status) {
+    E.Error = Status.getError();
+    dropContents(E);
+  } else {
+    if (E.Error ||
+        (Status->getSize() != E.Status.getSize()) ||
+        (Status->getLastModificationTime() !=
+         E.Status.getLastModificationTime()) ||
+        (E.Contents && contentsChanged(Path, E))) {
+      dropContents(E);
+    }
+    E.Error = std::error_code();
+    E.Status = Status.get();
+  }
+  E.Generation = mGeneration;
+  return E;
+}
+
+bool FileCache::contentsChanged(llvm::StringRef Path, Entry &E) {
+  llvm::sys::TimeValue Granularity(kMTimeGranularity, 0);
+  if (E.Status.getLastModificationTime() + Granularity <= E.ContentsTime)
+    return false;
+
+  // Take the time first: an edit made while reading is caught next time.
+  llvm::sys::TimeValue Now = llvm::sys::TimeValue::now();
+  llvm::ErrorOr<std::unique_ptr<clang::vfs::File>> F =
+      mFS->openFileForRead(Path);
+  if (!F)
+    return true;
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Contents =
+      F.get()->getBuffer(Path, E.Status.getSize());
+  F.get()->close();
+  if (!Contents ||
+      (Contents.get()->getBuffer() != E.Contents->getBuffer()))
+    return true;
+  E.ContentsTime = Now;
+  return false;
+}
+
+void FileCache::setContents(Entry &E, llvm::MemoryBuffer *Contents) {
+  dropContents(E);
+  E.Contents.reset(Contents);
+  E.LRUPos = mContentsLRU.insert(mContentsLRU.begin(), &E);
+  mContentsSize += Contents->getBufferSize();
+
+  // The buffers already handed out stay valid, they share the contents.
+  while ((mContentsSize > kMaxContentsSize) &&
+         (mContentsLRU.back() != &E)) {
+    dropContents(*mContentsLRU.back());
+  }
+}
+
+void FileCache::dropContents(Entry &E) {
+  if (!E.Contents)
+    return;
+  mContentsSize -= E.Contents->getBufferSize();
+  mContentsLRU.erase(E.LRUPos);
+  E.Contents.reset();
+}
+
+llvm::ErrorOr<clang::vfs::Status> FileCache::status(const llvm::Twine &Path) {
+  llvm::SmallString<256> PathStorage;
+  llvm::StringRef P = Path.toStringRef(PathStorage);
+
+  llvm::sys::ScopedLock Lock(mLock);
+  Entry &E = lookup(P);
+  if (E.Error)
+    return E.Error;
+  return E.Status;
+}
+
+llvm::ErrorOr<std::unique_ptr<clang::vfs::File>>
+FileCache::openFileForRead(const llvm::Twine &Path) {
+  llvm::SmallString<256> PathStorage;
+  llvm::StringRef P = Path.toStringRef(PathStorage);
+
+  llvm::sys::ScopedLock Lock(mLock);
+  Entry &E = lookup(P);
+  if (E.Error)
+    return E.Error;
+
+  // Let the filesystem report the error.
+  if (E.Status.isDirectory())
+    return mFS->openFileForRead(P);
+
+  if (!E.Contents) {
+    llvm::sys::TimeValue Now = llvm::sys::TimeValue::now();
+    llvm::ErrorOr<std::unique_ptr<clang::vfs::File>> F =
+        mFS->openFileForRead(P);
+    if (!F)
+      return F.getError();
+
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Contents =
+        F.get()->getBuffer(P, E.Status.getSize());
+    F.get()->close();
+    if (!Contents)
+      return Contents.getError();
+    setContents(E, Contents.get().release());
+    E.ContentsTime = Now;
+  } else {
+    mContentsLRU.splice(mContentsLRU.begin(), mContentsLRU, E.LRUPos);
+  }
+
+  return std::unique_ptr<clang::vfs::File>(
+      new CachedFile(E.Status, E.Contents));
+}
+
+clang::vfs::directory_iterator FileCache::dir_begin(const llvm::Twine &Dir,
+                                                    std::error_code &EC) {
+  // Directory listings are not cached, they are not used to look up headers.
+  return mFS->dir_begin(Dir, EC);
+}
+
+void FileCache::revalidate() {
+  llvm::sys::ScopedLock Lock(mLock);
+  for (llvm::StringMap<Entry>::iterator I = mEntries.begin(),
+                                        E = mEntries.end();
+       I != E; ) {
+    llvm::StringMap<Entry>::iterator Cur = I++;
+    if (Cur->getValue().Generation != mGeneration) {
+      dropContents(Cur->getValue());
+      mEntries.erase(Cur);
+    }
+  }
+  mGeneration++;
+}
+
+void FileCache::invalidate(llvm::StringRef Path) {
+  llvm::sys::ScopedLock Lock(mLock);
+  llvm::StringMap<Entry>::iterator I = mEntries.find(Path);
+  if (I == mEntries.end())
+    return;
+  dropContents(I->getValue());
+  mEntries.erase(I);
+}
+
+}  // namespace slang
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_FILE_CACHE_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SLANG_FILE_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <system_error>
+
+#include "clang/Basic/VirtualFileSystem.h"
+
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/TimeValue.h"
+
+namespace slang {
+
+// A filesystem remembering the result of the lookups (stat of the files and
+// directories, including the missing ones) and the contents of the files read
+// through it, so that the FileManagers of many translation units (see
+// Slang::setFileCache()) don't go to the disk again for the same headers.
+//
+// The cached entries are trusted until revalidate() is called. From then on,
+// each entry is checked against the filesystem again the first time it is
+// looked up, and its contents are dropped if the modification time or the
+// size of the file changed. As an edit keeping the size within the
+// granularity of the modification times goes unnoticed, the contents read
+// less than kMTimeGranularity after the file was last modified are compared
+// with the file as well. revalidate() also forgets the entries that were
+// not looked up since the previous call, and the contents of the least
+// recently opened files are dropped once they take more than
+// kMaxContentsSize bytes, so that a long-running compile server does not
+// keep every file it ever read.
+//
+// The cache may be shared by Slang instances running on different threads.
+class FileCache : public clang::vfs::FileSystem {
+ private:
+  struct Entry {
+    // The generation this entry was last checked in (0 if never).
+    unsigned Generation;
+    // The result of the lookup, Status being valid only if Error is not set.
+    std::error_code Error;
+    clang::vfs::Status Status;
+    // The contents of the file, once read. Shared with the buffers handed to
+    // the SourceManagers, which may outlive the entry.
+    std::shared_ptr<llvm::MemoryBuffer> Contents;
+    // The position of the entry in mContentsLRU (only if Contents is set).
+    std::list<Entry *>::iterator LRUPos;
+    // When Contents were last known to match the file (only if Contents is
+    // set).
+    llvm::sys::TimeValue ContentsTime;
+
+    Entry() : Generation(0) { }
+  };
+
+  llvm::IntrusiveRefCntPtr<clang::vfs::FileSystem> mFS;
+
+  llvm::sys::Mutex mLock;
+  llvm::StringMap<Entry> mEntries;
+  unsigned mGeneration;
+
+  // The entries holding contents, the most recently opened first, and the
+  // total size of those contents.
+  std::list<Entry *> mContentsLRU;
+  size_t mContentsSize;
+
+  // Returns the entry of Path, checked in the current generation. mLock must
+  // be held.
+  Entry &lookup(llvm::StringRef Path);
+
+  // Returns true if the contents of E, whose file Path kept its size and
+  // modification time, differ from the file. They are only compared if they
+  // were read too soon after the file was modified for an edit to change the
+  // modification time, and their time is updated if they still match. mLock
+  // must be held.
+  bool contentsChanged(llvm::StringRef Path, Entry &E);
+
+  // Keep (resp. drop) the contents of E, accounting for them in
+  // mContentsLRU and mContentsSize. mLock must be held.
+  void setContents(Entry &E, llvm::MemoryBuffer *Contents);
+  void dropContents(Entry &E);
+
+ public:
+  // The size of the contents kept in the cache. It is only exceeded by a
+  // single file bigger than this.
+  static const size_t kMaxContentsSize = 32 * 1024 * 1024;
+
+  // The coarsest granularity of the modification times, in seconds (e.g. on
+  // FAT filesystems).
+  static const unsigned kMTimeGranularity = 2;
+
+  // Look up the files in FS (the real filesystem if NULL).
+  explicit FileCache(llvm::IntrusiveRefCntPtr<clang::vfs::FileSystem> FS =
+                         NULL);
+
+  virtual llvm::ErrorOr<clang::vfs::Status> status(const llvm::Twine &Path);
+
+  virtual llvm::ErrorOr<std::unique_ptr<clang::vfs::File>>
+      openFileForRead(const llvm::Twine &Path);
+
+  virtual clang::vfs::directory_iterator dir_begin(const llvm::Twine &Dir,
+                                                   std::error_code &EC);
+
+  // Check the cached entries against the filesystem again (e.g. between the
+  // requests of a compile server, as the files may have been edited), and
+  // forget those unused since the previous call.
+  void revalidate();
+
+  // Forget about Path (e.g. a file written by the compiler itself).
+  void invalidate(llvm::StringRef Path);
+};
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_FILE_CACHE_H_  NOLINT
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "slang_memory_file_system.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/TimeValue.h"
+
+namespace slang {
+
+namespace {
+
+// The device of the unique IDs given to the entries, distinct from the ones
+// of the real files the FileManager may see along with them.
+const uint64_t MemoryDeviceID = ~0ULL;
+
+// A file opened from a MemoryFileSystem.
+class MemoryFile : public clang::vfs::File {
+ private:
+  clang::vfs::Status mStatus;
+  std::string mContents;
+
+ public:
+  MemoryFile(const clang::vfs::Status &Status, llvm::StringRef Contents)
+      : mStatus(Status), mContents(Contents) { }
+
+  virtual llvm::ErrorOr<clang::vfs::Status> status() { return mStatus; }
+
+  virtual llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+      getBuffer(const llvm::Twine &Name, int64_t FileSize,
+                bool RequiresNullTerminator, bool IsVolatile) {
+    return std::unique_ptr<llvm::MemoryBuffer>(
+        llvm::MemoryBuffer::getMemBufferCopy(mContents, Name.str()));
+  }
+
+  virtual std::error_code close() { return std::error_code(); }
+
+  virtual void setName(llvm::StringRef Name) { mStatus.setName(Name); }
+};
+
+}  // namespace
+
+MemoryFileSystem::MemoryFileSystem() : mNextFileID(1) {
+}
+
+std::string MemoryFileSystem::NormalizePath(const llvm::Twine &Path) {
+  llvm::SmallString<256> AbsolutePath;
+  Path.toVector(AbsolutePath);
+  llvm::sys::fs::make_absolute(AbsolutePath);
+
+  // Drop the "." components and fold the ".." ones, without looking at the
+  // disk.
+  llvm::SmallVector<llvm::StringRef, 16> Components;
+  for (llvm::sys::path::const_iterator
+           I = llvm::sys::path::begin(AbsolutePath),
+           E = llvm::sys::path::end(AbsolutePath);
+       I != E;
+       ++I) {
+    if (*I == ".")
+      continue;
+    if (*I == "..") {
+      if (Components.size() > 1)
+        Components.pop_back();
+      continue;
+    }
+    Components.push_back(*I);
+  }
+
+  llvm::SmallString<256> Normalized;
+  for (unsigned i = 0, e = Components.size(); i != e; i++)
+    llvm::sys::path::append(Normalized, Components[i]);
+  return Normalized.str();
+}
+
+const MemoryFileSystem::Entry *
+MemoryFileSystem::lookup(const llvm::Twine &Path) const {
+  llvm::StringMap<Entry>::const_iterator I = mEntries.find(NormalizePath(Path));
+  return (I == mEntries.end()) ? NULL : &I->getValue();
+}
+
+void MemoryFileSystem::addEntry(const std::string &Path,
+                                llvm::StringRef Contents, bool IsDirectory) {
+  Entry &E = mEntries[Path];
+  E.Status = clang::vfs::Status(
+      Path,
+      llvm::sys::fs::UniqueID(MemoryDeviceID, mNextFileID++),
+      llvm::sys::TimeValue::now(),
+      /* User = */0,
+      /* Group = */0,
+      Contents.size(),
+      IsDirectory ? llvm::sys::fs::file_type::directory_file :
+                    llvm::sys::fs::file_type::regular_file,
+      llvm::sys::fs::all_read);
+  E.Contents = Contents;
+}
+
+void MemoryFileSystem::addFile(llvm::StringRef Path, llvm::StringRef Contents) {
+  std::string FilePath = NormalizePath(Path);
+  addEntry(FilePath, Contents, /* IsDirectory = */false);
+
+  for (llvm::StringRef Dir = llvm::sys::path::parent_path(FilePath);
+       !Dir.empty();
+       Dir = llvm::sys::path::parent_path(Dir)) {
+    if (mEntries.count(Dir))
+      break;
+    addEntry(Dir, "", /* IsDirectory = */true);
+  }
+}
+
+llvm::ErrorOr<clang::vfs::Status>
+MemoryFileSystem::status(const llvm::Twine &Path) {
+  const Entry *E = lookup(Path);
+  if (E == NULL)
+    return std::make_error_code(std::errc::no_such_file_or_directory);
+
+  clang::vfs::Status Status = E->Status;
+  Status.setName(Path.str());
+  return Status;
+}
+
+llvm::ErrorOr<std::unique_ptr<clang::vfs::File>>
+MemoryFileSystem::openFileForRead(const llvm::Twine &Path) {
+  const Entry *E = lookup(Path);
+  if (E == NULL)
+    return std::make_error_code(std::errc::no_such_file_or_directory);
+  if (E->Status.isDirectory())
+    return std::make_error_code(std::errc::is_a_directory);
+
+  clang::vfs::Status Status = E->Status;
+  Status.setName(Path.str());
+  return std::unique_ptr<clang::vfs::File>(
+      new MemoryFile(Status, E->Contents));
+}
+
+clang::vfs::directory_iterator
+MemoryFileSystem::dir_begin(const llvm::Twine &Dir, std::error_code &EC) {
+  // The headers are looked up by name, the directories are never listed.
+  EC = std::make_error_code(std::errc::operation_not_supported);
+  return clang::vfs::directory_iterator();
+}
+
+}  // namespace slang
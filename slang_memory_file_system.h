@@ -0,0 +1,75 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_MEMORY_FILE_SYSTEM_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SLANG_MEMORY_FILE_SYSTEM_H_
+
+#include <memory>
+#include <string>
+#include <system_error>
+
+#include "clang/Basic/VirtualFileSystem.h"
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/Twine.h"
+
+namespace slang {
+
+// A filesystem made of files kept in memory (e.g. the unsaved buffers of an
+// editor, or generated headers), along with the directories containing them.
+// Relative paths are resolved against the current directory, so that the
+// files are found through relative include paths as well.
+//
+// Nothing is ever read from the disk: looking up any other path fails, and
+// the next filesystem of an OverlayFileSystem is used instead.
+class MemoryFileSystem : public clang::vfs::FileSystem {
+ private:
+  struct Entry {
+    clang::vfs::Status Status;
+    // The contents of a file (empty for a directory).
+    std::string Contents;
+  };
+
+  llvm::StringMap<Entry> mEntries;
+  uint64_t mNextFileID;
+
+  static std::string NormalizePath(const llvm::Twine &Path);
+
+  const Entry *lookup(const llvm::Twine &Path) const;
+
+  void addEntry(const std::string &Path, llvm::StringRef Contents,
+                bool IsDirectory);
+
+ public:
+  MemoryFileSystem();
+
+  // Make Path read as Contents, replacing any earlier contents.
+  void addFile(llvm::StringRef Path, llvm::StringRef Contents);
+
+  virtual llvm::ErrorOr<clang::vfs::Status> status(const llvm::Twine &Path);
+
+  virtual llvm::ErrorOr<std::unique_ptr<clang::vfs::File>>
+      openFileForRead(const llvm::Twine &Path);
+
+  virtual clang::vfs::directory_iterator dir_begin(const llvm::Twine &Dir,
+                                                   std::error_code &EC);
+};
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_MEMORY_FILE_SYSTEM_H_  NOLINT
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "slang_output_sink.h"
+
+#include <memory>
+#include <string>
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+
+#include "slang_utils.h"
+
+namespace slang {
+
+namespace {
+
+class FileSystemOutputSink : public OutputSink {
+ public:
+  virtual bool writeFile(const std::string &Path, llvm::StringRef Contents,
+                         std::string *Error) {
+    llvm::StringRef Dir = llvm::sys::path::parent_path(Path);
+    if (!Dir.empty() && !SlangUtils::CreateDirectoryWithParents(Dir, Error))
+      return false;
+    if (!SlangUtils::WriteFileIfChanged(Path, Contents)) {
+      Error->assign("cannot write the file");
+      return false;
+    }
+    return true;
+  }
+
+  virtual bool readFile(const std::string &Path, std::string *Contents) {
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > MBOrErr =
+        llvm::MemoryBuffer::getFile(Path);
+    if (MBOrErr.getError())
+      return false;
+    Contents->assign(MBOrErr.get()->getBufferStart(),
+                     MBOrErr.get()->getBufferSize());
+    return true;
+  }
+
+  virtual void removeFile(const std::string &Path) {
+    llvm::sys::fs::remove(Path);
+  }
+};
+
+}  // namespace
+
+OutputSink::~OutputSink() {
+}
+
+OutputSink *OutputSink::getFileSystemSink() {
+  static FileSystemOutputSink Sink;
+  return &Sink;
+}
+
+std::pair<std::string, std::string> *
+MemoryOutputSink::lookup(llvm::StringRef Path) {
+  for (FileList::iterator I = mFiles.begin(), E = mFiles.end(); I != E; I++) {
+    if (I->first == Path)
+      return &*I;
+  }
+  return NULL;
+}
+
+bool MemoryOutputSink::writeFile(const std::string &Path,
+                                 llvm::StringRef Contents,
+                                 std::string *Error) {
+  std::pair<std::string, std::string> *File = lookup(Path);
+  if (File == NULL) {
+    mFiles.push_back(std::make_pair(Path, std::string()));
+    File = &mFiles.back();
+  }
+  File->second.assign(Contents.data(), Contents.size());
+  return true;
+}
+
+bool MemoryOutputSink::readFile(const std::string &Path,
+                                std::string *Contents) {
+  std::pair<std::string, std::string> *File = lookup(Path);
+  if (File == NULL)
+    return false;
+  *Contents = File->second;
+  return true;
+}
+
+void MemoryOutputSink::removeFile(const std::string &Path) {
+  for (FileList::iterator I = mFiles.begin(), E = mFiles.end(); I != E; I++) {
+    if (I->first == Path) {
+      mFiles.erase(I);
+      return;
+    }
+  }
+}
+
+const std::string *MemoryOutputSink::getFile(llvm::StringRef Path) const {
+  for (FileList::const_iterator I = mFiles.begin(), E = mFiles.end(); I != E;
+       I++) {
+    if (I->first == Path)
+      return &I->second;
+  }
+  return NULL;
+}
+
+bool DeferredOutputSink::writeFile(const std::string &Path,
+                                   llvm::StringRef Contents,
+                                   std::string *Error) {
+  Operation Op;
+  Op.Input = getCurrentInput();
+  Op.Path = Path;
+  Op.Remove = false;
+  Op.Contents.assign(Contents.data(), Contents.size());
+  mOperations.push_back(Op);
+  return true;
+}
+
+bool DeferredOutputSink::readFile(const std::string &Path,
+                                  std::string *Contents) {
+  for (std::vector<Operation>::const_reverse_iterator
+           I = mOperations.rbegin(), E = mOperations.rend();
+       I != E;
+       I++) {
+    if (I->Path != Path)
+      continue;
+    if (I->Remove)
+      return false;
+    *Contents = I->Contents;
+    return true;
+  }
+  return getFileSystemSink()->readFile(Path, Contents);
+}
+
+void DeferredOutputSink::removeFile(const std::string &Path) {
+  Operation Op;
+  Op.Input = getCurrentInput();
+  Op.Path = Path;
+  Op.Remove = true;
+  mOperations.push_back(Op);
+}
+
+void DeferredOutputSink::beginInput(const std::string &InputFile) {
+  mInputs.push_back(InputFile);
+}
+
+bool DeferredOutputSink::commitInputsBefore(const std::string &InputFile,
+                                            std::string *Error) {
+  unsigned End = mInputs.size() + 1;
+  for (unsigned i = 0, e = mInputs.size(); i != e; i++) {
+    if (mInputs[i] == InputFile) {
+      End = i;
+      break;
+    }
+  }
+
+  OutputSink *FS = getFileSystemSink();
+  bool Committed = true;
+  for (unsigned i = 0, e = mOperations.size(); (i != e) && Committed; i++) {
+    const Operation &Op = mOperations[i];
+    if (Op.Input >= End)
+      break;
+    if (Op.Remove) {
+      FS->removeFile(Op.Path);
+      continue;
+    }
+    std::string Reason;
+    if (!FS->writeFile(Op.Path, Op.Contents, &Reason)) {
+      *Error = "error opening '" + Op.Path + "': " + Reason;
+      Committed = false;
+    }
+  }
+  mOperations.clear();
+  return Committed;
+}
+
+}  // namespace slang
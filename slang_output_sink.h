@@ -0,0 +1,123 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_OUTPUT_SINK_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SLANG_OUTPUT_SINK_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+
+namespace slang {
+
+// Receives the files produced by a compilation (bitcode, reflected sources,
+// dependency files).
+class OutputSink {
+ public:
+  virtual ~OutputSink();
+
+  // Write Contents to Path, creating its parent directories if needed.
+  // Returns false (with the reason in Error) on failure.
+  virtual bool writeFile(const std::string &Path, llvm::StringRef Contents,
+                         std::string *Error) = 0;
+
+  // Read back Path (e.g. the bitcode embedded in the reflected sources).
+  virtual bool readFile(const std::string &Path, std::string *Contents) = 0;
+
+  // Remove Path (e.g. the stale output of a failed compilation).
+  virtual void removeFile(const std::string &Path) = 0;
+
+  // Called by SlangRS::compile() before it writes the files of each of its
+  // inputs.
+  virtual void beginInput(const std::string &InputFile) { }
+
+  // Returns the sink writing to the filesystem. Files whose contents did not
+  // change are left untouched (see SlangUtils::WriteFileIfChanged()).
+  static OutputSink *getFileSystemSink();
+};
+
+// Keeps the files in memory, nothing is written to the filesystem.
+class MemoryOutputSink : public OutputSink {
+ public:
+  // <path, contents> in the order the files were first written.
+  typedef std::vector<std::pair<std::string, std::string> > FileList;
+
+ private:
+  FileList mFiles;
+
+  std::pair<std::string, std::string> *lookup(llvm::StringRef Path);
+
+ public:
+  virtual bool writeFile(const std::string &Path, llvm::StringRef Contents,
+                         std::string *Error);
+  virtual bool readFile(const std::string &Path, std::string *Contents);
+  virtual void removeFile(const std::string &Path);
+
+  const FileList &getFiles() const { return mFiles; }
+
+  // Returns the contents of Path, or NULL if it was not written.
+  const std::string *getFile(llvm::StringRef Path) const;
+
+  void clear() { mFiles.clear(); }
+};
+
+// Holds back the files written and removed until commit() applies them to
+// the filesystem (e.g. in the workers of llvm-rs-cc -jobs, which must not
+// touch the outputs of their inputs before the previous inputs compiled
+// successfully). The files not written through the sink are read from the
+// filesystem.
+class DeferredOutputSink : public OutputSink {
+ private:
+  // A file written (with its contents) or removed, while compiling the input
+  // mInputs[Input].
+  struct Operation {
+    unsigned Input;
+    std::string Path;
+    bool Remove;
+    std::string Contents;
+  };
+
+  // The operations in the order they were made.
+  std::vector<Operation> mOperations;
+  // The inputs given to beginInput(), in order.
+  std::vector<std::string> mInputs;
+
+  unsigned getCurrentInput() const {
+    return mInputs.empty() ? 0 : (mInputs.size() - 1);
+  }
+
+ public:
+  virtual bool writeFile(const std::string &Path, llvm::StringRef Contents,
+                         std::string *Error);
+  virtual bool readFile(const std::string &Path, std::string *Contents);
+  virtual void removeFile(const std::string &Path);
+  virtual void beginInput(const std::string &InputFile);
+
+  // Remove and write the files on the filesystem, in order. Returns false
+  // (with a message naming the file and the reason in Error) on failure.
+  bool commit(std::string *Error) { return commitInputsBefore("", Error); }
+
+  // Same as commit(), but only for the files of the inputs before the first
+  // one named InputFile (all of them if none is).
+  bool commitInputsBefore(const std::string &InputFile, std::string *Error);
+};
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_OUTPUT_SINK_H_  NOLINT
@@ -0,0 +1,435 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "slang_phase_report.h"
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "slang_assert.h"
+
+#ifndef USE_MINGW
+#include <sys/resource.h>
+#endif
+
+namespace slang {
+
+namespace {
+
+struct PhaseNameInfo {
+  PhaseReport::Phase P;
+  const char *ID;
+  const char *Name;
+};
+
+const PhaseNameInfo PhaseNames[] = {
+  { PhaseReport::PH_Preprocess, "preprocess", "Preprocessing" },
+  { PhaseReport::PH_Parse, "parse", "Parsing and semantic analysis" },
+  { PhaseReport::PH_CheckAST, "check-ast", "RenderScript AST validation" },
+  { PhaseReport::PH_ObjectRefCount, "object-ref-count",
+    "RenderScript object reference counting" },
+  { PhaseReport::PH_ProcessExport, "process-export", "Export processing" },
+  { PhaseReport::PH_IRGen, "irgen", "LLVM IR generation" },
+  { PhaseReport::PH_FunctionPasses, "function-passes", "Per-function passes" },
+  { PhaseReport::PH_ModulePasses, "module-passes", "Module passes" },
+  { PhaseReport::PH_BitcodeWriting, "bitcode-writing", "Bitcode writing" },
+  { PhaseReport::PH_WrapBitcode, "wrap-bitcode", "Bitcode wrapping" },
+  { PhaseReport::PH_CodeEmission, "code-emission", "Code emission" },
+  { PhaseReport::PH_Reflection, "reflection", "Reflection" },
+  { PhaseReport::PH_Dependency, "dependency", "Dependency generation" },
+};
+
+const double kMicroseconds = 1000000.0;
+
+// Returns the peak resident set size of the process in bytes (0 if unknown).
+uint64_t GetPeakRSS() {
+#ifndef USE_MINGW
+  struct rusage Usage;
+  if (getrusage(RUSAGE_SELF, &Usage) == 0) {
+#if defined(__APPLE__)
+    return Usage.ru_maxrss;
+#else
+    return static_cast<uint64_t>(Usage.ru_maxrss) * 1024;
+#endif
+  }
+#endif
+  return 0;
+}
+
+// Returns the number of bytes currently allocated on the heap.
+int64_t GetAllocated() {
+  return llvm::sys::Process::GetMallocUsage();
+}
+
+void PrintSeparator(llvm::raw_ostream &OS) {
+  OS << "===" << std::string(73, '-') << "===\n";
+}
+
+void PrintTime(llvm::raw_ostream &OS, double Time, double Total) {
+  OS << llvm::format("  %8.4f (%5.1f%%)", Time,
+                     (Total > 0) ? (Time * 100 / Total) : 0.0);
+}
+
+// Print the escaped contents of a JSON string.
+void PrintJSONString(llvm::raw_ostream &OS, llvm::StringRef S) {
+  OS << '"';
+  for (unsigned i = 0, e = S.size(); i != e; i++) {
+    unsigned char C = S[i];
+    if ((C == '"') || (C == '\\')) {
+      OS << '\\' << C;
+    } else if (C < 0x20) {
+      OS << llvm::format("\\u%04x", C);
+    } else {
+      OS << C;
+    }
+  }
+  OS << '"';
+}
+
+}  // namespace
+
+const double PhaseReport::kTraceGranularity = 50.0;
+
+const char *PhaseReport::getPhaseName(Phase P) {
+  slangAssert((P < PH_Count) && (PhaseNames[P].P == P) && "Invalid phase!");
+  return PhaseNames[P].Name;
+}
+
+const char *PhaseReport::getPhaseID(Phase P) {
+  slangAssert((P < PH_Count) && (PhaseNames[P].P == P) && "Invalid phase!");
+  return PhaseNames[P].ID;
+}
+
+PhaseReport::PhaseReport(bool RecordTrace, bool RecordMemory)
+    : mRecordTrace(RecordTrace),
+      mRecordMemory(RecordMemory),
+      mPeakRSS(0),
+      mOrigin(llvm::TimeRecord::getCurrentTime(true).getWallTime()),
+      mLane(1),
+      mCurrentFile(0) {
+  // Time spent outside of any input file (e.g. in the argument parsing).
+  mFiles.push_back(FileTimes());
+}
+
+unsigned PhaseReport::getFileIndex(llvm::StringRef File) {
+  for (unsigned i = 0, e = mFiles.size(); i != e; i++) {
+    if (mFiles[i].File == File)
+      return i;
+  }
+  mFiles.push_back(FileTimes());
+  mFiles.back().File = File.str();
+  return mFiles.size() - 1;
+}
+
+void PhaseReport::clear() {
+  slangAssert(mActive.empty() && "Clearing the report during a phase!");
+  mFiles.resize(1);
+  mFiles[0] = FileTimes();
+  mCurrentFile = 0;
+  mTrace.clear();
+  mPeakRSS = 0;
+}
+
+void PhaseReport::setCurrentFile(llvm::StringRef File) {
+  slangAssert(mActive.empty() && "Changing file in the middle of a phase!");
+  mCurrentFile = getFileIndex(File);
+}
+
+void PhaseReport::startPhase(Phase P) {
+  llvm::TimeRecord Now = llvm::TimeRecord::getCurrentTime(true);
+  ActivePhase A;
+  A.P = P;
+  A.StartWall = Now.getWallTime();
+  A.StartCPU = Now.getProcessTime();
+  A.NestedWall = 0;
+  A.NestedCPU = 0;
+  A.StartAllocated = mRecordMemory ? GetAllocated() : 0;
+  A.StartPeakRSS = mRecordMemory ? GetPeakRSS() : 0;
+  A.NestedAllocated = 0;
+  A.NestedPeakRSSGrowth = 0;
+  mActive.push_back(A);
+}
+
+void PhaseReport::stopPhase(Phase P) {
+  llvm::TimeRecord Now = llvm::TimeRecord::getCurrentTime(false);
+  slangAssert(!mActive.empty() && (mActive.back().P == P) &&
+              "Phases must be stopped in the reverse order they started!");
+
+  ActivePhase A = mActive.back();
+  mActive.pop_back();
+
+  double Wall = Now.getWallTime() - A.StartWall;
+  double CPU = Now.getProcessTime() - A.StartCPU;
+
+  int64_t Allocated = 0;
+  uint64_t PeakRSSGrowth = 0;
+  if (mRecordMemory) {
+    uint64_t PeakRSS = GetPeakRSS();
+    Allocated = GetAllocated() - A.StartAllocated;
+    PeakRSSGrowth = PeakRSS - A.StartPeakRSS;
+    if (PeakRSS > mPeakRSS)
+      mPeakRSS = PeakRSS;
+  }
+
+  Times &T = mFiles[mCurrentFile].Phases[P];
+  T.Wall += Wall - A.NestedWall;
+  T.CPU += CPU - A.NestedCPU;
+  T.Allocated += Allocated - A.NestedAllocated;
+  T.PeakRSSGrowth += PeakRSSGrowth - A.NestedPeakRSSGrowth;
+
+  if (!mActive.empty()) {
+    mActive.back().NestedWall += Wall;
+    mActive.back().NestedCPU += CPU;
+    mActive.back().NestedAllocated += Allocated;
+    mActive.back().NestedPeakRSSGrowth += PeakRSSGrowth;
+  }
+
+  if (mRecordTrace && (Wall * kMicroseconds >= kTraceGranularity)) {
+    TraceEvent E;
+    E.P = P;
+    E.File = mCurrentFile;
+    E.Lane = mLane;
+    E.Start = (A.StartWall - mOrigin) * kMicroseconds;
+    E.Duration = Wall * kMicroseconds;
+    mTrace.push_back(E);
+  }
+}
+
+void PhaseReport::recordSize(llvm::StringRef Name, uint64_t Bytes) {
+  if (mRecordMemory)
+    mFiles[mCurrentFile].Sizes.push_back(SizeTy(Name.str(), Bytes));
+}
+
+void PhaseReport::print(llvm::raw_ostream &OS) const {
+  // Sum up the phases of all the files (the first entry, not attached to any
+  // file, is only printed in the totals).
+  FileTimes All;
+  All.File = "All input files";
+  for (unsigned i = 0, e = mFiles.size(); i != e; i++) {
+    for (unsigned p = 0; p != PH_Count; p++) {
+      All.Phases[p].Wall += mFiles[i].Phases[p].Wall;
+      All.Phases[p].CPU += mFiles[i].Phases[p].CPU;
+    }
+  }
+
+  std::vector<const FileTimes *> Tables;
+  Tables.push_back(&All);
+  for (unsigned i = 1, e = mFiles.size(); i < e; i++)
+    Tables.push_back(&mFiles[i]);
+
+  for (unsigned t = 0, te = Tables.size(); t != te; t++) {
+    const FileTimes &F = *Tables[t];
+    Times Total;
+    for (unsigned p = 0; p != PH_Count; p++) {
+      Total.Wall += F.Phases[p].Wall;
+      Total.CPU += F.Phases[p].CPU;
+    }
+
+    PrintSeparator(OS);
+    OS << "  llvm-rs-cc time report: " << F.File << '\n';
+    PrintSeparator(OS);
+    OS << llvm::format("  Total execution time: %.4f seconds "
+                       "(%.4f wall clock)\n\n", Total.CPU, Total.Wall);
+    OS << "   ---CPU Time---    --Wall Time--   --- Phase ---\n";
+    for (unsigned p = 0; p != PH_Count; p++) {
+      const Times &T = F.Phases[p];
+      if ((T.Wall == 0) && (T.CPU == 0))
+        continue;
+      PrintTime(OS, T.CPU, Total.CPU);
+      PrintTime(OS, T.Wall, Total.Wall);
+      OS << "  " << getPhaseName(static_cast<Phase>(p)) << '\n';
+    }
+    PrintTime(OS, Total.CPU, Total.CPU);
+    PrintTime(OS, Total.Wall, Total.Wall);
+    OS << "  Total\n\n";
+  }
+  OS.flush();
+}
+
+void PhaseReport::writeTrace(llvm::raw_ostream &OS) const {
+  OS << "{\"traceEvents\":[\n";
+  for (unsigned i = 0, e = mTrace.size(); i != e; i++) {
+    const TraceEvent &E = mTrace[i];
+    OS << "{\"pid\":1,\"tid\":" << E.Lane << ",\"ph\":\"X\",\"cat\":\"slang\""
+       << llvm::format(",\"ts\":%.0f,\"dur\":%.0f", E.Start, E.Duration)
+       << ",\"name\":";
+    PrintJSONString(OS, getPhaseName(E.P));
+    OS << ",\"args\":{\"file\":";
+    PrintJSONString(OS, mFiles[E.File].File);
+    OS << "}},\n";
+  }
+  // The process name also avoids the trailing comma JSON does not allow.
+  OS << "{\"pid\":1,\"tid\":0,\"ph\":\"M\",\"name\":\"process_name\","
+        "\"args\":{\"name\":\"llvm-rs-cc\"}}\n";
+  OS << "],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+void PhaseReport::writeMemoryReport(llvm::raw_ostream &OS) const {
+  OS << "{\n  \"peak_rss\": " << mPeakRSS << ",\n  \"files\": [";
+  for (unsigned i = 0, e = mFiles.size(); i != e; i++) {
+    const FileTimes &F = mFiles[i];
+    OS << ((i == 0) ? "\n" : ",\n") << "    {\"file\": ";
+    PrintJSONString(OS, F.File);
+    OS << ",\n     \"phases\": {";
+    bool First = true;
+    for (unsigned p = 0; p != PH_Count; p++) {
+      const Times &T = F.Phases[p];
+      if ((T.Wall == 0) && (T.CPU == 0) && (T.Allocated == 0) &&
+          (T.PeakRSSGrowth == 0))
+        continue;
+      OS << (First ? "\n" : ",\n") << "       ";
+      PrintJSONString(OS, getPhaseID(static_cast<Phase>(p)));
+      OS << ": {\"allocated\": " << T.Allocated
+         << ", \"peak_rss_growth\": " << T.PeakRSSGrowth << "}";
+      First = false;
+    }
+    OS << "},\n     \"sizes\": {";
+    for (unsigned s = 0, se = F.Sizes.size(); s != se; s++) {
+      OS << ((s == 0) ? "" : ", ");
+      PrintJSONString(OS, F.Sizes[s].first);
+      OS << ": " << F.Sizes[s].second;
+    }
+    OS << "}}";
+  }
+  OS << "\n  ]\n}\n";
+}
+
+// The report is serialized as lines
+//   P <peak RSS>
+//   T <phase> <wall> <CPU> <allocated> <peak RSS growth> <file>
+//   S <bytes> <name>\t<file>
+//   E <phase> <lane> <start> <duration> <file>
+// with the times in microseconds.
+void PhaseReport::serialize(llvm::raw_ostream &OS) const {
+  OS << "P " << mPeakRSS << '\n';
+  for (unsigned i = 0, e = mFiles.size(); i != e; i++) {
+    for (unsigned p = 0; p != PH_Count; p++) {
+      const Times &T = mFiles[i].Phases[p];
+      if ((T.Wall == 0) && (T.CPU == 0) && (T.Allocated == 0) &&
+          (T.PeakRSSGrowth == 0))
+        continue;
+      OS << llvm::format("T %u %.0f %.0f ", p, T.Wall * kMicroseconds,
+                         T.CPU * kMicroseconds)
+         << T.Allocated << ' ' << T.PeakRSSGrowth << ' ' << mFiles[i].File
+         << '\n';
+    }
+    for (unsigned s = 0, se = mFiles[i].Sizes.size(); s != se; s++) {
+      OS << "S " << mFiles[i].Sizes[s].second << ' '
+         << mFiles[i].Sizes[s].first << '\t' << mFiles[i].File << '\n';
+    }
+  }
+  for (unsigned i = 0, e = mTrace.size(); i != e; i++) {
+    const TraceEvent &E = mTrace[i];
+    OS << llvm::format("E %u %u %.0f %.0f ", E.P, E.Lane, E.Start, E.Duration)
+       << mFiles[E.File].File << '\n';
+  }
+}
+
+bool PhaseReport::merge(llvm::StringRef Buf) {
+  while (!Buf.empty()) {
+    std::pair<llvm::StringRef, llvm::StringRef> LineAndRest = Buf.split('\n');
+    llvm::StringRef Line = LineAndRest.first;
+    Buf = LineAndRest.second;
+    if (Line.empty())
+      continue;
+
+    // Split the numeric fields, the file name is the rest of the line.
+    unsigned NumFields;
+    switch (Line[0]) {
+      case 'P': {
+        NumFields = 1;
+        break;
+      }
+      case 'S': {
+        NumFields = 2;
+        break;
+      }
+      case 'T': {
+        NumFields = 6;
+        break;
+      }
+      case 'E': {
+        NumFields = 5;
+        break;
+      }
+      default: {
+        return false;
+      }
+    }
+
+    llvm::SmallVector<llvm::StringRef, 7> Fields;
+    Line.split(Fields, " ", NumFields);
+    if (Fields.size() != NumFields + 1)
+      return false;
+
+    int64_t Values[5];
+    for (unsigned i = 1; i != NumFields; i++) {
+      if (Fields[i].getAsInteger(10, Values[i - 1]))
+        return false;
+    }
+    llvm::StringRef Rest = Fields[NumFields];
+
+    if (Line[0] == 'P') {
+      uint64_t PeakRSS;
+      if (Rest.getAsInteger(10, PeakRSS))
+        return false;
+      if (PeakRSS > mPeakRSS)
+        mPeakRSS = PeakRSS;
+      continue;
+    }
+
+    if (Line[0] == 'S') {
+      std::pair<llvm::StringRef, llvm::StringRef> NameAndFile =
+          Rest.split('\t');
+      mFiles[getFileIndex(NameAndFile.second)].Sizes.push_back(
+          SizeTy(NameAndFile.first.str(), Values[0]));
+      continue;
+    }
+
+    if ((Values[0] < 0) || (Values[0] >= PH_Count))
+      return false;
+    Phase P = static_cast<Phase>(Values[0]);
+    unsigned File = getFileIndex(Rest);
+
+    if (Line[0] == 'T') {
+      Times &T = mFiles[File].Phases[P];
+      T.Wall += Values[1] / kMicroseconds;
+      T.CPU += Values[2] / kMicroseconds;
+      T.Allocated += Values[3];
+      T.PeakRSSGrowth += Values[4];
+    } else if (mRecordTrace) {
+      TraceEvent E;
+      E.P = P;
+      E.File = File;
+      E.Lane = Values[1];
+      E.Start = Values[2];
+      E.Duration = Values[3];
+      mTrace.push_back(E);
+    }
+  }
+  return true;
+}
+
+}  // namespace slang
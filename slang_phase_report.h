@@ -0,0 +1,188 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_PHASE_REPORT_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SLANG_PHASE_REPORT_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+
+namespace llvm {
+  class raw_ostream;
+}
+
+namespace slang {
+
+// Accounts the time spent in each phase of the compilation, per input file
+// (-ftime-report), and optionally records them as Chrome trace events
+// (-ftime-trace) and accounts the memory they use (-fmemory-report).
+//
+// Phases nest (e.g. IR generation runs while parsing). The time and memory
+// reported for a phase exclude the ones of the phases nested in it, so that
+// the phases of a file add up to the whole compilation of it.
+class PhaseReport {
+ public:
+  enum Phase {
+    PH_Preprocess,
+    PH_Parse,
+    PH_CheckAST,
+    PH_ObjectRefCount,
+    PH_ProcessExport,
+    PH_IRGen,
+    PH_FunctionPasses,
+    PH_ModulePasses,
+    PH_BitcodeWriting,
+    PH_WrapBitcode,
+    PH_CodeEmission,
+    PH_Reflection,
+    PH_Dependency,
+    PH_Count
+  };
+
+  static const char *getPhaseName(Phase P);
+  // Short identifier of the phase (used in the machine-readable reports).
+  static const char *getPhaseID(Phase P);
+
+ private:
+  // Phases shorter than this (in microseconds) are not recorded as trace
+  // events, they are still accounted in the report.
+  static const double kTraceGranularity;
+
+  struct Times {
+    double Wall;
+    double CPU;
+    // Growth of the heap (bytes allocated and not freed yet) during the
+    // phase, may be negative.
+    int64_t Allocated;
+    // Growth of the peak RSS of the process during the phase.
+    uint64_t PeakRSSGrowth;
+    Times() : Wall(0), CPU(0), Allocated(0), PeakRSSGrowth(0) { }
+  };
+
+  typedef std::pair<std::string, uint64_t> SizeTy;
+
+  struct FileTimes {
+    std::string File;
+    Times Phases[PH_Count];
+    // Sizes (in bytes) of the main data structures (see recordSize()).
+    std::vector<SizeTy> Sizes;
+  };
+
+  struct TraceEvent {
+    Phase P;
+    unsigned File;    // Index in mFiles
+    unsigned Lane;    // Process (tid) running the phase
+    double Start;     // In microseconds since mOrigin
+    double Duration;  // In microseconds
+  };
+
+  struct ActivePhase {
+    Phase P;
+    double StartWall;
+    double StartCPU;
+    int64_t StartAllocated;
+    uint64_t StartPeakRSS;
+    // Time and memory of the phases nested in this one.
+    double NestedWall;
+    double NestedCPU;
+    int64_t NestedAllocated;
+    uint64_t NestedPeakRSSGrowth;
+  };
+
+  bool mRecordTrace;
+  bool mRecordMemory;
+  uint64_t mPeakRSS;
+  double mOrigin;
+  unsigned mLane;
+
+  std::vector<FileTimes> mFiles;
+  unsigned mCurrentFile;
+
+  std::vector<TraceEvent> mTrace;
+  std::vector<ActivePhase> mActive;
+
+  unsigned getFileIndex(llvm::StringRef File);
+
+ public:
+  PhaseReport(bool RecordTrace, bool RecordMemory);
+
+  // Account the phases started from now on to the compilation of @File.
+  void setCurrentFile(llvm::StringRef File);
+
+  // Phases must be stopped in the reverse order they were started. Prefer
+  // PhaseTimer.
+  void startPhase(Phase P);
+  void stopPhase(Phase P);
+
+  // Record the size of a data structure of the current file (e.g. the arena
+  // of the ASTContext). Only done when accounting the memory.
+  void recordSize(llvm::StringRef Name, uint64_t Bytes);
+  bool isRecordingMemory() const { return mRecordMemory; }
+
+  // Set the lane (tid) of the trace events recorded from now on. Used to tell
+  // apart the worker processes of llvm-rs-cc -jobs.
+  void setLane(unsigned Lane) { mLane = Lane; }
+
+  // Forget the times and trace events recorded so far.
+  void clear();
+
+  // Print the time of each phase, for all the files and then for each of
+  // them.
+  void print(llvm::raw_ostream &OS) const;
+
+  // Write the trace events in the Chrome trace-event JSON format (see
+  // chrome://tracing).
+  void writeTrace(llvm::raw_ostream &OS) const;
+
+  // Write the memory used by each phase and the recorded sizes, for each
+  // file, in JSON.
+  void writeMemoryReport(llvm::raw_ostream &OS) const;
+
+  // Serialize the report, so that it can be merged into the one of another
+  // process.
+  void serialize(llvm::raw_ostream &OS) const;
+  bool merge(llvm::StringRef Buf);
+};
+
+// Times the enclosing scope as phase @P of @Report. Does nothing if @Report is
+// NULL.
+class PhaseTimer {
+ private:
+  PhaseReport *mReport;
+  PhaseReport::Phase mPhase;
+
+ public:
+  PhaseTimer(PhaseReport *Report, PhaseReport::Phase P)
+      : mReport(Report), mPhase(P) {
+    if (mReport != NULL)
+      mReport->startPhase(mPhase);
+  }
+
+  ~PhaseTimer() {
+    if (mReport != NULL)
+      mReport->stopPhase(mPhase);
+  }
+};
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_PHASE_REPORT_H_  NOLINT
@@ -111,4 +111,24 @@ void PragmaRecorder::HandlePragma(clang::Preprocessor &PP,
   PP.LexUnexpandedToken(CurrentToken);
 }
 
+PragmaTextRecorder::PragmaTextRecorder(PragmaTextList *PragmaTexts)
+    : PragmaHandler(),
+      mPragmaTexts(PragmaTexts) {
+}
+
+void PragmaTextRecorder::HandlePragma(clang::Preprocessor &PP,
+                                      clang::PragmaIntroducerKind Introducer,
+                                      clang::Token &FirstToken) {
+  std::string Text = PP.getSpelling(FirstToken);
+  clang::Token Tok;
+  PP.Lex(Tok);
+  while (Tok.isNot(clang::tok::eod)) {
+    if (Tok.hasLeadingSpace())
+      Text.append(1, ' ');
+    Text.append(PP.getSpelling(Tok));
+    PP.Lex(Tok);
+  }
+  mPragmaTexts->push_back(Text);
+}
+
 }  // namespace slang
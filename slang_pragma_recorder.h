@@ -31,6 +31,7 @@ namespace clang {
 namespace slang {
 
 typedef std::list< std::pair<std::string, std::string> > PragmaList;
+typedef std::list<std::string> PragmaTextList;
 
 class PragmaRecorder : public clang::PragmaHandler {
  private:
@@ -49,6 +50,21 @@ class PragmaRecorder : public clang::PragmaHandler {
                             clang::PragmaIntroducerKind Introducer,
                             clang::Token &FirstToken);
 };
+
+// Records the spelling of all the tokens of each pragma it handles, with the
+// macros expanded, whatever its form (e.g. '#pragma rs java_package_name(foo)',
+// which PragmaRecorder sees as 'rs' without a value).
+class PragmaTextRecorder : public clang::PragmaHandler {
+ private:
+  PragmaTextList *mPragmaTexts;
+
+ public:
+  explicit PragmaTextRecorder(PragmaTextList *PragmaTexts);
+
+  virtual void HandlePragma(clang::Preprocessor &PP,
+                            clang::PragmaIntroducerKind Introducer,
+                            clang::Token &FirstToken);
+};
 }  // namespace slang
 
 #endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_PRAGMA_RECORDER_H_  NOLINT
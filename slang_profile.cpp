@@ -0,0 +1,385 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "slang_profile.h"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+
+#include "slang_assert.h"
+
+namespace slang {
+
+const char Profile::kCountersName[] = ".rs.profile.counters";
+const char Profile::kLayoutName[] = ".rs.profile.layout";
+
+namespace {
+
+// Split the critical edges of F and return its blocks, in the order they are
+// numbered in the profiles.
+void getProfiledBlocks(llvm::Function *F,
+                       std::vector<llvm::BasicBlock*> *Blocks) {
+  std::vector<llvm::TerminatorInst*> Branches;
+  for (llvm::Function::iterator BB = F->begin(), E = F->end(); BB != E; BB++) {
+    llvm::TerminatorInst *TI = BB->getTerminator();
+    if (TI->getNumSuccessors() > 1) {
+      Branches.push_back(TI);
+    }
+  }
+  for (unsigned i = 0, e = Branches.size(); i != e; i++) {
+    for (unsigned s = 0, se = Branches[i]->getNumSuccessors(); s != se; s++) {
+      // Does nothing if the edge is not critical.
+      llvm::SplitCriticalEdge(Branches[i], s);
+    }
+  }
+
+  Blocks->clear();
+  for (llvm::Function::iterator BB = F->begin(), E = F->end(); BB != E; BB++) {
+    Blocks->push_back(BB);
+  }
+}
+
+// Split Line into the fields separated by spaces.
+void splitFields(llvm::StringRef Line,
+                 llvm::SmallVectorImpl<llvm::StringRef> *Fields) {
+  Fields->clear();
+  Line.split(*Fields, " ", -1, /* KeepEmpty = */false);
+}
+
+std::string lineError(unsigned Line, const llvm::Twine &Message) {
+  return ("line " + llvm::Twine(Line) + ": " + Message).str();
+}
+
+}  // namespace
+
+bool Profile::addFunctionCounts(llvm::StringRef Script,
+                                llvm::StringRef Function,
+                                const CountList &Counts) {
+  CountList &Total = mScripts[Script][Function];
+  if (Total.empty()) {
+    Total = Counts;
+    return true;
+  }
+  if (Total.size() != Counts.size()) {
+    return false;
+  }
+  for (unsigned i = 0, e = Counts.size(); i != e; i++) {
+    Total[i] += Counts[i];
+  }
+  return true;
+}
+
+bool Profile::read(const std::string &Filename, std::string *Error) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> MBOrErr =
+      llvm::MemoryBuffer::getFile(Filename);
+  if (MBOrErr.getError()) {
+    *Error = "unable to read '" + Filename + "': " +
+             MBOrErr.getError().message();
+    return false;
+  }
+  if (!parse(MBOrErr.get()->getBuffer(), Error)) {
+    *Error = Filename + ": " + *Error;
+    return false;
+  }
+  return true;
+}
+
+bool Profile::parse(llvm::StringRef Buffer, std::string *Error) {
+  llvm::SmallVector<llvm::StringRef, 64> Lines;
+  llvm::SmallVector<llvm::StringRef, 16> Fields;
+  llvm::StringRef Script;
+
+  Buffer.split(Lines, "\n", -1, /* KeepEmpty = */true);
+  for (unsigned i = 0, e = Lines.size(); i != e; i++) {
+    llvm::StringRef Line = Lines[i].trim();
+    if (Line.empty() || Line.startswith("#"))
+      continue;
+
+    splitFields(Line, &Fields);
+    if (Fields[0] == "script") {
+      if (Fields.size() != 2) {
+        *Error = lineError(i + 1, "expected 'script <name>'");
+        return false;
+      }
+      Script = Fields[1];
+      continue;
+    }
+
+    if (Script.empty()) {
+      *Error = lineError(i + 1, "counts of '" + Fields[0] +
+                                "' before any 'script <name>'");
+      return false;
+    }
+    if (Fields.size() < 2) {
+      *Error = lineError(i + 1, "no counts for '" + Fields[0] + "'");
+      return false;
+    }
+
+    CountList Counts(Fields.size() - 1);
+    for (unsigned f = 1, fe = Fields.size(); f != fe; f++) {
+      unsigned long long Count;
+      if (Fields[f].getAsInteger(10, Count)) {
+        *Error = lineError(i + 1, "invalid count '" + Fields[f] + "'");
+        return false;
+      }
+      Counts[f - 1] = Count;
+    }
+    if (!addFunctionCounts(Script, Fields[0], Counts)) {
+      *Error = lineError(i + 1, "the counts of '" + Fields[0] + "' do not "
+                                "match the earlier ones");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Profile::addCounts(llvm::StringRef Layout, const uint64_t *Counters,
+                        std::string *Error) {
+  llvm::SmallVector<llvm::StringRef, 64> Lines;
+  llvm::SmallVector<llvm::StringRef, 16> Fields;
+  llvm::StringRef Script;
+
+  Layout.split(Lines, "\n", -1, /* KeepEmpty = */false);
+  for (unsigned i = 0, e = Lines.size(); i != e; i++) {
+    splitFields(Lines[i], &Fields);
+    unsigned NumCounters = 0;
+    if ((Fields.size() != 2) ||
+        (Fields[0] != "script" && Fields[1].getAsInteger(10, NumCounters))) {
+      *Error = lineError(i + 1, "invalid profile layout");
+      return false;
+    }
+    if (Fields[0] == "script") {
+      Script = Fields[1];
+      continue;
+    }
+    if (Script.empty()) {
+      *Error = lineError(i + 1, "invalid profile layout");
+      return false;
+    }
+
+    CountList Counts(Counters, Counters + NumCounters);
+    Counters += NumCounters;
+    if (!addFunctionCounts(Script, Fields[0], Counts)) {
+      *Error = "the counts of '" + Fields[0].str() + "' do not match the " +
+               "earlier ones";
+      return false;
+    }
+  }
+  return true;
+}
+
+const Profile::CountList *Profile::getCounts(llvm::StringRef Script,
+                                             llvm::StringRef Function) const {
+  ScriptCountMap::const_iterator S = mScripts.find(Script);
+  if (S == mScripts.end()) {
+    return NULL;
+  }
+  FunctionCountMap::const_iterator F = S->getValue().find(Function);
+  if (F == S->getValue().end()) {
+    return NULL;
+  }
+  return &F->getValue();
+}
+
+void Profile::write(llvm::raw_ostream &OS) const {
+  // Sort the scripts and functions, so that the same counts give the same
+  // file.
+  std::vector<llvm::StringRef> Scripts;
+  for (ScriptCountMap::const_iterator I = mScripts.begin(),
+          E = mScripts.end(); I != E; I++) {
+    Scripts.push_back(I->getKey());
+  }
+  std::sort(Scripts.begin(), Scripts.end());
+
+  for (unsigned i = 0, e = Scripts.size(); i != e; i++) {
+    const FunctionCountMap &Functions = mScripts.find(Scripts[i])->getValue();
+    std::vector<llvm::StringRef> Names;
+    for (FunctionCountMap::const_iterator I = Functions.begin(),
+            E = Functions.end(); I != E; I++) {
+      Names.push_back(I->getKey());
+    }
+    std::sort(Names.begin(), Names.end());
+
+    OS << "script " << Scripts[i] << "\n";
+    for (unsigned n = 0, ne = Names.size(); n != ne; n++) {
+      const CountList &Counts = Functions.find(Names[n])->getValue();
+      OS << Names[n];
+      for (unsigned c = 0, ce = Counts.size(); c != ce; c++) {
+        OS << " " << Counts[c];
+      }
+      OS << "\n";
+    }
+  }
+}
+
+llvm::GlobalVariable *Profile::instrument(llvm::Module *M,
+                                          llvm::StringRef Script) {
+  llvm::LLVMContext &C = M->getContext();
+
+  std::vector<std::vector<llvm::BasicBlock*> > FunctionBlocks;
+  std::string Layout;
+  llvm::raw_string_ostream LayoutOS(Layout);
+  unsigned NumCounters = 0;
+
+  LayoutOS << "script " << Script << "\n";
+  for (llvm::Module::iterator F = M->begin(), E = M->end(); F != E; F++) {
+    if (F->isDeclaration()) {
+      continue;
+    }
+    FunctionBlocks.push_back(std::vector<llvm::BasicBlock*>());
+    getProfiledBlocks(F, &FunctionBlocks.back());
+    LayoutOS << F->getName() << " " << FunctionBlocks.back().size() << "\n";
+    NumCounters += FunctionBlocks.back().size();
+  }
+  if (NumCounters == 0) {
+    return NULL;
+  }
+
+  llvm::Type *Int64Ty = llvm::Type::getInt64Ty(C);
+  llvm::ArrayType *CountersTy = llvm::ArrayType::get(Int64Ty, NumCounters);
+  llvm::GlobalVariable *Counters = new llvm::GlobalVariable(
+      *M, CountersTy, false, llvm::GlobalValue::InternalLinkage,
+      llvm::Constant::getNullValue(CountersTy), kCountersName);
+
+  llvm::Constant *LayoutInit =
+      llvm::ConstantDataArray::getString(C, LayoutOS.str());
+  llvm::GlobalVariable *LayoutVar = new llvm::GlobalVariable(
+      *M, LayoutInit->getType(), true, llvm::GlobalValue::PrivateLinkage,
+      LayoutInit, kLayoutName);
+  LayoutVar->setUnnamedAddr(true);
+
+  // The counters are not updated atomically: the counts of the kernel threads
+  // racing for a block may be lost, which does not matter much for their
+  // relative weights.
+  llvm::Type *Int32Ty = llvm::Type::getInt32Ty(C);
+  llvm::Constant *One = llvm::ConstantInt::get(Int64Ty, 1);
+  unsigned Index = 0;
+  for (unsigned f = 0, fe = FunctionBlocks.size(); f != fe; f++) {
+    const std::vector<llvm::BasicBlock*> &Blocks = FunctionBlocks[f];
+    for (unsigned b = 0, be = Blocks.size(); b != be; b++) {
+      llvm::Constant *Indices[] = {
+        llvm::ConstantInt::get(Int32Ty, 0),
+        llvm::ConstantInt::get(Int32Ty, Index++)
+      };
+      llvm::Constant *Counter =
+          llvm::ConstantExpr::getInBoundsGetElementPtr(Counters, Indices);
+
+      llvm::IRBuilder<> Builder(Blocks[b], Blocks[b]->getFirstInsertionPt());
+      llvm::Value *Count = Builder.CreateLoad(Counter);
+      Builder.CreateStore(Builder.CreateAdd(Count, One), Counter);
+    }
+  }
+
+  return Counters;
+}
+
+void Profile::apply(llvm::Module *M, llvm::StringRef Script,
+                    std::vector<std::string> *Mismatched) const {
+  ScriptCountMap::const_iterator S = mScripts.find(Script);
+  if (S == mScripts.end()) {
+    return;
+  }
+
+  bool ScriptRan = false;
+  for (FunctionCountMap::const_iterator I = S->getValue().begin(),
+          E = S->getValue().end(); I != E; I++) {
+    if (!I->getValue().empty() && I->getValue()[0] != 0) {
+      ScriptRan = true;
+    }
+  }
+
+  llvm::MDBuilder MDB(M->getContext());
+  for (llvm::Module::iterator F = M->begin(), E = M->end(); F != E; F++) {
+    if (F->isDeclaration()) {
+      continue;
+    }
+    const CountList *Counts = getCounts(Script, F->getName());
+    if (Counts == NULL) {
+      continue;
+    }
+
+    std::vector<llvm::BasicBlock*> Blocks;
+    getProfiledBlocks(F, &Blocks);
+    if (Blocks.size() != Counts->size()) {
+      Mismatched->push_back(F->getName().str());
+      continue;
+    }
+
+    if (ScriptRan && (*Counts)[0] == 0) {
+      F->addFnAttr(llvm::Attribute::Cold);
+    }
+
+    llvm::DenseMap<llvm::BasicBlock*, uint64_t> BlockCounts;
+    for (unsigned b = 0, be = Blocks.size(); b != be; b++) {
+      BlockCounts[Blocks[b]] = (*Counts)[b];
+    }
+
+    for (unsigned b = 0, be = Blocks.size(); b != be; b++) {
+      llvm::TerminatorInst *TI = Blocks[b]->getTerminator();
+      unsigned NumSuccessors = TI->getNumSuccessors();
+      if ((NumSuccessors < 2) || ((*Counts)[b] == 0)) {
+        continue;
+      }
+
+      // Once the critical edges are split, the count of each target is the
+      // one of its edge, unless the edge could not be split.
+      std::vector<uint64_t> EdgeCounts;
+      uint64_t MaxCount = 0;
+      for (unsigned s = 0; s != NumSuccessors; s++) {
+        llvm::BasicBlock *Succ = TI->getSuccessor(s);
+        if (Succ->getSinglePredecessor() != Blocks[b]) {
+          break;
+        }
+        EdgeCounts.push_back(BlockCounts[Succ]);
+        MaxCount = std::max(MaxCount, EdgeCounts.back());
+      }
+      if (EdgeCounts.size() != NumSuccessors) {
+        continue;
+      }
+
+      // The weights are 32-bit.
+      uint64_t Scale = MaxCount / std::numeric_limits<uint32_t>::max() + 1;
+      llvm::SmallVector<uint32_t, 4> Weights;
+      for (unsigned s = 0; s != NumSuccessors; s++) {
+        Weights.push_back(EdgeCounts[s] / Scale);
+      }
+      TI->setMetadata(llvm::LLVMContext::MD_prof,
+                      MDB.createBranchWeights(Weights));
+    }
+  }
+}
+
+}  // namespace slang
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_PROFILE_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SLANG_PROFILE_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace llvm {
+  class GlobalVariable;
+  class Module;
+  class raw_ostream;
+}
+
+namespace slang {
+
+// Block execution counts of the functions of scripts, for the profile-guided
+// optimization of llvm-rs-cc (-fprofile-generate and -fprofile-use).
+//
+// A module instrumented by instrument() counts the executions of each block of
+// its functions in the kCountersName global, an array of 64-bit counters. The
+// kLayoutName global is a string naming the script and, for each function,
+// how many of the counters are its own:
+//
+//   script <script>\n
+//   <function> <number of counters>\n
+//   ...
+//
+// Given this string and the counters (e.g. in the dump hook of the runtime,
+// see RSBackend), addCounts() adds them to a profile. The profile file is in
+// the same text format, but lists the counts themselves:
+//
+//   script <script>
+//   <function> <count of block 0> <count of block 1> ...
+//
+// The blocks of a function are numbered in the order of the function once its
+// critical edges are split (by both instrument() and apply(), so that each
+// branch has a block of its own for each of its targets). This is only stable
+// for the same source compiled by the same llvm-rs-cc. Lines starting with #
+// are comments.
+class Profile {
+ public:
+  typedef std::vector<uint64_t> CountList;
+
+  static const char kCountersName[];
+  static const char kLayoutName[];
+
+ private:
+  typedef llvm::StringMap<CountList> FunctionCountMap;
+  typedef llvm::StringMap<FunctionCountMap> ScriptCountMap;
+  ScriptCountMap mScripts;
+
+  // Add Counts to the ones of Function in Script. Returns false if there
+  // were counts for a different number of blocks.
+  bool addFunctionCounts(llvm::StringRef Script, llvm::StringRef Function,
+                         const CountList &Counts);
+
+ public:
+  // Add the counts of the profile file Filename. Returns false (with the
+  // reason in Error) if it can not be read or parsed.
+  bool read(const std::string &Filename, std::string *Error);
+
+  // Add the counts of the profile in Buffer.
+  bool parse(llvm::StringRef Buffer, std::string *Error);
+
+  // Add Counters, which are laid out as described by Layout (the initializer
+  // of kLayoutName).
+  bool addCounts(llvm::StringRef Layout, const uint64_t *Counters,
+                 std::string *Error);
+
+  // Returns the counts of Function in Script, or NULL if there are none.
+  const CountList *getCounts(llvm::StringRef Script,
+                             llvm::StringRef Function) const;
+
+  bool hasScript(llvm::StringRef Script) const {
+    return mScripts.count(Script) != 0;
+  }
+
+  // Write the profile in the format of read().
+  void write(llvm::raw_ostream &OS) const;
+
+  // Add a counter to each block of the functions defined in M, the module of
+  // Script, and the kCountersName and kLayoutName globals. Returns the
+  // counters (NULL if M defines no function).
+  static llvm::GlobalVariable *instrument(llvm::Module *M,
+                                          llvm::StringRef Script);
+
+  // Set the branch weights of the functions of M, the module of Script, from
+  // their counts in this profile. The functions which were never called while
+  // others of the script were are marked cold. The names of the functions
+  // whose counts do not match their blocks (because the source changed) are
+  // added to Mismatched, and their counts are ignored.
+  void apply(llvm::Module *M, llvm::StringRef Script,
+             std::vector<std::string> *Mismatched) const;
+};
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_PROFILE_H_  NOLINT
@@ -23,22 +23,33 @@
 #include <utility>
 #include <vector>
 
+#include "clang/Basic/DiagnosticOptions.h"
 #include "clang/Basic/SourceLocation.h"
 
 #include "clang/Frontend/FrontendDiagnostic.h"
+#include "clang/Frontend/Utils.h"
 
 #include "clang/Sema/SemaDiagnostic.h"
 
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "os_sep.h"
 #include "rs_cc_options.h"
+#include "slang_output_sink.h"
 #include "slang_rs_backend.h"
 #include "slang_rs_context.h"
 #include "slang_rs_export_type.h"
 
 #include "slang_rs_reflection.h"
 #include "slang_rs_reflection_cpp.h"
+#include "slang_utils.h"
 
 namespace slang {
 
@@ -76,6 +87,86 @@ bool SlangRS::isFilterscript(const char *Filename) {
   }
 }
 
+std::string SlangRS::computeCacheKey(const RSCCOptions &Opts,
+                                     const char *OutputFile,
+                                     const char *DepOutputFile) {
+  RSCompileCache::KeyBuilder Key;
+  Key.addOptions(Opts);
+
+  // The output paths end up in the reflected sources and the dependency
+  // file.
+  Key << "input " << getInputFileName() << '\n'
+      << "output " << OutputFile << '\n'
+      << "output32 " << getOutput32FileName() << '\n';
+  if (DepOutputFile != NULL) {
+    Key << "dep " << DepOutputFile << '\n';
+  }
+  // Only the file name of the profile is in the options.
+  if (mProfile.get() != NULL) {
+    Key << "profile\n";
+    mProfile->write(Key);
+  }
+
+  preprocess(Key);
+
+  return Key.getKey();
+}
+
+std::string SlangRS::GetOutputFileName(const std::string &OutputDir,
+                                       const std::string &PathSuffix,
+                                       const char *InputFile,
+                                       Slang::OutputType OutputType) {
+  std::string OutputFile(OutputDir);
+
+  // Append '/' to Opts.mBitcodeOutputDir if not presents
+  if (!OutputFile.empty() &&
+      (OutputFile[OutputFile.size() - 1]) != OS_PATH_SEPARATOR)
+    OutputFile.append(1, OS_PATH_SEPARATOR);
+
+  if (!PathSuffix.empty()) {
+    OutputFile.append(PathSuffix);
+    OutputFile.append(1, OS_PATH_SEPARATOR);
+  }
+
+  if (OutputType == Slang::OT_Dependency) {
+    // The build system wants the .d file name stem to be exactly the same as
+    // the source .rs file, instead of the .bc file.
+    OutputFile.append(RSSlangReflectUtils::GetFileNameStem(InputFile));
+  } else {
+    OutputFile.append(
+        RSSlangReflectUtils::BCFileNameFromRSFileName(InputFile));
+  }
+
+  switch (OutputType) {
+    case Slang::OT_Dependency: {
+      OutputFile.append(".d");
+      break;
+    }
+    case Slang::OT_Assembly: {
+      OutputFile.append(".S");
+      break;
+    }
+    case Slang::OT_LLVMAssembly: {
+      OutputFile.append(".ll");
+      break;
+    }
+    case Slang::OT_Object: {
+      OutputFile.append(".o");
+      break;
+    }
+    case Slang::OT_Bitcode: {
+      OutputFile.append(".bc");
+      break;
+    }
+    case Slang::OT_Nothing:
+    default: {
+      slangAssert(false && "Invalid output type!");
+    }
+  }
+
+  return OutputFile;
+}
+
 bool SlangRS::generateJavaBitcodeAccessor(const std::string &OutputPathBase,
                                           const std::string &PackageName,
                                           const std::string *LicenseNote) {
@@ -89,11 +180,129 @@ bool SlangRS::generateJavaBitcodeAccessor(const std::string &OutputPathBase,
   BCAccessorContext.licenseNote = LicenseNote;
   BCAccessorContext.bcStorage = BCST_JAVA_CODE;   // Must be BCST_JAVA_CODE
   BCAccessorContext.verbose = false;
+  BCAccessorContext.sink = getOutputSink();
 
   return RSSlangReflectUtils::GenerateJavaBitCodeAccessor(BCAccessorContext);
 }
 
-bool SlangRS::checkODR(const char *CurInputFile) {
+// Append a description of @ET to @Sig. The description distinguishes exactly
+// the types RSExportType::equals() does.
+static void AppendTypeSignature(const RSExportType *ET, std::string *Sig) {
+  switch (ET->getClass()) {
+    case RSExportType::ExportClassPrimitive: {
+      const RSExportPrimitiveType *EPT =
+          static_cast<const RSExportPrimitiveType*>(ET);
+      Sig->append("P").append(llvm::utostr(EPT->getType()));
+      break;
+    }
+    case RSExportType::ExportClassPointer: {
+      Sig->append("*");
+      AppendTypeSignature(
+          static_cast<const RSExportPointerType*>(ET)->getPointeeType(), Sig);
+      break;
+    }
+    case RSExportType::ExportClassVector: {
+      const RSExportVectorType *EVT =
+          static_cast<const RSExportVectorType*>(ET);
+      Sig->append("V").append(llvm::utostr(EVT->getType()))
+          .append("x").append(llvm::utostr(EVT->getNumElement()));
+      break;
+    }
+    case RSExportType::ExportClassMatrix: {
+      Sig->append("M").append(llvm::utostr(
+          static_cast<const RSExportMatrixType*>(ET)->getDim()));
+      break;
+    }
+    case RSExportType::ExportClassConstantArray: {
+      const RSExportConstantArrayType *CAT =
+          static_cast<const RSExportConstantArrayType*>(ET);
+      Sig->append("A").append(llvm::utostr(CAT->getSize())).append("[");
+      AppendTypeSignature(CAT->getElementType(), Sig);
+      Sig->append("]");
+      break;
+    }
+    case RSExportType::ExportClassRecord: {
+      const RSExportRecordType *ERT =
+          static_cast<const RSExportRecordType*>(ET);
+      Sig->append("{");
+      for (RSExportRecordType::const_field_iterator FI = ERT->fields_begin(),
+               FE = ERT->fields_end();
+           FI != FE;
+           FI++) {
+        AppendTypeSignature((*FI)->getType(), Sig);
+        Sig->append(";");
+      }
+      Sig->append("}");
+      break;
+    }
+    default: {
+      slangAssert(false && "Unknown class of type");
+    }
+  }
+}
+
+std::string SlangRS::GetODRSignature(const RSExportRecordType *ERT) {
+  // We say two record types A and B have the same definition iff:
+  //
+  //  struct A {              struct B {
+  //    Type(a1) a1,            Type(b1) b1,
+  //    Type(a2) a2,            Type(b1) b2,
+  //    ...                     ...
+  //    Type(aN) aN             Type(b3) b3,
+  //  };                      }
+  //  Cond. #1. They have same number of fields, i.e., N = M;
+  //  Cond. #2. for (i := 1 to N)
+  //              Type(ai) = Type(bi) must hold;
+  //  Cond. #3. for (i := 1 to N)
+  //              Name(ai) = Name(bi) must hold;
+  //
+  // where,
+  //  Type(F) = the type of field F and
+  //  Name(F) = the field name.
+  //
+  // Cond. #1 and Cond. #2 are covered by the type signature of ERT, Cond. #3
+  // by appending the field names to it.
+  std::string Sig;
+  AppendTypeSignature(ERT, &Sig);
+  for (RSExportRecordType::const_field_iterator FI = ERT->fields_begin(),
+           FE = ERT->fields_end();
+       FI != FE;
+       FI++) {
+    Sig.append(" ").append((*FI)->getName());
+  }
+  return Sig;
+}
+
+bool SlangRS::checkODR(llvm::StringRef Name, llvm::StringRef Signature,
+                       const std::string &InputFile) {
+  ReflectedDefinitionListTy::const_iterator RD =
+      ReflectedDefinitions.find(Name);
+
+  if (RD != ReflectedDefinitions.end()) {
+    // There's a record (struct) with the same name reflected before. Enforce
+    // ODR checking - the Reflected must hold *exactly* the same "definition"
+    // as the one defined previously.
+    if (RD->getValue().first != Signature) {
+      getDiagnostics().Report(mDiagErrorODR) << Name
+                                             << InputFile
+                                             << RD->getValue().second;
+      return false;
+    }
+  } else {
+    llvm::StringMapEntry<ReflectedDefinitionTy> *ME =
+        llvm::StringMapEntry<ReflectedDefinitionTy>::Create(Name);
+    ME->setValue(std::make_pair(Signature.str(), InputFile));
+
+    if (ReflectedDefinitions.insert(ME))
+      ReflectedDefinitionOrder.push_back(ME);
+    else
+      delete ME;
+  }
+  return true;
+}
+
+void SlangRS::collectODRDefinitions(
+    std::vector<std::pair<std::string, std::string> > *Definitions) {
   for (RSContext::ExportableList::iterator I = mRSContext->exportable_begin(),
           E = mRSContext->exportable_end();
        I != E;
@@ -113,67 +322,18 @@ bool SlangRS::checkODR(const char *CurInputFile) {
     if (ERT->isArtificial())
       continue;
 
-    // Key to lookup ERT in ReflectedDefinitions
-    llvm::StringRef RDKey(ERT->getName());
-    ReflectedDefinitionListTy::const_iterator RD =
-        ReflectedDefinitions.find(RDKey);
-
-    if (RD != ReflectedDefinitions.end()) {
-      const RSExportRecordType *Reflected = RD->getValue().first;
-      // There's a record (struct) with the same name reflected before. Enforce
-      // ODR checking - the Reflected must hold *exactly* the same "definition"
-      // as the one defined previously. We say two record types A and B have the
-      // same definition iff:
-      //
-      //  struct A {              struct B {
-      //    Type(a1) a1,            Type(b1) b1,
-      //    Type(a2) a2,            Type(b1) b2,
-      //    ...                     ...
-      //    Type(aN) aN             Type(b3) b3,
-      //  };                      }
-      //  Cond. #1. They have same number of fields, i.e., N = M;
-      //  Cond. #2. for (i := 1 to N)
-      //              Type(ai) = Type(bi) must hold;
-      //  Cond. #3. for (i := 1 to N)
-      //              Name(ai) = Name(bi) must hold;
-      //
-      // where,
-      //  Type(F) = the type of field F and
-      //  Name(F) = the field name.
-
-      bool PassODR = false;
-      // Cond. #1 and Cond. #2
-      if (Reflected->equals(ERT)) {
-        // Cond #3.
-        RSExportRecordType::const_field_iterator AI = Reflected->fields_begin(),
-                                                 BI = ERT->fields_begin();
-
-        for (unsigned i = 0, e = Reflected->getFields().size(); i != e; i++) {
-          if ((*AI)->getName() != (*BI)->getName())
-            break;
-          AI++;
-          BI++;
-        }
-        PassODR = (AI == (Reflected->fields_end()));
-      }
-
-      if (!PassODR) {
-        getDiagnostics().Report(mDiagErrorODR) << Reflected->getName()
-                                               << getInputFileName()
-                                               << RD->getValue().second;
-        return false;
-      }
-    } else {
-      llvm::StringMapEntry<ReflectedDefinitionTy> *ME =
-          llvm::StringMapEntry<ReflectedDefinitionTy>::Create(RDKey);
-      ME->setValue(std::make_pair(ERT, CurInputFile));
-
-      if (!ReflectedDefinitions.insert(ME))
-        delete ME;
+    Definitions->push_back(std::make_pair(ERT->getName(),
+                                          GetODRSignature(ERT)));
+  }
+}
 
-      // Take the ownership of ERT such that it won't be freed in ~RSContext().
-      ERT->keep();
-    }
+bool SlangRS::checkODR(const char *CurInputFile) {
+  std::vector<std::pair<std::string, std::string> > Definitions;
+  collectODRDefinitions(&Definitions);
+  for (unsigned i = 0, e = Definitions.size(); i != e; i++) {
+    if (!checkODR(Definitions[i].first, Definitions[i].second,
+                  getInputFileName()))
+      return false;
   }
   return true;
 }
@@ -206,6 +366,17 @@ void SlangRS::initDiagnostic() {
     DiagEngine.getCustomDiagID(
       clang::DiagnosticsEngine::Error,
       "target API level '%0' is out of range ('%1' - '%2')");
+
+  mDiagErrorProfile =
+    DiagEngine.getCustomDiagID(
+      clang::DiagnosticsEngine::Error,
+      "invalid profile: %0");
+
+  mDiagWarnOsBitcodeTargetAPI =
+    DiagEngine.getCustomDiagID(
+      clang::DiagnosticsEngine::Warning,
+      "-Os-bitcode has no effect for target API level '%0' (requires '%1' "
+      "or later)");
 }
 
 void SlangRS::initPreprocessor() {
@@ -221,6 +392,7 @@ void SlangRS::initPreprocessor() {
 void SlangRS::initASTContext() {
   mRSContext = new RSContext(getPreprocessor(),
                              getASTContext(),
+                             getLLVMContext(),
                              getTargetInfo(),
                              &mPragmas,
                              mTargetAPI,
@@ -229,8 +401,13 @@ void SlangRS::initASTContext() {
 
 clang::ASTConsumer
 *SlangRS::createBackend(const clang::CodeGenOptions& CodeGenOpts,
-                        llvm::raw_ostream *OS,
+                        llvm::raw_string_ostream *OS,
                         Slang::OutputType OT) {
+    // The profiles name the scripts after their input files.
+    BackendOptions BackendOpts = getBackendOptions();
+    BackendOpts.ScriptName =
+        RSSlangReflectUtils::GetFileNameStem(getInputFileName().c_str());
+
     return new RSBackend(mRSContext,
                          &getDiagnostics(),
                          CodeGenOpts,
@@ -240,7 +417,9 @@ clang::ASTConsumer
                          OT,
                          getSourceManager(),
                          mAllowRSPrefix,
-                         mIsFilterscript);
+                         mIsFilterscript,
+                         getPhaseReport(),
+                         BackendOpts);
 }
 
 bool SlangRS::IsRSHeaderFile(const char *File) {
@@ -265,6 +444,37 @@ bool SlangRS::IsLocInRSHeaderFile(const clang::SourceLocation &Loc,
   }
 }
 
+std::string SlangRS::GetPCHFileName(const std::string &PCHDir,
+                                    const RSCCOptions &Opts) {
+  // The include paths and the overlays decide which headers get precompiled.
+  // An overlay may be edited to map other files under the same paths, so its
+  // contents are hashed as well.
+  llvm::MD5 Hash;
+  for (unsigned i = 0, e = Opts.mIncludePaths.size(); i != e; i++) {
+    Hash.update(Opts.mIncludePaths[i] + "\n");
+  }
+  for (unsigned i = 0, e = Opts.mVFSOverlayFiles.size(); i != e; i++) {
+    Hash.update("-ivfsoverlay " + Opts.mVFSOverlayFiles[i] + "\n");
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > Overlay =
+        llvm::MemoryBuffer::getFile(Opts.mVFSOverlayFiles[i]);
+    if (!Overlay.getError()) {
+      Hash.update(Overlay.get()->getBuffer());
+    }
+  }
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  llvm::SmallString<32> HashStr;
+  llvm::MD5::stringifyResult(Result, HashStr);
+
+  std::stringstream FileName;
+  FileName << "rs_core-" << Opts.mTargetAPI << "-" << Opts.mBitWidth << "-"
+           << HashStr.str().str() << ".pch";
+
+  llvm::SmallString<256> Path(PCHDir);
+  llvm::sys::path::append(Path, FileName.str());
+  return Path.str();
+}
+
 SlangRS::SlangRS()
   : Slang(), mRSContext(NULL), mAllowRSPrefix(false), mTargetAPI(0),
     mVerbose(false), mIsFilterscript(false) {
@@ -298,6 +508,10 @@ bool SlangRS::compile(
       DepFileIter = DepFiles.begin();
 
   setIncludePaths(Opts.mIncludePaths);
+  for (unsigned i = 0, e = Opts.mVFSOverlayFiles.size(); i != e; i++) {
+    if (!addVFSOverlay(Opts.mVFSOverlayFiles[i]))
+      return false;
+  }
   setOutputType(Opts.mOutputType);
   if (Opts.mEmitDependency) {
     setAdditionalDepTargets(Opts.mAdditionalDepTargets);
@@ -307,6 +521,8 @@ bool SlangRS::compile(
 
   setOptimizationLevel(Opts.mOptimizationLevel);
 
+  setStructPathTBAA(Opts.mStructPathTBAA);
+
   mAllowRSPrefix = Opts.mAllowRSPrefix;
 
   mTargetAPI = Opts.mTargetAPI;
@@ -318,35 +534,136 @@ bool SlangRS::compile(
     return false;
   }
 
+  // The older bitcode writers of the targets before JB have no size-optimized
+  // encoding (see Backend::HandleTranslationUnit()).
+  if (Opts.mOptimizeBitcodeSize && (mTargetAPI < SLANG_JB_TARGET_API)) {
+    getDiagnostics().Report(mDiagWarnOsBitcodeTargetAPI) << mTargetAPI
+        << SLANG_JB_TARGET_API;
+  }
+
   mVerbose = Opts.mVerbose;
 
-  // Skip generation of warnings a second time if we are doing more than just
-  // a single pass over the input file.
-  bool SuppressAllWarnings = (Opts.mOutputType != Slang::OT_Dependency);
+  mProfile.reset();
+  if (!Opts.mProfileUseFile.empty()) {
+    std::string Error;
+    mProfile.reset(new Profile());
+    if (!mProfile->read(Opts.mProfileUseFile, &Error)) {
+      getDiagnostics().Report(mDiagErrorProfile) << Error;
+      return false;
+    }
+  }
+
+  BackendOptions BackendOpts;
+  BackendOpts.OptimizeBitcodeSize = Opts.mOptimizeBitcodeSize;
+  BackendOpts.StripBitcode = Opts.mStripBitcode;
+  BackendOpts.EmitBitcodeIndex = Opts.mEmitBitcodeIndex;
+  BackendOpts.BitcodeWriterThreads = Opts.mBitcodeWriterThreads;
+  BackendOpts.ProfileGenerate = Opts.mProfileGenerate;
+  BackendOpts.ProfileUse = mProfile.get();
+  setBackendOptions(BackendOpts);
+
+  // The precompiled header only helps when we build ASTs.
+  std::string PCHFile;
+  if (!Opts.mPCHDir.empty() && (Opts.mOutputType != Slang::OT_Dependency)) {
+    std::string Error;
+    if (SlangUtils::CreateDirectoryWithParents(Opts.mPCHDir, &Error)) {
+      PCHFile = GetPCHFileName(Opts.mPCHDir, Opts);
+      if (!usePCH(PCHFile))
+        PCHFile.clear();
+    }
+  }
+
+  mCache.reset();
+  if (!Opts.mCacheDir.empty() &&
+      (Opts.mOutputType != Slang::OT_Dependency) &&
+      (Opts.mOutputType != Slang::OT_Nothing)) {
+    mCache.reset(new RSCompileCache(Opts.mCacheDir, getOutputSink()));
+  }
 
   bool CompileSecondTimeFor64Bit = Opts.mEmit3264 && Opts.mBitWidth == 64;
 
-  for (unsigned i = 0, e = IOFiles32.size(); i != e; i++) {
+  for (unsigned i = 0, e = IOFiles32.size(); i != e;
+       i++, IOFile64Iter++, IOFile32Iter++) {
     InputFile = IOFile64Iter->first;
     Output64File = IOFile64Iter->second;
     Output32File = IOFile32Iter->second;
 
+    getOutputSink()->beginInput(InputFile);
+
     // We suppress warnings (via reset) if we are doing a second compilation.
     reset(CompileSecondTimeFor64Bit);
 
+    if (getPhaseReport() != NULL) {
+      // Tell apart the 32-bit and 64-bit compilations of the same file.
+      std::string PhaseFile = InputFile;
+      if (Opts.mEmit3264)
+        PhaseFile += (Opts.mBitWidth == 64) ? " (64-bit)" : " (32-bit)";
+      getPhaseReport()->setCurrentFile(PhaseFile);
+    }
+
     if (!setInputSource(InputFile))
       return false;
 
+    setOutput32(Output32File);
+
+    // The dependency file does not depend on the bit width, so we only write
+    // it once on the 64-bit path when emitting both 32-bit and 64-bit
+    // bitcode, naming the 64-bit bitcode as its target (with -M too).
+    bool doDependency = Opts.mEmitDependency;
+    if (Opts.mEmit3264 && (Opts.mBitWidth == 32)) {
+      doDependency = false;
+    }
+
+    // Unless we are only emitting dependencies (-M), they are recorded during
+    // the compilation instead of preprocessing the input a second time.
+    bool RecordDependency =
+        doDependency && (Opts.mOutputType != Slang::OT_Dependency);
+
+    if (doDependency) {
+      BCOutputFile = DepFileIter->first;
+      DepOutputFile = DepFileIter->second;
+      DepFileIter++;
+
+      setDepTargetBC(BCOutputFile);
+    }
+
+    // Files written for this input (for the compilation cache).
+    RSCompileCache::Entry CacheEntry;
+    std::string CacheKey;
+    if (mCache.get() != NULL) {
+      CacheKey = computeCacheKey(Opts, Output64File,
+                                 doDependency ? DepOutputFile : NULL);
+      if (mCache->restore(CacheKey, &CacheEntry)) {
+        getDiagnosticBuffer()->append(CacheEntry.Diagnostics);
+        for (unsigned j = 0, je = CacheEntry.Definitions.size(); j != je;
+             j++) {
+          if (!checkODR(CacheEntry.Definitions[j].first,
+                        CacheEntry.Definitions[j].second, getInputFileName()))
+            return false;
+        }
+        continue;
+      }
+      CacheEntry.Files.push_back(RSCompileCache::FileTy(Output64File, ""));
+    }
+
     if (!setOutput(Output64File))
       return false;
 
-    setOutput32(Output32File);
+    if (RecordDependency && !setDepOutput(DepOutputFile))
+      return false;
 
     mIsFilterscript = isFilterscript(InputFile);
 
     if (Slang::compile() > 0)
       return false;
 
+    // Nothing but the bitcode is written yet: an input defining a record type
+    // differently from a previous one leaves no output.
+    if (!checkODR(InputFile)) {
+      getOutputSink()->removeFile(getOutputFileName());
+      return false;
+    }
+
     if (!Opts.mJavaReflectionPackageName.empty()) {
       mRSContext->setReflectJavaPackageName(Opts.mJavaReflectionPackageName);
     }
@@ -360,15 +677,24 @@ bool SlangRS::compile(
       doReflection = false;
     }
     if (Opts.mOutputType != Slang::OT_Dependency && doReflection) {
+      PhaseTimer Timer(getPhaseReport(), PhaseReport::PH_Reflection);
 
       if (Opts.mBitcodeStorage == BCST_CPP_CODE) {
         const std::string &outputFileName = (Opts.mBitWidth == 64) ?
             getOutputFileName() : getOutput32FileName();
         RSReflectionCpp R(mRSContext, Opts.mJavaReflectionPathBase,
-                          getInputFileName(), outputFileName);
+                          getInputFileName(), outputFileName,
+                          getOutputSink());
         if (!R.reflect()) {
             return false;
         }
+
+        std::string ClassPath = JoinPath(Opts.mJavaReflectionPathBase,
+            "ScriptC_" + RootNameFromRSFileName(getInputFileName()));
+        CacheEntry.Files.push_back(
+            RSCompileCache::FileTy(ClassPath + ".h", ""));
+        CacheEntry.Files.push_back(
+            RSCompileCache::FileTy(ClassPath + ".cpp", ""));
       } else {
         if (!Opts.mRSPackageName.empty()) {
           mRSContext->setRSPackageName(Opts.mRSPackageName);
@@ -377,7 +703,8 @@ bool SlangRS::compile(
         RSReflectionJava R(mRSContext, &mGeneratedFileNames,
                            Opts.mJavaReflectionPathBase, getInputFileName(),
                            getOutputFileName(),
-                           Opts.mBitcodeStorage == BCST_JAVA_CODE);
+                           Opts.mBitcodeStorage == BCST_JAVA_CODE,
+                           getOutputSink());
         if (!R.reflect()) {
           // TODO Is this needed or will the error message have been printed
           // already? and why not for the C++ case?
@@ -395,49 +722,152 @@ bool SlangRS::compile(
               Opts.mJavaReflectionPathBase.c_str(),
               (RealPackageName + OS_PATH_SEPARATOR_STR + *I).c_str());
           appendGeneratedFileName(ReflectedName + ".java");
+          CacheEntry.Files.push_back(
+              RSCompileCache::FileTy(ReflectedName + ".java", ""));
         }
 
         if ((Opts.mOutputType == Slang::OT_Bitcode) &&
-            (Opts.mBitcodeStorage == BCST_JAVA_CODE) &&
-            !generateJavaBitcodeAccessor(Opts.mJavaReflectionPathBase,
-                                         RealPackageName.c_str(),
-                                         mRSContext->getLicenseNote())) {
-          return false;
+            (Opts.mBitcodeStorage == BCST_JAVA_CODE)) {
+          if (!generateJavaBitcodeAccessor(Opts.mJavaReflectionPathBase,
+                                           RealPackageName.c_str(),
+                                           mRSContext->getLicenseNote())) {
+            return false;
+          }
+
+          std::string AccessorName = RSSlangReflectUtils::ComputePackagedPath(
+              Opts.mJavaReflectionPathBase.c_str(),
+              (RealPackageName + OS_PATH_SEPARATOR_STR +
+               RSSlangReflectUtils::JavaBitcodeClassNameFromRSFileName(
+                   InputFile)).c_str());
+          CacheEntry.Files.push_back(
+              RSCompileCache::FileTy(AccessorName + ".java", ""));
         }
       }
     }
 
-    if (Opts.mEmitDependency) {
-      BCOutputFile = DepFileIter->first;
-      DepOutputFile = DepFileIter->second;
-
-      setDepTargetBC(BCOutputFile);
-
-      if (!setDepOutput(DepOutputFile))
+    if (doDependency) {
+      if (!RecordDependency && !setDepOutput(DepOutputFile))
         return false;
 
-      if (SuppressAllWarnings) {
-        getDiagnostics().setSuppressAllDiagnostics(true);
-      }
       if (generateDepFile() > 0)
         return false;
-      if (SuppressAllWarnings) {
-        getDiagnostics().setSuppressAllDiagnostics(false);
-      }
 
-      DepFileIter++;
+      CacheEntry.Files.push_back(RSCompileCache::FileTy(DepOutputFile, ""));
     }
 
-    if (!checkODR(InputFile))
-      return false;
+    if (mCache.get() != NULL) {
+      CacheEntry.Diagnostics = getDiagnosticBuffer()->str();
+      collectODRDefinitions(&CacheEntry.Definitions);
+      mCache->store(CacheKey, &CacheEntry);
+    }
+  }
 
-    IOFile64Iter++;
-    IOFile32Iter++;
+  if (mVerbose && (mCache.get() != NULL)) {
+    mCache->printStats(llvm::outs());
+  }
+  if (mVerbose && !PCHFile.empty()) {
+    llvm::outs() << "Precompiled header " << PCHFile << ": "
+                 << (isPCHGenerated() ? "generated" : "reused")
+                 << ", loaded for " << getNumPCHLoads() << " input(s)\n";
   }
 
   return true;
 }
 
+bool SlangRS::CompileInMemory(const std::string &InputFile,
+                              llvm::StringRef Source,
+                              const RSCCOptions &Options,
+                              MemoryOutputSink *Outputs,
+                              std::string *Diagnostics,
+                              const VirtualFileList *Headers) {
+  slangAssert((Outputs != NULL) && (Diagnostics != NULL) &&
+              "Invalid parameter!");
+
+  // The compilation cache and the precompiled headers live on disk. The
+  // caller may run other compilations at the same time, so the bitcode is
+  // written on its thread only.
+  RSCCOptions Opts(Options);
+  Opts.mCacheDir.clear();
+  Opts.mPCHDir.clear();
+  Opts.mBitcodeWriterThreads = 1;
+
+  DiagnosticBuffer *DiagClient = new DiagnosticBuffer();
+  llvm::IntrusiveRefCntPtr<clang::DiagnosticIDs> DiagIDs(
+      new clang::DiagnosticIDs());
+  llvm::IntrusiveRefCntPtr<clang::DiagnosticOptions> DiagOpts(
+      new clang::DiagnosticOptions());
+  DiagOpts->IgnoreWarnings = Opts.mIgnoreWarnings;
+  DiagOpts->Warnings = Opts.mWarningOptions;
+  clang::DiagnosticsEngine DiagEngine(DiagIDs, &*DiagOpts, DiagClient, true);
+  clang::ProcessWarningOptions(DiagEngine, *DiagOpts);
+
+  llvm::raw_string_ostream DiagnosticsOS(*Diagnostics);
+
+  // Run the same passes as llvm-rs-cc. When emitting both 32-bit and 64-bit
+  // bitcode, the reflection of the 64-bit pass reads the 32-bit bitcode back
+  // from Outputs, and only the 64-bit pass writes the dependency file (with
+  // -M too).
+  typedef std::list<std::pair<const char*, const char*> > NamePairList;
+  unsigned NumPasses = 1;
+  if (Opts.mEmit3264) {
+    Opts.mBitWidth = 32;
+    NumPasses = 2;
+  }
+
+  std::string Output32File;
+  NamePairList IOFiles32;
+  bool Success = true;
+  for (unsigned Pass = 0; Success && (Pass < NumPasses); Pass++) {
+    bool CompileSecondTimeFor64Bit = (Pass == 1);
+    std::string PathSuffix;
+    if (Opts.mEmit3264) {
+      PathSuffix = CompileSecondTimeFor64Bit ? "bc64" : "bc32";
+      if (CompileSecondTimeFor64Bit)
+        Opts.mBitWidth = 64;
+    }
+
+    std::string BCOutputFile = GetOutputFileName(Opts.mBitcodeOutputDir,
+                                                 PathSuffix, InputFile.c_str(),
+                                                 Slang::OT_Bitcode);
+    std::string OutputFile = BCOutputFile;
+    std::string DepOutputFile;
+    NamePairList DepFiles;
+    if (Opts.mEmitDependency) {
+      DepOutputFile = GetOutputFileName(Opts.mDependencyOutputDir, "",
+                                        InputFile.c_str(),
+                                        Slang::OT_Dependency);
+      if (Opts.mOutputType == Slang::OT_Dependency)
+        OutputFile = DepOutputFile;
+      DepFiles.push_back(std::make_pair(BCOutputFile.c_str(),
+                                        DepOutputFile.c_str()));
+    }
+
+    NamePairList IOFiles;
+    IOFiles.push_back(std::make_pair(InputFile.c_str(), OutputFile.c_str()));
+    if (!CompileSecondTimeFor64Bit) {
+      Output32File = OutputFile;
+      IOFiles32.push_back(std::make_pair(InputFile.c_str(),
+                                         Output32File.c_str()));
+    }
+
+    SlangRS Compiler;
+    Compiler.init(Opts.mBitWidth, &DiagEngine, DiagClient);
+    Compiler.setOutputSink(Outputs);
+    Compiler.setDiagnosticsOutput(&DiagnosticsOS);
+    if (Headers != NULL) {
+      for (unsigned i = 0, e = Headers->size(); i != e; i++)
+        Compiler.addVirtualFile((*Headers)[i].first, (*Headers)[i].second);
+    }
+    Success = Compiler.addVirtualFile(InputFile, Source) &&
+              Compiler.compile(IOFiles, IOFiles32, DepFiles, Opts);
+    // We suppress warnings (via reset) if we are doing a second compilation.
+    Compiler.reset(CompileSecondTimeFor64Bit);
+  }
+
+  DiagnosticsOS.flush();
+  return Success;
+}
+
 void SlangRS::reset(bool SuppressWarnings) {
   delete mRSContext;
   mRSContext = NULL;
@@ -447,12 +877,6 @@ void SlangRS::reset(bool SuppressWarnings) {
 
 SlangRS::~SlangRS() {
   delete mRSContext;
-  for (ReflectedDefinitionListTy::iterator I = ReflectedDefinitions.begin(),
-          E = ReflectedDefinitions.end();
-       I != E;
-       I++) {
-    delete I->getValue().first;
-  }
 }
 
 }  // namespace slang
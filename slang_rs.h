@@ -20,12 +20,15 @@
 #include "slang.h"
 
 #include <list>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "llvm/ADT/StringMap.h"
 
+#include "slang_profile.h"
+#include "slang_rs_compile_cache.h"
 #include "slang_rs_reflect_utils.h"
 #include "slang_version.h"
 
@@ -47,10 +50,15 @@ class SlangRS : public Slang {
 
   bool mIsFilterscript;
 
+  // The profile of -fprofile-use (NULL if not given).
+  std::unique_ptr<Profile> mProfile;
+
   // Custom diagnostic identifiers
   unsigned mDiagErrorInvalidOutputDepParameter;
   unsigned mDiagErrorODR;
   unsigned mDiagErrorTargetAPIRange;
+  unsigned mDiagErrorProfile;
+  unsigned mDiagWarnOsBitcodeTargetAPI;
 
   // Collect generated filenames (without the .java) for dependency generation
   std::vector<std::string> mGeneratedFileNames;
@@ -59,23 +67,52 @@ class SlangRS : public Slang {
   //        check ODR on record type.
   //
   // ReflectedDefinitions maps record type name to a pair:
-  //  <its RSExportRecordType instance,
+  //  <the ODR signature of its definition (see GetODRSignature()),
   //   the first file contains this record type definition>
-  typedef std::pair<RSExportRecordType*, const char*> ReflectedDefinitionTy;
+  typedef std::pair<std::string, std::string> ReflectedDefinitionTy;
   typedef llvm::StringMap<ReflectedDefinitionTy> ReflectedDefinitionListTy;
   ReflectedDefinitionListTy ReflectedDefinitions;
 
+  // The entries of ReflectedDefinitions, in the order they were first
+  // reflected (i.e. the order of the inputs).
+  typedef std::vector<const llvm::StringMapEntry<ReflectedDefinitionTy> *>
+      ReflectedDefinitionOrderTy;
+  ReflectedDefinitionOrderTy ReflectedDefinitionOrder;
+
+  // The compilation cache (NULL if -cache-dir is not given).
+  std::unique_ptr<RSCompileCache> mCache;
+
   bool generateJavaBitcodeAccessor(const std::string &OutputPathBase,
                                    const std::string &PackageName,
                                    const std::string *LicenseNote);
 
-  // CurInputFile is the pointer to a char array holding the input filename
-  // and is valid before compile() ends.
+  // Check ODR on all record types exported from the file just compiled.
   bool checkODR(const char *CurInputFile);
 
+  // Collect the <name, ODR signature> of all record types exported from the
+  // file just compiled.
+  void collectODRDefinitions(
+      std::vector<std::pair<std::string, std::string> > *Definitions);
+
+  // Compute the key in the compilation cache of the input file set up by
+  // setInputSource(). @DepOutputFile is NULL if no dependency file is written.
+  std::string computeCacheKey(const RSCCOptions &Opts,
+                              const char *OutputFile,
+                              const char *DepOutputFile);
+
+  // Compute a string describing the definition of @ERT. Two record types
+  // conform to the ODR iff their signatures are identical.
+  static std::string GetODRSignature(const RSExportRecordType *ERT);
+
   // Returns true if this is a Filterscript file.
   static bool isFilterscript(const char *Filename);
 
+  // Returns the path of the precompiled rs_core header in @PCHDir to use
+  // with the given options. Different target APIs, bit widths and include
+  // paths use different files.
+  static std::string GetPCHFileName(const std::string &PCHDir,
+                                    const RSCCOptions &Opts);
+
  protected:
   virtual void initDiagnostic();
   virtual void initPreprocessor();
@@ -83,7 +120,7 @@ class SlangRS : public Slang {
 
   virtual clang::ASTConsumer
   *createBackend(const clang::CodeGenOptions& CodeGenOpts,
-                 llvm::raw_ostream *OS,
+                 llvm::raw_string_ostream *OS,
                  Slang::OutputType OT);
 
 
@@ -112,6 +149,56 @@ class SlangRS : public Slang {
                const std::list<std::pair<const char*, const char*> > &DepFiles,
                const RSCCOptions &Opts);
 
+  // List of pairs of <path, contents> of files only kept in memory.
+  typedef std::vector<std::pair<std::string, std::string> > VirtualFileList;
+
+  // Compile @Source as the contents of @InputFile, without writing to the
+  // filesystem: the bitcode, reflected and dependency files are handed to
+  // @Outputs under the paths llvm-rs-cc would write them to (see
+  // GetOutputFileName()), and the diagnostics are appended to @Diagnostics.
+  // The files in @Headers (if any) are found through the include paths as if
+  // they were on disk, and take precedence over the ones that are. The other
+  // headers are read from disk. The compilation cache and the precompiled
+  // headers of @Opts are not used, and the bitcode is written on the calling
+  // thread only.
+  //
+  // Returns true if @InputFile compiled without errors.
+  static bool CompileInMemory(const std::string &InputFile,
+                              llvm::StringRef Source,
+                              const RSCCOptions &Opts,
+                              MemoryOutputSink *Outputs,
+                              std::string *Diagnostics,
+                              const VirtualFileList *Headers = NULL);
+
+  // Returns the path of the output of type @OutputType for @InputFile:
+  // @OutputDir[/@PathSuffix]/<name>.<ext>. The dependency file is named after
+  // the stem of @InputFile, the others after its bitcode name (see
+  // RSSlangReflectUtils::BCFileNameFromRSFileName()).
+  static std::string GetOutputFileName(const std::string &OutputDir,
+                                       const std::string &PathSuffix,
+                                       const char *InputFile,
+                                       Slang::OutputType OutputType);
+
+  // Enforce the ODR on a record type named @Name defined in @InputFile, whose
+  // definition is described by @Signature. The first definition seen for a
+  // name is remembered and later ones are checked against it. This allows
+  // definitions reflected by other SlangRS instances (e.g. the ones in the
+  // worker processes of llvm-rs-cc -jobs) to be merged in. Return false on
+  // violation.
+  bool checkODR(llvm::StringRef Name, llvm::StringRef Signature,
+                const std::string &InputFile);
+
+  // The definitions reflected so far, in the order they were first
+  // reflected.
+  typedef ReflectedDefinitionOrderTy::const_iterator
+      const_reflected_definition_iterator;
+  const_reflected_definition_iterator reflected_definitions_begin() const {
+    return ReflectedDefinitionOrder.begin();
+  }
+  const_reflected_definition_iterator reflected_definitions_end() const {
+    return ReflectedDefinitionOrder.end();
+  }
+
   virtual void reset(bool SuppressWarnings = false);
 
   virtual ~SlangRS();
@@ -25,17 +25,22 @@
 #include "llvm/ADT/Twine.h"
 #include "llvm/ADT/StringExtras.h"
 
+#include "llvm/Analysis/LoopInfo.h"
+
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
 
 #include "llvm/IR/DebugLoc.h"
 
 #include "slang_assert.h"
+#include "slang_profile.h"
 #include "slang_rs.h"
 #include "slang_rs_context.h"
 #include "slang_rs_export_foreach.h"
@@ -43,20 +48,26 @@
 #include "slang_rs_export_type.h"
 #include "slang_rs_export_var.h"
 #include "slang_rs_metadata.h"
+#include "strip_unknown_attributes.h"
 
 namespace slang {
 
+const char RSBackend::kProfileDumpHook[] = "__rs_profile_dump";
+
 RSBackend::RSBackend(RSContext *Context,
                      clang::DiagnosticsEngine *DiagEngine,
                      const clang::CodeGenOptions &CodeGenOpts,
                      const clang::TargetOptions &TargetOpts,
                      PragmaList *Pragmas,
-                     llvm::raw_ostream *OS,
+                     llvm::raw_string_ostream *OS,
                      Slang::OutputType OT,
                      clang::SourceManager &SourceMgr,
                      bool AllowRSPrefix,
-                     bool IsFilterscript)
-  : Backend(DiagEngine, CodeGenOpts, TargetOpts, Pragmas, OS, OT),
+                     bool IsFilterscript,
+                     PhaseReport *Report,
+                     const BackendOptions &BackendOpts)
+  : Backend(Context->getLLVMContext(), DiagEngine, CodeGenOpts, TargetOpts,
+            Pragmas, OS, OT, Report, BackendOpts),
     mContext(Context),
     mSourceMgr(SourceMgr),
     mAllowRSPrefix(AllowRSPrefix),
@@ -76,6 +87,7 @@ void RSBackend::AnnotateFunction(clang::FunctionDecl *FD) {
   if (FD &&
       FD->hasBody() &&
       !SlangRS::IsLocInRSHeaderFile(FD->getLocation(), mSourceMgr)) {
+    PhaseTimer Timer(getPhaseReport(), PhaseReport::PH_ObjectRefCount);
     mRefCount.Init();
     mRefCount.Visit(FD->getBody());
   }
@@ -129,8 +141,11 @@ void RSBackend::HandleTranslationUnitPre(clang::ASTContext &C) {
   clang::TranslationUnitDecl *TUDecl = C.getTranslationUnitDecl();
 
   // If we have an invalid RS/FS AST, don't check further.
-  if (!mASTChecker.Validate()) {
-    return;
+  {
+    PhaseTimer Timer(getPhaseReport(), PhaseReport::PH_CheckAST);
+    if (!mASTChecker.Validate()) {
+      return;
+    }
   }
 
   if (mIsFilterscript) {
@@ -161,7 +176,11 @@ void RSBackend::HandleTranslationUnitPre(clang::ASTContext &C) {
 
   // Create a static global destructor if necessary (to handle RS object
   // runtime cleanup).
-  clang::FunctionDecl *FD = mRefCount.CreateStaticGlobalDtor();
+  clang::FunctionDecl *FD;
+  {
+    PhaseTimer Timer(getPhaseReport(), PhaseReport::PH_ObjectRefCount);
+    FD = mRefCount.CreateStaticGlobalDtor();
+  }
   if (FD) {
     HandleTopLevelDecl(clang::DeclGroupRef(FD));
   }
@@ -441,6 +460,383 @@ void RSBackend::dumpExportForEachInfo(llvm::Module *M) {
   }
 }
 
+// Add the attributes of a cell pointer of an old-style kernel to its argument
+// A: the runtime passes a distinct, non-null cell of each allocation, aligned
+// on its element type (float3 is padded to 16 bytes, as in clang's layout).
+static void annotateCellPointer(llvm::Argument *A,
+                                const clang::ParmVarDecl *PVD,
+                                const clang::ASTContext &C) {
+  slangAssert(A->getType()->isPointerTy());
+  llvm::AttrBuilder B;
+  B.addAttribute(llvm::Attribute::NoAlias);
+  // Stripped off before the bitcode is written, see StripUnknownAttributes.
+  B.addAttribute(llvm::Attribute::NonNull);
+
+  clang::QualType PointeeTy =
+      PVD->getType().getCanonicalType()->getPointeeType();
+  if (!PointeeTy->isVoidType() && !PointeeTy->isIncompleteType()) {
+    B.addAlignmentAttr(C.getTypeAlignInChars(PointeeTy).getQuantity());
+  }
+
+  llvm::Function *F = A->getParent();
+  F->addAttributes(A->getArgNo() + 1,
+                   llvm::AttributeSet::get(F->getContext(),
+                                           A->getArgNo() + 1, B));
+}
+
+// The x and y parameters of a kernel are cell coordinates, which the runtime
+// keeps in [0, 2^31) whether they are declared 'int' or 'uint32_t'. For an
+// 'int' one, the sign extensions of its value (e.g. to index a 64-bit pointer)
+// are then zero extensions, which the optimizer folds into the address
+// computations instead of keeping them in the loops of the kernel.
+//
+// The range is applied to the loads of the local copy clang made of A (and
+// nothing is done if the kernel writes to it, or takes its address).
+static void setCoordinateRange(llvm::Argument *A) {
+  llvm::AllocaInst *Copy = NULL;
+  for (llvm::Value::use_iterator I = A->use_begin(), E = A->use_end();
+       I != E; I++) {
+    llvm::StoreInst *SI = llvm::dyn_cast<llvm::StoreInst>(I->getUser());
+    if (SI == NULL || SI->getValueOperand() != A || Copy != NULL) {
+      return;
+    }
+    Copy = llvm::dyn_cast<llvm::AllocaInst>(SI->getPointerOperand());
+    if (Copy == NULL) {
+      return;
+    }
+  }
+  if (Copy == NULL) {
+    return;
+  }
+
+  llvm::SmallVector<llvm::LoadInst*, 4> Loads;
+  for (llvm::Value::use_iterator I = Copy->use_begin(), E = Copy->use_end();
+       I != E; I++) {
+    llvm::User *U = I->getUser();
+    if (llvm::LoadInst *LI = llvm::dyn_cast<llvm::LoadInst>(U)) {
+      Loads.push_back(LI);
+    } else if (!llvm::isa<llvm::StoreInst>(U) ||
+               llvm::cast<llvm::StoreInst>(U)->getValueOperand() != A) {
+      return;
+    }
+  }
+
+  for (unsigned i = 0, e = Loads.size(); i != e; i++) {
+    llvm::SmallVector<llvm::SExtInst*, 4> SExts;
+    for (llvm::Value::use_iterator I = Loads[i]->use_begin(),
+            E = Loads[i]->use_end();
+         I != E; I++) {
+      if (llvm::SExtInst *SE = llvm::dyn_cast<llvm::SExtInst>(I->getUser())) {
+        SExts.push_back(SE);
+      }
+    }
+    for (unsigned j = 0, je = SExts.size(); j != je; j++) {
+      llvm::SExtInst *SE = SExts[j];
+      llvm::Value *ZE = new llvm::ZExtInst(Loads[i], SE->getType(), "", SE);
+      ZE->takeName(SE);
+      SE->replaceAllUsesWith(ZE);
+      SE->eraseFromParent();
+    }
+  }
+}
+
+void RSBackend::annotateExportForEachParams(llvm::Module *M) {
+  const clang::ASTContext &C = mContext->getASTContext();
+
+  for (RSContext::const_export_foreach_iterator
+          I = mContext->export_foreach_begin(),
+          E = mContext->export_foreach_end();
+       I != E;
+       I++) {
+    const RSExportForEach *EFE = *I;
+    if (EFE->isDummyRoot()) {
+      continue;
+    }
+
+    llvm::Function *F = M->getFunction(EFE->getName());
+    if ((F == NULL) || F->isDeclaration() ||
+        (F->arg_size() != EFE->getNumParameters())) {
+      continue;
+    }
+
+    std::vector<llvm::Argument*> Args;
+    for (llvm::Function::arg_iterator AI = F->arg_begin(), AE = F->arg_end();
+         AI != AE; AI++) {
+      Args.push_back(AI);
+    }
+
+    // The cells of a pass-by-value kernel are not pointers.
+    if (!EFE->isKernelStyle()) {
+      for (RSExportForEach::InIter BI = EFE->getIns().begin(),
+              BE = EFE->getIns().end();
+           BI != BE; BI++) {
+        annotateCellPointer(Args[(*BI)->getFunctionScopeIndex()], *BI, C);
+      }
+      if (const clang::ParmVarDecl *Out = EFE->getOutParam()) {
+        annotateCellPointer(Args[Out->getFunctionScopeIndex()], Out, C);
+      }
+    }
+
+    const clang::ParmVarDecl *Coords[] = { EFE->getXParam(),
+                                           EFE->getYParam() };
+    for (unsigned i = 0; i < 2; i++) {
+      if ((Coords[i] != NULL) &&
+          Coords[i]->getType()->isSignedIntegerType()) {
+        setCoordinateRange(Args[Coords[i]->getFunctionScopeIndex()]);
+      }
+    }
+  }
+}
+
+void RSBackend::applyFloatPrecision(llvm::Module *M) {
+  if (mContext->getPrecision() != "rs_fp_relaxed") {
+    return;
+  }
+
+  // rs_fp_relaxed tolerates less precise results (e.g. from a reciprocal
+  // instead of a division, or from a fused multiply-add), but not a different
+  // handling of infinities, NaNs and signed zeros. rs_fp_imprecise leaves
+  // these undefined, and has no precision requirements: anything goes.
+  const bool Imprecise = mContext->isImpreciseFloat();
+  llvm::FastMathFlags FMF;
+  if (Imprecise) {
+    FMF.setUnsafeAlgebra();
+  } else {
+    FMF.setAllowReciprocal();
+  }
+
+  for (llvm::Module::iterator F = M->begin(), FE = M->end(); F != FE; F++) {
+    if (F->isDeclaration()) {
+      continue;
+    }
+
+    // Read by the code generator (e.g. of llvm-rs-cc -S).
+    F->addFnAttr("less-precise-fpmad", "true");
+    if (Imprecise) {
+      F->addFnAttr("no-infs-fp-math", "true");
+      F->addFnAttr("no-nans-fp-math", "true");
+      F->addFnAttr("unsafe-fp-math", "true");
+    }
+
+    for (llvm::Function::iterator BB = F->begin(), BE = F->end(); BB != BE;
+         BB++) {
+      for (llvm::BasicBlock::iterator I = BB->begin(), IE = BB->end();
+           I != IE; I++) {
+        if (llvm::isa<llvm::BinaryOperator>(I) &&
+            I->getType()->isFPOrFPVectorTy()) {
+          I->setFastMathFlags(FMF);
+        }
+      }
+    }
+  }
+}
+
+// Give the loops of F (which have none yet) a loop ID carrying the unroll
+// count and vectorization width of Hints, as clang does for #pragma clang loop.
+static void setLoopHints(llvm::Function *F,
+                         const RSContext::OptimizationHints &Hints) {
+  llvm::LLVMContext &C = F->getContext();
+  llvm::SmallVector<llvm::Value*, 2> LoopHints;
+  if (Hints.UnrollCount != 0) {
+    llvm::Value *Hint[] = {
+      llvm::MDString::get(C, "llvm.loop.unroll.count"),
+      llvm::ConstantInt::get(llvm::Type::getInt32Ty(C), Hints.UnrollCount)
+    };
+    LoopHints.push_back(llvm::MDNode::get(C, Hint));
+  }
+  if (Hints.VectorizeWidth != 0) {
+    llvm::Value *Hint[] = {
+      llvm::MDString::get(C, "llvm.loop.vectorize.width"),
+      llvm::ConstantInt::get(llvm::Type::getInt32Ty(C), Hints.VectorizeWidth)
+    };
+    LoopHints.push_back(llvm::MDNode::get(C, Hint));
+  }
+  if (LoopHints.empty()) {
+    return;
+  }
+
+  llvm::DominatorTree DT;
+  DT.recalculate(*F);
+  llvm::LoopInfoBase<llvm::BasicBlock, llvm::Loop> LI;
+  LI.Analyze(DT);
+
+  std::vector<llvm::Loop*> Loops(LI.begin(), LI.end());
+  while (!Loops.empty()) {
+    llvm::Loop *L = Loops.back();
+    Loops.pop_back();
+    Loops.insert(Loops.end(), L->begin(), L->end());
+    if (L->getLoopID() != NULL) {
+      continue;
+    }
+
+    // A loop ID is distinct, as its first operand is itself.
+    llvm::SmallVector<llvm::Value*, 3> Ops;
+    llvm::MDNode *Temp = llvm::MDNode::getTemporary(C, llvm::None);
+    Ops.push_back(Temp);
+    Ops.append(LoopHints.begin(), LoopHints.end());
+    llvm::MDNode *LoopID = llvm::MDNode::get(C, Ops);
+    LoopID->replaceOperandWith(0, LoopID);
+    llvm::MDNode::deleteTemporary(Temp);
+    L->setLoopID(LoopID);
+  }
+}
+
+void RSBackend::applyOptimizationHints(llvm::Module *M) {
+  if (mContext->optimization_hints_begin() ==
+      mContext->optimization_hints_end()) {
+    return;
+  }
+
+  // The passes run at the highest level asked for. The functions which are
+  // to be left unoptimized are marked optnone.
+  unsigned FileLevel = mCodeGenOpts.OptimizationLevel;
+  std::vector<llvm::Function*> Unoptimized;
+  // The functions asking for O1 or O2, which only get it if no other
+  // function asks for more.
+  std::vector<RSContext::const_optimization_hint_iterator> Lowered;
+  if (FileLevel == 0) {
+    for (llvm::Module::iterator F = M->begin(), E = M->end(); F != E; F++) {
+      if (!F->isDeclaration() &&
+          !mContext->hasOptimizationHints(F->getName())) {
+        Unoptimized.push_back(F);
+      }
+    }
+  }
+
+  for (RSContext::const_optimization_hint_iterator
+          I = mContext->optimization_hints_begin(),
+          E = mContext->optimization_hints_end();
+       I != E;
+       I++) {
+    const RSContext::OptimizationHints &Hints = I->getValue();
+    llvm::Function *F = M->getFunction(I->getKey());
+    if ((F == NULL) || F->isDeclaration()) {
+      mContext->ReportWarning(Hints.Loc,
+                              "no function named '%0' is defined in this "
+                              "script")
+          << I->getKey();
+      continue;
+    }
+
+    int Level = Hints.OptimizationLevel;
+    if ((Level == 0) || ((Level < 0) && (FileLevel == 0))) {
+      Unoptimized.push_back(F);
+      continue;
+    }
+    if (Level > static_cast<int>(mOptimizationLevel)) {
+      mOptimizationLevel = Level;
+    }
+    if (Hints.OptimizeSize) {
+      F->addFnAttr(llvm::Attribute::OptimizeForSize);
+    } else if (Level > 0 && Level < 3) {
+      Lowered.push_back(I);
+    }
+
+    setLoopHints(F, Hints);
+    if (Hints.UnrollCount != 0) {
+      mUnrollLoops = true;
+    }
+  }
+
+  // LLVM can only turn the optimization of a function off, so the others all
+  // get the level of the passes.
+  for (unsigned i = 0, e = Lowered.size(); i != e; i++) {
+    const RSContext::OptimizationHints &Hints = Lowered[i]->getValue();
+    if (Hints.OptimizationLevel < static_cast<int>(mOptimizationLevel)) {
+      mContext->ReportWarning(Hints.Loc,
+                              "function '%0' is optimized at O%1, not O%2: "
+                              "only O0 and Os can be applied to a single "
+                              "function")
+          << Lowered[i]->getKey() << mOptimizationLevel
+          << Hints.OptimizationLevel;
+    }
+  }
+
+  if (mOptimizationLevel == 0) {
+    return;
+  }
+  if (mOptimizationLevel == 3) {
+    mVectorizeLoop = true;
+    mVectorizeSLP = true;
+  }
+  for (unsigned i = 0, e = Unoptimized.size(); i != e; i++) {
+    llvm::Function *F = Unoptimized[i];
+    // optnone requires noinline, and the always_inline functions are inlined
+    // whatever the level.
+    if (F->hasFnAttribute(llvm::Attribute::AlwaysInline)) {
+      continue;
+    }
+    F->addFnAttr(llvm::Attribute::OptimizeNone);
+    // The noinline is only for the optimization of this module: it is
+    // removed with optnone before the bitcode is written.
+    if (!F->hasFnAttribute(llvm::Attribute::NoInline)) {
+      F->addFnAttr(llvm::Attribute::NoInline);
+      F->addFnAttr(StripUnknownAttributes::kOptNoneNoInline);
+    }
+  }
+}
+
+void RSBackend::instrumentForProfile(llvm::Module *M) {
+  llvm::GlobalVariable *Counters =
+      Profile::instrument(M, mBackendOpts.ScriptName);
+  if (Counters == NULL) {
+    return;
+  }
+
+  // The runtime calls .rs.dtor when the script is destroyed, which is when
+  // the counts are complete.
+  llvm::LLVMContext &C = M->getContext();
+  llvm::Function *Dtor = M->getFunction(".rs.dtor");
+  if (Dtor == NULL) {
+    Dtor = llvm::Function::Create(
+        llvm::FunctionType::get(llvm::Type::getVoidTy(C), false),
+        llvm::GlobalValue::ExternalLinkage, ".rs.dtor", M);
+    llvm::ReturnInst::Create(C, llvm::BasicBlock::Create(C, "entry", Dtor));
+  }
+
+  llvm::Type *HookParams[] = {
+    llvm::Type::getInt8PtrTy(C),
+    llvm::Type::getInt64PtrTy(C)
+  };
+  llvm::Constant *Hook = M->getOrInsertFunction(
+      kProfileDumpHook,
+      llvm::FunctionType::get(llvm::Type::getVoidTy(C), HookParams, false));
+
+  llvm::GlobalVariable *Layout =
+      M->getGlobalVariable(Profile::kLayoutName, /* AllowLocal = */true);
+  llvm::Constant *Zero = llvm::ConstantInt::get(llvm::Type::getInt32Ty(C), 0);
+  llvm::Constant *Indices[] = { Zero, Zero };
+  llvm::Value *Args[] = {
+    llvm::ConstantExpr::getInBoundsGetElementPtr(Layout, Indices),
+    llvm::ConstantExpr::getInBoundsGetElementPtr(Counters, Indices)
+  };
+
+  for (llvm::Function::iterator BB = Dtor->begin(), E = Dtor->end();
+       BB != E; BB++) {
+    if (llvm::isa<llvm::ReturnInst>(BB->getTerminator())) {
+      llvm::CallInst::Create(Hook, Args, "", BB->getTerminator());
+    }
+  }
+}
+
+void RSBackend::applyProfile(llvm::Module *M) {
+  const Profile &ProfileUse = *mBackendOpts.ProfileUse;
+  const std::string &ScriptName = mBackendOpts.ScriptName;
+  if (!ProfileUse.hasScript(ScriptName)) {
+    mContext->ReportWarning("the profile has no counts for script '%0'")
+        << ScriptName;
+    return;
+  }
+
+  std::vector<std::string> Mismatched;
+  ProfileUse.apply(M, ScriptName, &Mismatched);
+  for (unsigned i = 0, e = Mismatched.size(); i != e; i++) {
+    mContext->ReportWarning("the profile of function '%0' does not match its "
+                            "code (out of date?), ignored")
+        << Mismatched[i];
+  }
+}
+
 void RSBackend::dumpExportTypeInfo(llvm::Module *M) {
   llvm::SmallVector<llvm::Value*, 1> ExportTypeInfo;
 
@@ -501,6 +897,8 @@ void RSBackend::dumpExportTypeInfo(llvm::Module *M) {
 }
 
 void RSBackend::HandleTranslationUnitPost(llvm::Module *M) {
+  PhaseTimer Timer(getPhaseReport(), PhaseReport::PH_ProcessExport);
+
   if (!mContext->processExport()) {
     return;
   }
@@ -511,11 +909,25 @@ void RSBackend::HandleTranslationUnitPost(llvm::Module *M) {
   if (mContext->hasExportFunc())
     dumpExportFunctionInfo(M);
 
-  if (mContext->hasExportForEach())
+  if (mContext->hasExportForEach()) {
     dumpExportForEachInfo(M);
+    annotateExportForEachParams(M);
+  }
 
   if (mContext->hasExportType())
     dumpExportTypeInfo(M);
+
+  applyFloatPrecision(M);
+
+  applyOptimizationHints(M);
+
+  // The blocks must be the same when generating and using the profile, so
+  // nothing changing them may run in between.
+  if (mBackendOpts.ProfileGenerate) {
+    instrumentForProfile(M);
+  } else if (mBackendOpts.ProfileUse != NULL) {
+    applyProfile(M);
+  }
 }
 
 RSBackend::~RSBackend() {
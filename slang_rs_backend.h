@@ -17,6 +17,8 @@
 #ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_BACKEND_H_  // NOLINT
 #define _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_BACKEND_H_
 
+#include <string>
+
 #include "slang_backend.h"
 #include "slang_pragma_recorder.h"
 #include "slang_rs_check_ast.h"
@@ -68,6 +70,25 @@ class RSBackend : public Backend {
   void dumpExportForEachInfo(llvm::Module *M);
   void dumpExportTypeInfo(llvm::Module *M);
 
+  // Tell the optimizer what the runtime guarantees about the parameters of
+  // the forEach kernels (see RSExportForEach).
+  void annotateExportForEachParams(llvm::Module *M);
+
+  // Let the optimizer use what the precision pragma (rs_fp_relaxed or
+  // rs_fp_imprecise) allows on the floating point operations.
+  void applyFloatPrecision(llvm::Module *M);
+
+  // Apply the #pragma rs optimize, unroll and vectorize_width of the script to
+  // its functions, and raise the optimization of the passes to what they ask.
+  void applyOptimizationHints(llvm::Module *M);
+
+  // Add the block counters of -fprofile-generate to the script, and have
+  // .rs.dtor hand them to the runtime (see kProfileDumpHook).
+  void instrumentForProfile(llvm::Module *M);
+
+  // Set the branch weights of the script from the counts of -fprofile-use.
+  void applyProfile(llvm::Module *M);
+
  protected:
   virtual unsigned int getTargetAPI() const {
     return mContext->getTargetAPI();
@@ -80,16 +101,25 @@ class RSBackend : public Backend {
   virtual void HandleTranslationUnitPost(llvm::Module *M);
 
  public:
+  // The runtime function .rs.dtor calls in the scripts built with
+  // -fprofile-generate:
+  //   void __rs_profile_dump(const char *Layout, const uint64_t *Counters);
+  // Layout describes Counters (see Profile::addCounts()). The runtime is
+  // expected to add them to the profile file given to -fprofile-use.
+  static const char kProfileDumpHook[];
+
   RSBackend(RSContext *Context,
             clang::DiagnosticsEngine *DiagEngine,
             const clang::CodeGenOptions &CodeGenOpts,
             const clang::TargetOptions &TargetOpts,
             PragmaList *Pragmas,
-            llvm::raw_ostream *OS,
+            llvm::raw_string_ostream *OS,
             Slang::OutputType OT,
             clang::SourceManager &SourceMgr,
             bool AllowRSPrefix,
-            bool IsFilterscript);
+            bool IsFilterscript,
+            PhaseReport *Report,
+            const BackendOptions &BackendOpts);
 
   virtual ~RSBackend();
 };
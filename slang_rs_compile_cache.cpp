@@ -0,0 +1,253 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "slang_rs_compile_cache.h"
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+
+#include "rs_cc_options.h"
+#include "slang_output_sink.h"
+#include "slang_utils.h"
+#include "slang_version.h"
+
+namespace slang {
+
+namespace {
+
+// Magic string starting every cache entry. Bump the version whenever the
+// format of the entries changes.
+const char kEntryMagic[] = "slang-cache 1\n";
+
+// An entry is a sequence of records "<kind> <size of A> <size of B>\n<A><B>".
+void AppendRecord(std::string *Out, char Kind, llvm::StringRef A,
+                  llvm::StringRef B) {
+  llvm::raw_string_ostream OS(*Out);
+  OS << Kind << ' ' << A.size() << ' ' << B.size() << '\n' << A << B;
+}
+
+bool ParseRecord(llvm::StringRef *Buf, char *Kind, llvm::StringRef *A,
+                 llvm::StringRef *B) {
+  size_t EOL = Buf->find('\n');
+  if (EOL == llvm::StringRef::npos)
+    return false;
+
+  llvm::SmallVector<llvm::StringRef, 3> Fields;
+  Buf->substr(0, EOL).split(Fields, " ");
+  *Buf = Buf->substr(EOL + 1);
+
+  uint64_t SizeA, SizeB;
+  if ((Fields.size() != 3) || (Fields[0].size() != 1) ||
+      Fields[1].getAsInteger(10, SizeA) || Fields[2].getAsInteger(10, SizeB) ||
+      (Buf->size() < SizeA + SizeB))
+    return false;
+
+  *Kind = Fields[0][0];
+  *A = Buf->substr(0, SizeA);
+  *B = Buf->substr(SizeA, SizeB);
+  *Buf = Buf->substr(SizeA + SizeB);
+  return true;
+}
+
+// Returns a hash of the compiler binary at @CompilerPath. Rebuilding
+// llvm-rs-cc then invalidates the whole cache, even when the version numbers
+// are unchanged. Falls back on the build date if the binary cannot be read.
+std::string HashCompiler(const std::string &CompilerPath) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > MBOrErr =
+      llvm::MemoryBuffer::getFile(CompilerPath, -1,
+                                  /* RequiresNullTerminator = */false);
+  if (MBOrErr.getError())
+    return std::string("built ") + __DATE__ + ' ' + __TIME__;
+
+  llvm::MD5 Hash;
+  Hash.update(MBOrErr.get()->getBuffer());
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  llvm::SmallString<32> ID;
+  llvm::MD5::stringifyResult(Result, ID);
+  return ID.str();
+}
+
+// The binary is only hashed once per process (the parallel workers and the
+// requests of -server share it).
+const std::string &GetCompilerID(const std::string &CompilerPath) {
+  static const std::string ID = HashCompiler(CompilerPath);
+  return ID;
+}
+
+}  // namespace
+
+RSCompileCache::KeyBuilder::KeyBuilder()
+    : llvm::raw_ostream(/* unbuffered = */true),
+      mSize(0) {
+}
+
+void RSCompileCache::KeyBuilder::write_impl(const char *Ptr, size_t Size) {
+  mHash.update(llvm::StringRef(Ptr, Size));
+  mSize += Size;
+}
+
+void RSCompileCache::KeyBuilder::addOptions(const RSCCOptions &Opts) {
+  // The identity of the compiler (see llvm_rs_cc_VersionPrinter()).
+  *this << "llvm-rs-cc " << SLANG_MAXIMUM_TARGET_API << ' '
+        << SlangVersion::CURRENT << ' ' << GetCompilerID(Opts.mCompilerPath)
+        << '\0';
+
+  *this << Opts.mTargetAPI << '\0'
+        << Opts.mBitWidth << '\0'
+        << Opts.mOptimizationLevel << '\0'
+        << Opts.mStructPathTBAA << '\0'
+        << Opts.mProfileGenerate << '\0'
+        << Opts.mProfileUseFile << '\0'
+        << Opts.mOptimizeBitcodeSize << '\0'
+        << Opts.mStripBitcode << '\0'
+        << Opts.mEmitBitcodeIndex << '\0'
+        << Opts.mDebugEmission << '\0'
+        << Opts.mOutputType << '\0'
+        << Opts.mAllowRSPrefix << '\0'
+        << Opts.mEmit3264 << '\0'
+        << Opts.mBitcodeStorage << '\0'
+        << Opts.mJavaReflectionPathBase << '\0'
+        << Opts.mJavaReflectionPackageName << '\0'
+        << Opts.mRSPackageName << '\0'
+        << Opts.mEmitDependency << '\0'
+        << Opts.mIgnoreWarnings << '\0';
+
+  for (unsigned i = 0, e = Opts.mAdditionalDepTargets.size(); i != e; i++)
+    *this << "-a" << Opts.mAdditionalDepTargets[i] << '\0';
+  for (unsigned i = 0, e = Opts.mIncludePaths.size(); i != e; i++)
+    *this << "-I" << Opts.mIncludePaths[i] << '\0';
+  for (unsigned i = 0, e = Opts.mWarningOptions.size(); i != e; i++)
+    *this << "-W" << Opts.mWarningOptions[i] << '\0';
+}
+
+std::string RSCompileCache::KeyBuilder::getKey() {
+  llvm::MD5::MD5Result Result;
+  mHash.final(Result);
+  llvm::SmallString<32> Key;
+  llvm::MD5::stringifyResult(Result, Key);
+  return Key.str();
+}
+
+RSCompileCache::RSCompileCache(const std::string &CacheDir, OutputSink *Sink)
+    : mCacheDir(CacheDir),
+      mSink(Sink),
+      mHits(0),
+      mMisses(0) {
+}
+
+std::string RSCompileCache::getEntryPath(const std::string &Key) const {
+  // Spread the entries over 256 sub-directories.
+  llvm::SmallString<256> Path(mCacheDir);
+  llvm::sys::path::append(Path, Key.substr(0, 2), Key);
+  return Path.str();
+}
+
+bool RSCompileCache::restore(const std::string &Key, Entry *E) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > MBOrErr =
+      llvm::MemoryBuffer::getFile(getEntryPath(Key));
+  if (MBOrErr.getError()) {
+    mMisses++;
+    return false;
+  }
+
+  llvm::StringRef Buf = MBOrErr.get()->getBuffer();
+  bool Valid = Buf.startswith(kEntryMagic);
+  Buf = Buf.substr(sizeof(kEntryMagic) - 1);
+
+  Entry Restored;
+  while (Valid && !Buf.empty()) {
+    char Kind;
+    llvm::StringRef A, B;
+    if (!ParseRecord(&Buf, &Kind, &A, &B)) {
+      Valid = false;
+      break;
+    }
+    switch (Kind) {
+      case 'F': {
+        Restored.Files.push_back(FileTy(A.str(), B.str()));
+        break;
+      }
+      case 'D': {
+        Restored.Diagnostics.append(B.data(), B.size());
+        break;
+      }
+      case 'O': {
+        Restored.Definitions.push_back(DefinitionTy(A.str(), B.str()));
+        break;
+      }
+      default: {
+        Valid = false;
+        break;
+      }
+    }
+  }
+
+  // Write back the files.
+  for (unsigned i = 0, e = Restored.Files.size(); Valid && (i != e); i++) {
+    const FileTy &File = Restored.Files[i];
+    std::string Error;
+    if (!mSink->writeFile(File.first, File.second, &Error))
+      Valid = false;
+  }
+
+  if (!Valid) {
+    mMisses++;
+    return false;
+  }
+
+  mHits++;
+  *E = Restored;
+  return true;
+}
+
+bool RSCompileCache::store(const std::string &Key, Entry *E) {
+  std::string Contents(kEntryMagic);
+
+  for (unsigned i = 0, e = E->Files.size(); i != e; i++) {
+    FileTy &File = E->Files[i];
+    if (!mSink->readFile(File.first, &File.second))
+      return false;
+    AppendRecord(&Contents, 'F', File.first, File.second);
+  }
+
+  AppendRecord(&Contents, 'D', "", E->Diagnostics);
+
+  for (unsigned i = 0, e = E->Definitions.size(); i != e; i++) {
+    AppendRecord(&Contents, 'O', E->Definitions[i].first,
+                 E->Definitions[i].second);
+  }
+
+  std::string Path = getEntryPath(Key);
+  std::string Error;
+  return SlangUtils::CreateDirectoryWithParents(
+             llvm::sys::path::parent_path(Path), &Error) &&
+         SlangUtils::WriteFileAtomically(Path, Contents);
+}
+
+void RSCompileCache::printStats(llvm::raw_ostream &OS) const {
+  OS << "Compilation cache " << mCacheDir << ": " << mHits << " hit(s), "
+     << mMisses << " miss(es)\n";
+}
+
+}  // namespace slang
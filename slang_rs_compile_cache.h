@@ -0,0 +1,98 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_COMPILE_CACHE_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_COMPILE_CACHE_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace slang {
+
+class OutputSink;
+class RSCCOptions;
+
+// A content-addressed cache of the outputs of llvm-rs-cc, enabled with
+// -cache-dir. An entry holds everything produced by the compilation of one
+// input file: the files written (bitcode, reflected sources, dependency file),
+// its diagnostics and the record types it reflects (for checking the ODR
+// against the other inputs).
+class RSCompileCache {
+ public:
+  // Computes the key of a cache entry from everything written to it.
+  class KeyBuilder : public llvm::raw_ostream {
+   private:
+    llvm::MD5 mHash;
+    uint64_t mSize;
+
+    virtual void write_impl(const char *Ptr, size_t Size);
+    virtual uint64_t current_pos() const { return mSize; }
+
+   public:
+    KeyBuilder();
+
+    // Add the options affecting the outputs of the compilation and the
+    // identity of the compiler.
+    void addOptions(const RSCCOptions &Opts);
+
+    // Returns the key (as an hexadecimal string). Nothing must be written
+    // after calling this.
+    std::string getKey();
+  };
+
+  typedef std::pair<std::string, std::string> FileTy;  // <path, contents>
+  typedef std::pair<std::string, std::string> DefinitionTy;  // <name, ODR
+                                                             //  signature>
+
+  struct Entry {
+    std::vector<FileTy> Files;
+    std::string Diagnostics;
+    std::vector<DefinitionTy> Definitions;
+  };
+
+ private:
+  std::string mCacheDir;
+
+  // Where the files of the entries are read from and written back to.
+  OutputSink *mSink;
+
+  unsigned mHits;
+  unsigned mMisses;
+
+  std::string getEntryPath(const std::string &Key) const;
+
+ public:
+  // The files of the entries go through Sink (not owned).
+  RSCompileCache(const std::string &CacheDir, OutputSink *Sink);
+
+  // Look up the entry for @Key and write back its files. Returns false (and
+  // counts a miss) if there is no such entry or if it can not be restored.
+  bool restore(const std::string &Key, Entry *E);
+
+  // Store @E for @Key. The contents of the files are read back from the
+  // paths given in @E.Files (through the sink).
+  bool store(const std::string &Key, Entry *E);
+
+  void printStats(llvm::raw_ostream &OS) const;
+};
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_COMPILE_CACHE_H_  NOLINT
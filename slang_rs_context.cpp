@@ -44,6 +44,7 @@ namespace slang {
 
 RSContext::RSContext(clang::Preprocessor &PP,
                      clang::ASTContext &Ctx,
+                     llvm::LLVMContext &LLVMContext,
                      const clang::TargetInfo &Target,
                      PragmaList *Pragmas,
                      unsigned int TargetAPI,
@@ -51,10 +52,11 @@ RSContext::RSContext(clang::Preprocessor &PP,
     : mPP(PP),
       mCtx(Ctx),
       mPragmas(Pragmas),
+      mImpreciseFloat(false),
       mTargetAPI(TargetAPI),
       mVerbose(Verbose),
       mDataLayout(NULL),
-      mLLVMContext(llvm::getGlobalContext()),
+      mLLVMContext(LLVMContext),
       mLicenseNote(NULL),
       mRSPackageName("android.renderscript"),
       version(0),
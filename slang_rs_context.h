@@ -62,6 +62,27 @@ class RSContext {
   typedef std::list<RSExportForEach*> ExportForEachList;
   typedef llvm::StringMap<RSExportType*> ExportTypeMap;
 
+  // The optimization asked for a function with #pragma rs optimize, unroll and
+  // vectorize_width (see RSBackend::applyOptimizationHints()).
+  struct OptimizationHints {
+    // The optimization level (0 to 3), or -1 if not given.
+    int OptimizationLevel;
+    // Set for Os (with an OptimizationLevel of 2).
+    bool OptimizeSize;
+    // The unroll count and vectorization width of the loops of the function
+    // (0 if not given).
+    unsigned UnrollCount;
+    unsigned VectorizeWidth;
+    // The first of these pragmas naming the function.
+    clang::SourceLocation Loc;
+
+    OptimizationHints()
+        : OptimizationLevel(-1), OptimizeSize(false), UnrollCount(0),
+          VectorizeWidth(0) {
+    }
+  };
+  typedef llvm::StringMap<OptimizationHints> OptimizationHintMap;
+
  private:
   clang::Preprocessor &mPP;
   clang::ASTContext &mCtx;
@@ -69,6 +90,9 @@ class RSContext {
   // Precision specified via pragma, either rs_fp_full or rs_fp_relaxed. If
   // empty, rs_fp_full is assumed.
   std::string mPrecision;
+  // Set if that pragma was rs_fp_imprecise, which the runtime is told is
+  // rs_fp_relaxed but the front end optimizes as asked for.
+  bool mImpreciseFloat;
   unsigned int mTargetAPI;
   bool mVerbose;
 
@@ -102,9 +126,12 @@ class RSContext {
   ExportForEachList mExportForEach;
   ExportTypeMap mExportTypes;
 
+  OptimizationHintMap mOptimizationHints;
+
  public:
   RSContext(clang::Preprocessor &PP,
             clang::ASTContext &Ctx,
+            llvm::LLVMContext &LLVMContext,
             const clang::TargetInfo &Target,
             PragmaList *Pragmas,
             unsigned int TargetAPI,
@@ -238,6 +265,24 @@ class RSContext {
   }
   void setPrecision(const std::string &P) { mPrecision = P; }
   std::string getPrecision() { return mPrecision; }
+  void setImpreciseFloat(bool I) { mImpreciseFloat = I; }
+  bool isImpreciseFloat() const { return mImpreciseFloat; }
+
+  // Returns the optimization hints of the function named Function, which are
+  // created (empty) if none were given yet.
+  OptimizationHints &getOptimizationHints(llvm::StringRef Function) {
+    return mOptimizationHints[Function];
+  }
+  bool hasOptimizationHints(llvm::StringRef Function) const {
+    return mOptimizationHints.count(Function) != 0;
+  }
+  typedef OptimizationHintMap::const_iterator const_optimization_hint_iterator;
+  const_optimization_hint_iterator optimization_hints_begin() const {
+    return mOptimizationHints.begin();
+  }
+  const_optimization_hint_iterator optimization_hints_end() const {
+    return mOptimizationHints.end();
+  }
 
   // Report an error or a warning to the user.
   template <unsigned N>
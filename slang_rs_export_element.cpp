@@ -28,7 +28,6 @@
 
 namespace slang {
 
-bool RSExportElement::Initialized = false;
 RSExportElement::ElementInfoMapTy RSExportElement::ElementInfoMap;
 
 struct DataElementInfo {
@@ -52,20 +51,24 @@ static DataElementInfo DataElementInfoTable[] = {
 const int DataElementInfoTableCount = sizeof(DataElementInfoTable) / sizeof(DataElementInfoTable[0]);
 
 // TODO Rename RSExportElement to RSExportDataElement
-void RSExportElement::Init() {
-  if (!Initialized) {
-    // Initialize ElementInfoMap
-    for (int i = 0; i < DataElementInfoTableCount; i++) {
-      ElementInfo *EI = new ElementInfo;
-      EI->type = DataElementInfoTable[i].dataType;
-      EI->normalized = DataElementInfoTable[i].normalized;
-      EI->vsize = DataElementInfoTable[i].vsize;
-      llvm::StringRef Name(DataElementInfoTable[i].name);
-      ElementInfoMap.insert(ElementInfoMapTy::value_type::Create(
-          Name, ElementInfoMap.getAllocator(), EI));
-    }
-    Initialized = true;
+bool RSExportElement::InitElementInfoMap() {
+  for (int i = 0; i < DataElementInfoTableCount; i++) {
+    ElementInfo *EI = new ElementInfo;
+    EI->type = DataElementInfoTable[i].dataType;
+    EI->normalized = DataElementInfoTable[i].normalized;
+    EI->vsize = DataElementInfoTable[i].vsize;
+    llvm::StringRef Name(DataElementInfoTable[i].name);
+    ElementInfoMap.insert(ElementInfoMapTy::value_type::Create(
+        Name, ElementInfoMap.getAllocator(), EI));
   }
+  return true;
+}
+
+void RSExportElement::Init() {
+  // The initialization of a local static is thread-safe: the map is filled
+  // once, even when several threads compile at the same time.
+  static const bool Initialized = InitElementInfoMap();
+  (void) Initialized;
 }
 
 RSExportType *RSExportElement::Create(RSContext *Context,
@@ -76,8 +79,7 @@ RSExportType *RSExportElement::Create(RSContext *Context,
   llvm::StringRef TypeName;
   RSExportType *ET = NULL;
 
-  if (!Initialized)
-    Init();
+  Init();
 
   slangAssert(EI != NULL && "Element info not found");
 
@@ -165,8 +167,7 @@ RSExportType *RSExportElement::CreateFromDecl(RSContext *Context,
 
 const RSExportElement::ElementInfo *
 RSExportElement::GetElementInfo(const llvm::StringRef &Name) {
-  if (!Initialized)
-    Init();
+  Init();
 
   ElementInfoMapTy::const_iterator I = ElementInfoMap.find(Name);
   if (I == ElementInfoMap.end())
@@ -49,10 +49,10 @@ class RSExportElement {
   typedef llvm::StringMap<const ElementInfo*> ElementInfoMapTy;
 
  private:
-  // Macro name <-> ElementInfo
+  // Macro name <-> ElementInfo. Filled once by Init(), read-only afterwards.
   static ElementInfoMapTy ElementInfoMap;
 
-  static bool Initialized;
+  static bool InitElementInfoMap();
 
   static RSExportType *Create(RSContext *Context,
                               const clang::Type *T,
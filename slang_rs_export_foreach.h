@@ -133,6 +133,23 @@ class RSExportForEach : public RSExportable {
     return mOutType;
   }
 
+  // The out, x and y parameters of the kernel (NULL if it has none).
+  inline const clang::ParmVarDecl *getOutParam() const {
+    return mOut;
+  }
+
+  inline const clang::ParmVarDecl *getXParam() const {
+    return mX;
+  }
+
+  inline const clang::ParmVarDecl *getYParam() const {
+    return mY;
+  }
+
+  inline bool isKernelStyle() const {
+    return mIsKernelStyle;
+  }
+
   inline const RSExportRecordType *getParamPacketType() const {
     return mParamPacketType;
   }
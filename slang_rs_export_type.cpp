@@ -163,6 +163,30 @@ static NameAndPrimitiveType MatrixAndObjectDataTypes[] = {
 const int MatrixAndObjectDataTypesCount =
     sizeof(MatrixAndObjectDataTypes) / sizeof(MatrixAndObjectDataTypes[0]);
 
+// Maps the names of the RS matrix and object types to their DataType. It is
+// built once (see GetRSSpecificType()) and only read afterwards, so that
+// concurrent compilations can share it.
+class RSSpecificTypeMap {
+ private:
+  llvm::StringMap<DataType> mMap;
+
+ public:
+  RSSpecificTypeMap() {
+    for (int i = 0; i < MatrixAndObjectDataTypesCount; i++) {
+      mMap.GetOrCreateValue(MatrixAndObjectDataTypes[i].name,
+                            MatrixAndObjectDataTypes[i].dataType);
+    }
+  }
+
+  DataType lookup(const llvm::StringRef &TypeName) const {
+    llvm::StringMap<DataType>::const_iterator I = mMap.find(TypeName);
+    if (I == mMap.end())
+      return DataTypeUnknown;
+    else
+      return I->getValue();
+  }
+};
+
 static const clang::Type *TypeExportableHelper(
     const clang::Type *T,
     llvm::SmallPtrSet<const clang::Type*, 8>& SPS,
@@ -904,9 +928,6 @@ RSExportType::~RSExportType() {
 }
 
 /************************** RSExportPrimitiveType **************************/
-llvm::ManagedStatic<RSExportPrimitiveType::RSSpecificTypeMapTy>
-RSExportPrimitiveType::RSSpecificTypeMap;
-
 bool RSExportPrimitiveType::IsPrimitiveType(const clang::Type *T) {
   if ((T != NULL) && (T->getTypeClass() == clang::Type::Builtin))
     return true;
@@ -919,18 +940,9 @@ RSExportPrimitiveType::GetRSSpecificType(const llvm::StringRef &TypeName) {
   if (TypeName.empty())
     return DataTypeUnknown;
 
-  if (RSSpecificTypeMap->empty()) {
-    for (int i = 0; i < MatrixAndObjectDataTypesCount; i++) {
-      RSSpecificTypeMap->GetOrCreateValue(MatrixAndObjectDataTypes[i].name,
-                                          MatrixAndObjectDataTypes[i].dataType);
-    }
-  }
-
-  RSSpecificTypeMapTy::const_iterator I = RSSpecificTypeMap->find(TypeName);
-  if (I == RSSpecificTypeMap->end())
-    return DataTypeUnknown;
-  else
-    return I->getValue();
+  // The initialization of a local static is thread-safe.
+  static const RSSpecificTypeMap SpecificTypes;
+  return SpecificTypes.lookup(TypeName);
 }
 
 DataType RSExportPrimitiveType::GetRSSpecificType(const clang::Type *T) {
@@ -29,7 +29,6 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 
-#include "llvm/Support/ManagedStatic.h"
 
 #include "slang_rs_exportable.h"
 
@@ -287,9 +286,6 @@ class RSExportPrimitiveType : public RSExportType {
   DataType mType;
   bool mNormalized;
 
-  typedef llvm::StringMap<DataType> RSSpecificTypeMapTy;
-  static llvm::ManagedStatic<RSSpecificTypeMapTy> RSSpecificTypeMap;
-
   static const size_t SizeOfDataTypeInBits[];
   // @T was normalized by calling RSExportType::NormalizeType() before calling
   // this.
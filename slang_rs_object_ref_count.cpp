@@ -32,21 +32,18 @@
 
 namespace slang {
 
+llvm::sys::ThreadLocal<const RSObjectRefCount> RSObjectRefCount::Current;
+
 /* Even though those two arrays are of size DataTypeMax, only entries that
  * correspond to object types will be set.
  */
-clang::FunctionDecl *
-RSObjectRefCount::RSSetObjectFD[DataTypeMax];
-clang::FunctionDecl *
-RSObjectRefCount::RSClearObjectFD[DataTypeMax];
-
-void RSObjectRefCount::GetRSRefCountingFunctions(clang::ASTContext &C) {
+void RSObjectRefCount::GetRSRefCountingFunctions() {
   for (unsigned i = 0; i < DataTypeMax; i++) {
     RSSetObjectFD[i] = NULL;
     RSClearObjectFD[i] = NULL;
   }
 
-  clang::TranslationUnitDecl *TUDecl = C.getTranslationUnitDecl();
+  clang::TranslationUnitDecl *TUDecl = mCtx.getTranslationUnitDecl();
 
   for (clang::DeclContext::decl_iterator I = TUDecl->decls_begin(),
           E = TUDecl->decls_end(); I != E; I++) {
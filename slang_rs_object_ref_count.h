@@ -22,6 +22,8 @@
 
 #include "clang/AST/StmtVisitor.h"
 
+#include "llvm/Support/ThreadLocal.h"
+
 #include "slang_assert.h"
 #include "slang_rs_export_type.h"
 
@@ -75,16 +77,27 @@ class RSObjectRefCount : public clang::StmtVisitor<RSObjectRefCount> {
   bool RSInitFD;
 
   // RSSetObjectFD and RSClearObjectFD holds FunctionDecl of rsSetObject()
-  // and rsClearObject() in the current ASTContext.
-  static clang::FunctionDecl *RSSetObjectFD[];
-  static clang::FunctionDecl *RSClearObjectFD[];
+  // and rsClearObject() in mCtx.
+  clang::FunctionDecl *RSSetObjectFD[DataTypeMax];
+  clang::FunctionDecl *RSClearObjectFD[DataTypeMax];
+
+  // The instance whose functions are returned by GetRSSetObjectFD() and
+  // GetRSClearObjectFD(), i.e. the last one that entered Init() on the
+  // current thread. Each thread compiles one translation unit at a time.
+  static llvm::sys::ThreadLocal<const RSObjectRefCount> Current;
 
   inline Scope *getCurrentScope() {
     return mScopeStack.top();
   }
 
   // Initialize RSSetObjectFD and RSClearObjectFD.
-  static void GetRSRefCountingFunctions(clang::ASTContext &C);
+  void GetRSRefCountingFunctions();
+
+  static const RSObjectRefCount *GetCurrent() {
+    const RSObjectRefCount *RC = Current.get();
+    slangAssert((RC != NULL) && "Init() was not called on this thread");
+    return RC;
+  }
 
   // Return false if the type of variable declared in VD does not contain
   // an RS object type.
@@ -105,17 +118,23 @@ class RSObjectRefCount : public clang::StmtVisitor<RSObjectRefCount> {
         RSInitFD(false) {
   }
 
+  ~RSObjectRefCount() {
+    if (Current.get() == this)
+      Current.erase();
+  }
+
   void Init() {
     if (!RSInitFD) {
-      GetRSRefCountingFunctions(mCtx);
+      GetRSRefCountingFunctions();
       RSInitFD = true;
     }
+    Current.set(this);
   }
 
   static clang::FunctionDecl *GetRSSetObjectFD(DataType DT) {
     slangAssert(RSExportPrimitiveType::IsRSObjectType(DT));
     if (DT >= 0 && DT < DataTypeMax) {
-      return RSSetObjectFD[DT];
+      return GetCurrent()->RSSetObjectFD[DT];
     } else {
       slangAssert(false && "incorrect type");
       return NULL;
@@ -129,7 +148,7 @@ class RSObjectRefCount : public clang::StmtVisitor<RSObjectRefCount> {
   static clang::FunctionDecl *GetRSClearObjectFD(DataType DT) {
     slangAssert(RSExportPrimitiveType::IsRSObjectType(DT));
     if (DT >= 0 && DT < DataTypeMax) {
-      return RSClearObjectFD[DT];
+      return GetCurrent()->RSClearObjectFD[DT];
     } else {
       slangAssert(false && "incorrect type");
       return NULL;
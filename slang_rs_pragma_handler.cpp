@@ -179,6 +179,7 @@ public:
                     clang::PragmaIntroducerKind Introducer,
                     clang::Token &Token) {
     std::string Precision = getName();
+    bool Imprecise = false;
     // We are deprecating rs_fp_imprecise.
     if (Precision == "rs_fp_imprecise") {
       PP.Diag(Token, PP.getDiagnostics().getCustomDiagID(
@@ -186,6 +187,7 @@ public:
                          "rs_fp_imprecise is deprecated.  Assuming "
                          "rs_fp_relaxed instead."));
       Precision = "rs_fp_relaxed";
+      Imprecise = true;
     }
     // Check if we have already encountered a precision pragma already.
     std::string PreviousPrecision = mContext->getPrecision();
@@ -204,6 +206,76 @@ public:
 
     mContext->addPragma(Precision, "");
     mContext->setPrecision(Precision);
+    mContext->setImpreciseFloat(Imprecise);
+  }
+};
+
+// Handles the pragmas optimize, unroll and vectorize_width:
+//   #pragma rs optimize(<function>, O0|O1|O2|O3|Os)
+//   #pragma rs unroll(<function>, <count>)
+//   #pragma rs vectorize_width(<function>, <width>)
+// There's one instance of this handler for each of the above names.
+class RSOptimizationPragmaHandler : public RSPragmaHandler {
+ private:
+  void handleFunctionOption(clang::Preprocessor &PP,
+                            clang::Token &Tok,
+                            const std::string &Function,
+                            const std::string &Option) {
+    llvm::StringRef Name = getName();
+    int Level = -1;
+    unsigned Value = 0;
+
+    if (Name == "optimize") {
+      if (Option == "Os") {
+        Level = 2;
+      } else if (Option.size() == 2 && Option[0] == 'O' &&
+                 Option[1] >= '0' && Option[1] <= '3') {
+        Level = Option[1] - '0';
+      } else {
+        PP.Diag(Tok, PP.getDiagnostics().getCustomDiagID(
+                         clang::DiagnosticsEngine::Error,
+                         "Invalid optimization level '%0' for function "
+                         "%1().  Expected O0, O1, O2, O3 or Os."))
+            << Option << Function;
+        return;
+      }
+    } else if (llvm::StringRef(Option).getAsInteger(10, Value) ||
+               Value == 0 ||
+               (Name == "vectorize_width" &&
+                (Value > 64 || (Value & (Value - 1)) != 0))) {
+      PP.Diag(Tok, PP.getDiagnostics().getCustomDiagID(
+                       clang::DiagnosticsEngine::Error,
+                       "Invalid %0 '%1' for function %2().  Expected %3."))
+          << ((Name == "unroll") ? "unroll count" : "vectorization width")
+          << Option << Function
+          << ((Name == "unroll") ? "a positive integer"
+                                 : "a power of 2 up to 64");
+      return;
+    }
+
+    RSContext::OptimizationHints &Hints =
+        mContext->getOptimizationHints(Function);
+    if (Hints.Loc.isInvalid()) {
+      Hints.Loc = Tok.getLocation();
+    }
+    if (Name == "optimize") {
+      Hints.OptimizationLevel = Level;
+      Hints.OptimizeSize = (Option == "Os");
+    } else if (Name == "unroll") {
+      Hints.UnrollCount = Value;
+    } else {
+      Hints.VectorizeWidth = Value;
+    }
+  }
+
+ public:
+  RSOptimizationPragmaHandler(llvm::StringRef Name, RSContext *Context)
+      : RSPragmaHandler(Name, Context) { }
+
+  void HandlePragma(clang::Preprocessor &PP,
+                    clang::PragmaIntroducerKind Introducer,
+                    clang::Token &FirstToken) {
+    this->handleFunctionOptionPragma(PP, FirstToken);
   }
 };
 
@@ -341,6 +413,69 @@ void RSPragmaHandler::handleIntegerParamPragma(
   } while (PragmaToken.isNot(clang::tok::eod));
 }
 
+void RSPragmaHandler::handleFunctionOptionPragma(
+    clang::Preprocessor &PP, clang::Token &FirstToken) {
+  clang::Token &PragmaToken = FirstToken;
+
+  // Skip first token, like "optimize"
+  PP.LexUnexpandedToken(PragmaToken);
+
+  // Now, the current token must be clang::tok::lpara
+  if (PragmaToken.isNot(clang::tok::l_paren)) {
+    PP.Diag(PragmaToken,
+            PP.getDiagnostics().getCustomDiagID(
+                clang::DiagnosticsEngine::Error,
+                "expected a '('"));
+    return;
+  }
+
+  PP.LexUnexpandedToken(PragmaToken);
+  if (PragmaToken.isNot(clang::tok::identifier)) {
+    PP.Diag(PragmaToken,
+            PP.getDiagnostics().getCustomDiagID(
+                clang::DiagnosticsEngine::Error,
+                "expected a function name"));
+    return;
+  }
+  std::string Function = PP.getSpelling(PragmaToken);
+
+  PP.LexUnexpandedToken(PragmaToken);
+  if (PragmaToken.isNot(clang::tok::comma)) {
+    PP.Diag(PragmaToken,
+            PP.getDiagnostics().getCustomDiagID(
+                clang::DiagnosticsEngine::Error,
+                "expected a ','"));
+    return;
+  }
+
+  PP.LexUnexpandedToken(PragmaToken);
+  if (PragmaToken.isNot(clang::tok::identifier) &&
+      PragmaToken.isNot(clang::tok::numeric_constant)) {
+    PP.Diag(PragmaToken,
+            PP.getDiagnostics().getCustomDiagID(
+                clang::DiagnosticsEngine::Error,
+                "expected an identifier or an integer"));
+    return;
+  }
+  clang::Token OptionToken = PragmaToken;
+  std::string Option = PP.getSpelling(PragmaToken);
+
+  PP.LexUnexpandedToken(PragmaToken);
+  if (PragmaToken.isNot(clang::tok::r_paren)) {
+    PP.Diag(PragmaToken,
+            PP.getDiagnostics().getCustomDiagID(
+                clang::DiagnosticsEngine::Error,
+                "expected a ')'"));
+    return;
+  }
+
+  this->handleFunctionOption(PP, OptionToken, Function, Option);
+
+  do {
+    PP.LexUnexpandedToken(PragmaToken);
+  } while (PragmaToken.isNot(clang::tok::eod));
+}
+
 void AddPragmaHandlers(clang::Preprocessor &PP, RSContext *RsContext) {
   // For #pragma rs export_type
   PP.AddPragmaHandler("rs",
@@ -361,6 +496,14 @@ void AddPragmaHandlers(clang::Preprocessor &PP, RSContext *RsContext) {
   PP.AddPragmaHandler(new RSPrecisionPragmaHandler("rs_fp_full", RsContext));
   PP.AddPragmaHandler(new RSPrecisionPragmaHandler("rs_fp_relaxed", RsContext));
   PP.AddPragmaHandler(new RSPrecisionPragmaHandler("rs_fp_imprecise", RsContext));
+
+  // For #pragma rs optimize, unroll and vectorize_width
+  PP.AddPragmaHandler(
+      "rs", new RSOptimizationPragmaHandler("optimize", RsContext));
+  PP.AddPragmaHandler(
+      "rs", new RSOptimizationPragmaHandler("unroll", RsContext));
+  PP.AddPragmaHandler(
+      "rs", new RSOptimizationPragmaHandler("vectorize_width", RsContext));
 }
 
 
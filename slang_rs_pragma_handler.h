@@ -46,6 +46,10 @@ class RSPragmaHandler : public clang::PragmaHandler {
   virtual void handleItem(const std::string &Item) { }
   virtual void handleInt(clang::Preprocessor &PP, clang::Token &Tok,
                          const int v) { }
+  virtual void handleFunctionOption(clang::Preprocessor &PP,
+                                    clang::Token &Tok,
+                                    const std::string &Function,
+                                    const std::string &Option) { }
 
   // Handle pragma like #pragma rs [name] ([item #1],[item #2],...,[item #i])
   void handleItemListPragma(clang::Preprocessor &PP,
@@ -63,6 +67,11 @@ class RSPragmaHandler : public clang::PragmaHandler {
   void handleIntegerParamPragma(clang::Preprocessor &PP,
                                 clang::Token &FirstToken);
 
+  // Handle pragma like #pragma rs [name] ([function], [option]), where
+  // [option] is an identifier or an integer
+  void handleFunctionOptionPragma(clang::Preprocessor &PP,
+                                  clang::Token &FirstToken);
+
  public:
   virtual void HandlePragma(clang::Preprocessor &PP,
                             clang::PragmaIntroducerKind Introducer,
@@ -16,6 +16,7 @@
 
 #include "slang_rs_reflect_utils.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <string>
@@ -25,7 +26,7 @@
 
 #include "os_sep.h"
 #include "slang_assert.h"
-#include "slang_utils.h"
+#include "slang_output_sink.h"
 
 namespace slang {
 
@@ -168,8 +169,8 @@ static bool GenerateJavaCodeAccessorMethodForBitwidth(
     filename = context.bc64FileName;
   }
 
-  FILE *pfin = fopen(filename.c_str(), "rb");
-  if (pfin == NULL) {
+  std::string bitcode;
+  if (!context.sink->readFile(filename, &bitcode)) {
     fprintf(stderr, "Error: could not read file %s\n", filename.c_str());
     return false;
   }
@@ -181,17 +182,14 @@ static bool GenerateJavaCodeAccessorMethodForBitwidth(
   // make sure the generated function for a segment won't break the Javac
   // size limitation (64K).
   static const int SEG_SIZE = 0x2000;
-  char *buff = new char[SEG_SIZE];
-  int read_length;
+  const char *buff = bitcode.data();
   int seg_num = 0;
-  int total_length = 0;
-  while ((read_length = fread(buff, 1, SEG_SIZE, pfin)) > 0) {
-    GenerateSegmentMethod(buff, read_length, bitwidth, seg_num, out);
+  int total_length = bitcode.size();
+  for (int offset = 0; offset < total_length; offset += SEG_SIZE) {
+    int seg_length = std::min(SEG_SIZE, total_length - offset);
+    GenerateSegmentMethod(buff + offset, seg_length, bitwidth, seg_num, out);
     ++seg_num;
-    total_length += read_length;
   }
-  delete[] buff;
-  fclose(pfin);
 
   // output the internal accessor method
   out.indent() << "private static int bitCode" << bitwidth << "Length = "
@@ -261,17 +259,12 @@ bool RSSlangReflectUtils::GenerateJavaBitCodeAccessor(
     const BitCodeAccessorContext &context) {
   string output_path =
       ComputePackagedPath(context.reflectPath, context.packageName);
-  if (!SlangUtils::CreateDirectoryWithParents(llvm::StringRef(output_path),
-                                              NULL)) {
-    fprintf(stderr, "Error: could not create dir %s\n", output_path.c_str());
-    return false;
-  }
 
   string clazz_name(JavaBitcodeClassNameFromRSFileName(context.rsFileName));
   string filename(clazz_name);
   filename += ".java";
 
-  GeneratedFile out;
+  GeneratedFile out(context.sink);
   if (!out.startFile(output_path, filename, context.rsFileName,
                      context.licenseNote, true, context.verbose)) {
     return false;
@@ -281,8 +274,7 @@ bool RSSlangReflectUtils::GenerateJavaBitCodeAccessor(
 
   bool ret = GenerateAccessorClass(context, clazz_name.c_str(), out);
 
-  out.closeFile();
-  return ret;
+  return out.closeFile() && ret;
 }
 
 std::string JoinPath(const std::string &path1, const std::string &path2) {
@@ -337,6 +329,10 @@ static const char *const gApacheLicenseNote =
     " */\n"
     "\n";
 
+GeneratedFile::GeneratedFile(OutputSink *sink)
+    : mSink(sink ? sink : OutputSink::getFileSystemSink()) {
+}
+
 bool GeneratedFile::startFile(const string &outDirectory,
                               const string &outFileName,
                               const string &sourceFileName,
@@ -346,23 +342,11 @@ bool GeneratedFile::startFile(const string &outDirectory,
     printf("Generating %s\n", outFileName.c_str());
   }
 
-  // Create the parent directories.
-  if (!outDirectory.empty()) {
-    std::string errorMsg;
-    if (!SlangUtils::CreateDirectoryWithParents(outDirectory, &errorMsg)) {
-      fprintf(stderr, "Error: %s\n", errorMsg.c_str());
-      return false;
-    }
-  }
-
-  std::string FilePath = JoinPath(outDirectory, outFileName);
+  mPath = JoinPath(outDirectory, outFileName);
 
-  // Open the file.
-  open(FilePath.c_str());
-  if (!good()) {
-    fprintf(stderr, "Error: could not write file %s\n", outFileName.c_str());
-    return false;
-  }
+  // Start with an empty buffer.
+  str("");
+  clear();
 
   // Write the license.
   if (optionalLicense != NULL) {
@@ -385,7 +369,16 @@ bool GeneratedFile::startFile(const string &outDirectory,
   return true;
 }
 
-void GeneratedFile::closeFile() { close(); }
+bool GeneratedFile::closeFile() {
+  std::string errorMsg("could not render it");
+  bool Ok = good() && mSink->writeFile(mPath, str(), &errorMsg);
+  if (!Ok) {
+    fprintf(stderr, "Error: could not write file %s: %s\n", mPath.c_str(),
+            errorMsg.c_str());
+  }
+  str("");
+  return Ok;
+}
 
 void GeneratedFile::increaseIndent() { mIndent.append("    "); }
 
@@ -17,11 +17,13 @@
 #ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_REFLECT_UTILS_H_ // NOLINT
 #define _FRAMEWORKS_COMPILE_SLANG_SLANG_REFLECT_UTILS_H_
 
-#include <fstream>
+#include <sstream>
 #include <string>
 
 namespace slang {
 
+class OutputSink;
+
 // BitCode storage type
 enum BitCodeStorageType { BCST_APK_RESOURCE, BCST_JAVA_CODE, BCST_CPP_CODE };
 
@@ -36,6 +38,7 @@ public:
   // packageName: the package of the output Java file.
   // verbose: whether or not to print out additional info about compilation.
   // bcStorage: where to emit bitcode to (resource file or embedded).
+  // sink: where the bitcode files are read from and the Java file written to.
   struct BitCodeAccessorContext {
     const char *rsFileName;
     const char *bc32FileName;
@@ -45,6 +48,7 @@ public:
     const std::string *licenseNote;
     bool verbose;
     BitCodeStorageType bcStorage;
+    OutputSink *sink;
   };
 
   // Return the stem of the file name, i.e., remove the dir and the extension.
@@ -104,11 +108,16 @@ std::string RootNameFromRSFileName(const std::string &rsFileName);
 /* This class is used to generate one source file.  There will be one instance
  * for each generated file.
  */
-class GeneratedFile : public std::ofstream {
+/* The file is rendered in memory, and only written out by closeFile() if its
+ * contents changed. This keeps the modification time of unchanged reflected
+ * files, and so avoids recompiling them.
+ */
+class GeneratedFile : public std::ostringstream {
 public:
+  /* The file is written to sink, or to the filesystem if sink is NULL. */
+  explicit GeneratedFile(OutputSink *sink = NULL);
+
   /* Starts the file by:
-   * - creating the parent directories (if needed),
-   * - opening the stream,
    * - writing out the license,
    * - writing a message that this file has been auto-generated.
    * If optionalLicense is NULL, a default license is used.
@@ -116,7 +125,11 @@ public:
   bool startFile(const std::string &outPath, const std::string &outFileName,
                  const std::string &sourceFileName,
                  const std::string *optionalLicense, bool isJava, bool verbose);
-  void closeFile();
+  /* Writes the file to the sink (for the filesystem: atomically, creating the
+   * parent directories, unless it already has the same contents).
+   * Returns false on error.
+   */
+  bool closeFile();
 
   void increaseIndent(); // Increases the new line indentation by 4.
   void decreaseIndent(); // Decreases the new line indentation by 4.
@@ -137,13 +150,15 @@ public:
   /* Indents the line.  By returning *this, we can use like this:
    *  mOut.ident() << "a = b;\n";
    */
-  std::ofstream &indent() {
+  std::ostream &indent() {
     *this << mIndent;
     return *this;
   }
 
 private:
   std::string mIndent; // The correct spacing at the beginning of each line.
+  std::string mPath;   // The path of the file being generated.
+  OutputSink *mSink;   // Where the file is written.
 };
 
 } // namespace slang
@@ -285,7 +285,7 @@ RSReflectionJava::RSReflectionJava(const RSContext *Context,
                                    const std::string &OutputBaseDirectory,
                                    const std::string &RSSourceFileName,
                                    const std::string &BitCodeFileName,
-                                   bool EmbedBitcodeInJava)
+                                   bool EmbedBitcodeInJava, OutputSink *Sink)
     : mRSContext(Context), mPackageName(Context->getReflectJavaPackageName()),
       mRSPackageName(Context->getRSPackageName()),
       mOutputBaseDirectory(OutputBaseDirectory),
@@ -296,7 +296,8 @@ RSReflectionJava::RSReflectionJava(const RSContext *Context,
                        RSSlangReflectUtils::JavaClassNameFromRSFileName(
                            mRSSourceFileName.c_str())),
       mEmbedBitcodeInJava(EmbedBitcodeInJava), mNextExportVarSlot(0),
-      mNextExportFuncSlot(0), mNextExportForEachSlot(0), mLastError(""),
+      mNextExportFuncSlot(0), mNextExportForEachSlot(0), mOut(Sink),
+      mLastError(""),
       mGeneratedFileNames(GeneratedFileNames), mFieldIndex(0) {
   slangAssert(mGeneratedFileNames && "Must supply GeneratedFileNames");
   slangAssert(!mPackageName.empty() && mPackageName != "-");
@@ -343,9 +344,7 @@ bool RSReflectionJava::genScriptClass(const std::string &ClassName,
        I != E; I++)
     genExportFunction(*I);
 
-  endClass();
-
-  return true;
+  return endClass();
 }
 
 void RSReflectionJava::genScriptClassConstructor() {
@@ -1427,7 +1426,8 @@ bool RSReflectionJava::genTypeClass(const RSExportRecordType *ERT,
     genTypeClassResize();
   }
 
-  endClass();
+  if (!endClass())
+    return false;
 
   resetFieldIndex();
   clearFieldIndexMap();
@@ -2035,10 +2035,11 @@ bool RSReflectionJava::startClass(AccessModifier AM, bool IsStatic,
   return true;
 }
 
-void RSReflectionJava::endClass() {
+bool RSReflectionJava::endClass() {
   mOut.endBlock();
-  mOut.closeFile();
+  bool Ok = mOut.closeFile();
   clear();
+  return Ok;
 }
 
 void RSReflectionJava::startTypeClass(const std::string &ClassName) {
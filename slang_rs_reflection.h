@@ -32,6 +32,7 @@
 
 namespace slang {
 
+class OutputSink;
 class RSContext;
 class RSExportVar;
 class RSExportFunc;
@@ -131,7 +132,8 @@ public:
   bool startClass(AccessModifier AM, bool IsStatic,
                   const std::string &ClassName, const char *SuperClassName,
                   std::string &ErrorMsg);
-  void endClass();
+  // Returns false if the class file could not be written.
+  bool endClass();
 
   void startFunction(AccessModifier AM, bool IsStatic, const char *ReturnType,
                      const std::string &FunctionName, int Argc, ...);
@@ -241,7 +243,7 @@ public:
                    const std::string &OutputBaseDirectory,
                    const std::string &RSSourceFilename,
                    const std::string &BitCodeFileName,
-                   bool EmbedBitcodeInJava);
+                   bool EmbedBitcodeInJava, OutputSink *Sink);
 
   bool reflect();
 
@@ -28,6 +28,7 @@
 #include <utility>
 
 #include "os_sep.h"
+#include "slang_output_sink.h"
 #include "slang_rs_context.h"
 #include "slang_rs_export_var.h"
 #include "slang_rs_export_foreach.h"
@@ -113,10 +114,13 @@ static std::string GetTypeName(const RSExportType *ET, bool Brackets = true) {
 RSReflectionCpp::RSReflectionCpp(const RSContext *Context,
                                  const string &OutputDirectory,
                                  const string &RSSourceFileName,
-                                 const string &BitCodeFileName)
+                                 const string &BitCodeFileName,
+                                 OutputSink *Sink)
     : mRSContext(Context), mRSSourceFilePath(RSSourceFileName),
-      mBitCodeFilePath(BitCodeFileName), mOutputDirectory(OutputDirectory),
-      mNextExportVarSlot(0), mNextExportFuncSlot(0), mNextExportForEachSlot(0) {
+      mBitCodeFilePath(BitCodeFileName),
+      mSink(Sink ? Sink : OutputSink::getFileSystemSink()),
+      mOutputDirectory(OutputDirectory), mNextExportVarSlot(0),
+      mNextExportFuncSlot(0), mNextExportForEachSlot(0), mOut(mSink) {
   mCleanedRSFileName = RootNameFromRSFileName(mRSSourceFilePath);
   mClassName = "ScriptC_" + mCleanedRSFileName;
 }
@@ -124,10 +128,7 @@ RSReflectionCpp::RSReflectionCpp(const RSContext *Context,
 RSReflectionCpp::~RSReflectionCpp() {}
 
 bool RSReflectionCpp::reflect() {
-  writeHeaderFile();
-  writeImplementationFile();
-
-  return true;
+  return writeHeaderFile() && writeImplementationFile();
 }
 
 #define RS_TYPE_CLASS_NAME_PREFIX "ScriptField_"
@@ -171,8 +172,7 @@ bool RSReflectionCpp::writeHeaderFile() {
   genExportFunctionDeclarations();
 
   mOut.endBlock(true);
-  mOut.closeFile();
-  return true;
+  return mOut.closeFile();
 }
 
 void RSReflectionCpp::genTypeInstancesUsedInForEach() {
@@ -303,22 +303,22 @@ void RSReflectionCpp::genExportFunctionDeclarations() {
 }
 
 bool RSReflectionCpp::genEncodedBitCode() {
-  FILE *pfin = fopen(mBitCodeFilePath.c_str(), "rb");
-  if (pfin == NULL) {
+  std::string BitCode;
+  if (!mSink->readFile(mBitCodeFilePath, &BitCode)) {
     fprintf(stderr, "Error: could not read file %s\n",
             mBitCodeFilePath.c_str());
     return false;
   }
 
-  unsigned char buf[16];
-  int read_length;
   mOut.indent() << "static const unsigned char __txt[] =";
   mOut.startBlock();
-  while ((read_length = fread(buf, 1, sizeof(buf), pfin)) > 0) {
+  for (size_t Start = 0; Start < BitCode.size(); Start += 16) {
+    size_t End = std::min(Start + 16, BitCode.size());
     mOut.indent();
-    for (int i = 0; i < read_length; i++) {
+    for (size_t i = Start; i < End; i++) {
       char buf2[16];
-      snprintf(buf2, sizeof(buf2), "0x%02x,", buf[i]);
+      snprintf(buf2, sizeof(buf2), "0x%02x,",
+               static_cast<unsigned char>(BitCode[i]));
       mOut << buf2;
     }
     mOut << "\n";
@@ -337,7 +337,9 @@ bool RSReflectionCpp::writeImplementationFile() {
 
   mOut.indent() << "#include \"" << mClassName << ".h\"\n\n";
 
-  genEncodedBitCode();
+  if (!genEncodedBitCode()) {
+    return false;
+  }
   mOut.indent() << "\n\n";
 
   const std::string &packageName = mRSContext->getReflectJavaPackageName();
@@ -485,8 +487,7 @@ bool RSReflectionCpp::writeImplementationFile() {
     slot++;
   }
 
-  mOut.closeFile();
-  return true;
+  return mOut.closeFile();
 }
 
 void RSReflectionCpp::genExportVariablesGetterAndSetter() {
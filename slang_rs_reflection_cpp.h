@@ -26,11 +26,13 @@
 
 namespace slang {
 
+class OutputSink;
+
 class RSReflectionCpp {
  public:
   RSReflectionCpp(const RSContext *Context, const std::string &OutputDirectory,
                   const std::string &RSSourceFileName,
-                  const std::string &BitCodeFileName);
+                  const std::string &BitCodeFileName, OutputSink *Sink);
   virtual ~RSReflectionCpp();
 
   bool reflect();
@@ -46,6 +48,8 @@ class RSReflectionCpp {
   std::string mRSSourceFilePath;
   // Path to the file that contains the byte code generated from the *.rs file.
   std::string mBitCodeFilePath;
+  // Where the byte code is read from and the C++ files are written to.
+  OutputSink *mSink;
   // The directory where we'll generate the C++ files.
   std::string mOutputDirectory;
   // A cleaned up version of the *.rs file name that can be used in generating
@@ -18,8 +18,11 @@
 
 #include <string>
 
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
 
 namespace slang {
 
@@ -33,4 +36,37 @@ bool SlangUtils::CreateDirectoryWithParents(llvm::StringRef Dir,
   return true;
 }
 
+bool SlangUtils::WriteFileAtomically(llvm::StringRef Path,
+                                     llvm::StringRef Contents) {
+  int FD;
+  llvm::SmallString<256> TempPath;
+  if (llvm::sys::fs::createUniqueFile(Path + "-%%%%%%%%", FD, TempPath))
+    return false;
+
+  bool Failed;
+  {
+    llvm::raw_fd_ostream OS(FD, /* shouldClose = */true);
+    OS << Contents;
+    OS.close();
+    Failed = OS.has_error();
+    OS.clear_error();
+  }
+
+  if (Failed || llvm::sys::fs::rename(TempPath.str(), Path)) {
+    llvm::sys::fs::remove(TempPath.str());
+    return false;
+  }
+  return true;
+}
+
+bool SlangUtils::WriteFileIfChanged(llvm::StringRef Path,
+                                    llvm::StringRef Contents) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > MBOrErr =
+      llvm::MemoryBuffer::getFile(Path);
+  if (!MBOrErr.getError() && (MBOrErr.get()->getBuffer() == Contents))
+    return true;
+
+  return WriteFileAtomically(Path, Contents);
+}
+
 }  // namespace slang
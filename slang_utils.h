@@ -32,6 +32,17 @@ class SlangUtils {
  public:
   static bool CreateDirectoryWithParents(llvm::StringRef Dir,
                                          std::string* Error);
+
+  // Write Contents to a temporary file next to Path, then rename it to Path.
+  // Other processes therefore never see a partially written Path.
+  static bool WriteFileAtomically(llvm::StringRef Path,
+                                  llvm::StringRef Contents);
+
+  // Same as WriteFileAtomically(), but leave Path (and its modification time)
+  // untouched if it already holds Contents. This keeps the build steps
+  // depending on Path from running again.
+  static bool WriteFileIfChanged(llvm::StringRef Path,
+                                 llvm::StringRef Contents);
 };
 }  // namespace slang
 
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "strip_bitcode.h"
+
+#include <vector>
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Metadata.h"
+
+#include "slang.h"
+#include "slang_rs_metadata.h"
+
+namespace slang {
+
+StripBitcode::StripBitcode() : ModulePass(ID) {
+}
+
+
+bool StripBitcode::runOnFunction(llvm::Function &F) {
+  bool Changed = false;
+  for (llvm::Function::arg_iterator I = F.arg_begin(), E = F.arg_end();
+       I != E; ++I) {
+    if (I->hasName()) {
+      I->setName("");
+      Changed = true;
+    }
+  }
+  for (llvm::Function::iterator BB = F.begin(), BE = F.end(); BB != BE; ++BB) {
+    if (BB->hasName()) {
+      BB->setName("");
+      Changed = true;
+    }
+    for (llvm::BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E;
+         ++I) {
+      if (I->hasName()) {
+        I->setName("");
+        Changed = true;
+      }
+    }
+  }
+  return Changed;
+}
+
+
+bool StripBitcode::isNeededNamedMetadata(llvm::StringRef Name) {
+  // #rs_export_var, #rs_export_func, #rs_export_foreach(_name) and
+  // #rs_export_type.
+  return Name.startswith("#rs_export_") ||
+         Name == RS_OBJECT_SLOTS_MN ||
+         Name == Slang::PragmaMetadataName ||
+         Name.startswith("llvm.dbg.") ||
+         Name == "llvm.module.flags";
+}
+
+
+bool StripBitcode::runOnModule(llvm::Module &M) {
+  bool Changed = false;
+  for (llvm::Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    Changed |= runOnFunction(*I);
+  }
+
+  // E.g. llvm.ident and the %<struct name> field descriptions, only used by
+  // the reflection.
+  std::vector<llvm::NamedMDNode*> Unneeded;
+  for (llvm::Module::named_metadata_iterator I = M.named_metadata_begin(),
+           E = M.named_metadata_end();
+       I != E; ++I) {
+    if (!isNeededNamedMetadata(I->getName()))
+      Unneeded.push_back(I);
+  }
+  for (unsigned i = 0, e = Unneeded.size(); i != e; i++) {
+    M.eraseNamedMetadata(Unneeded[i]);
+    Changed = true;
+  }
+
+  return Changed;
+}
+
+
+llvm::ModulePass *createStripBitcodePass() {
+  return new StripBitcode();
+}
+
+
+char StripBitcode::ID = 0;
+static llvm::RegisterPass<StripBitcode> RPSB(
+    "StripBitcode", "Strip Bitcode Pass");
+
+}  // namespace slang
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_STRIP_BITCODE_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_STRIP_BITCODE_H_
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+namespace slang {
+
+// Remove what the on-device compiler never reads from the module
+// (-strip-bitcode): the names of the arguments, basic blocks and instructions,
+// and the named metadata other than the one bcinfo extracts (#rs_export_*,
+// #rs_object_slots and #pragma), the debug information and the module flags.
+// The metadata nodes only reachable from the removed named metadata are then
+// left out by the bitcode writers.
+class StripBitcode : public llvm::ModulePass {
+ public:
+  static char ID;
+
+  StripBitcode();
+
+  bool runOnFunction(llvm::Function &F);
+
+  // Returns true if the named metadata Name must be kept.
+  static bool isNeededNamedMetadata(llvm::StringRef Name);
+
+  virtual bool runOnModule(llvm::Module &M);
+};
+
+llvm::ModulePass *createStripBitcodePass();
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_STRIP_BITCODE_H_  NOLINT
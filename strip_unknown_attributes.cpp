@@ -18,12 +18,32 @@
 
 namespace slang {
 
+const char StripUnknownAttributes::kOptNoneNoInline[] = "rs-optnone-noinline";
+
 StripUnknownAttributes::StripUnknownAttributes() : ModulePass(ID) {
 }
 
 
 bool StripUnknownAttributes::runOnFunction(llvm::Function &F) {
   bool changed = false;
+  if (F.hasFnAttribute(llvm::Attribute::OptimizeNone)) {
+    F.removeFnAttr(llvm::Attribute::OptimizeNone);
+    changed = true;
+  }
+  if (F.getAttributes().hasAttribute(llvm::AttributeSet::FunctionIndex,
+                                     kOptNoneNoInline)) {
+    llvm::AttrBuilder B;
+    B.addAttribute(llvm::Attribute::NoInline);
+    B.addAttribute(kOptNoneNoInline);
+    F.removeAttributes(llvm::AttributeSet::FunctionIndex,
+        llvm::AttributeSet::get(F.getContext(),
+                                llvm::AttributeSet::FunctionIndex, B));
+    changed = true;
+  }
+  if (F.hasFnAttribute(llvm::Attribute::Cold)) {
+    F.removeFnAttr(llvm::Attribute::Cold);
+    changed = true;
+  }
   for (llvm::Function::arg_iterator I = F.arg_begin(), E = F.arg_end();
        I != E; ++I) {
     llvm::Argument &A = *I;
@@ -37,6 +57,12 @@ bool StripUnknownAttributes::runOnFunction(llvm::Function &F) {
       A.removeAttr(ToStrip);
       changed = true;
     }
+    if (A.hasNonNullAttr()) {
+      llvm::AttributeSet ToStrip = llvm::AttributeSet::get(F.getContext(),
+          A.getArgNo() + 1, llvm::Attribute::NonNull);
+      A.removeAttr(ToStrip);
+      changed = true;
+    }
   }
   return changed;
 }
@@ -24,10 +24,18 @@ namespace slang {
 // other than function attributes, so it will fail verification otherwise.
 // Since we never ran the verifier in Jellybean, it ends up with potential
 // crashes deeper in CodeGen.
+// The nonnull parameter attribute and the optnone and cold function
+// attributes (see RSBackend) are removed too, as they do not exist in the
+// bitcode formats we write. So is the noinline that optnone requires, unless
+// the function had it already (see kOptNoneNoInline).
 class StripUnknownAttributes : public llvm::ModulePass {
 public:
   static char ID;
 
+  // The string attribute marking the functions which were only made noinline
+  // for optnone.
+  static const char kOptNoneNoInline[];
+
   StripUnknownAttributes();
 
   bool runOnFunction(llvm::Function &F);
@@ -0,0 +1,9 @@
+// -manifest manifest.txt
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+int i;
+
+void root(const int *in, int *out) {
+  *out = *in + i;
+}
@@ -0,0 +1,10 @@
+// -jobs 3
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// expected-error: different number of members
+typedef struct DifferentDefinition1{
+	int member1;
+} DifferentDefinition1;
+
+DifferentDefinition1 o1;
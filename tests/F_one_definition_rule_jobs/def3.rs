@@ -0,0 +1,5 @@
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// Compiles, but comes after the conflicting input.
+int i3;
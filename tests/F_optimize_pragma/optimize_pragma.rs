@@ -0,0 +1,12 @@
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+#pragma rs optimize(root, O4)
+#pragma rs unroll(root, 0)
+#pragma rs vectorize_width(root, 3)
+#pragma rs optimize(root)
+#pragma rs unroll(, 2)
+
+void root(const int *in, int *out) {
+  *out = *in;
+}
@@ -0,0 +1,9 @@
+// -fprofile-use=malformed.rsprof
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+void filter(int x, int *out) {
+  if (x > 100) {
+    *out = 1;
+  }
+}
@@ -0,0 +1,5 @@
+// -ivfsoverlay missing.yaml
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+int i;
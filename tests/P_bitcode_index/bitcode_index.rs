@@ -0,0 +1,18 @@
+// -bitcode-index
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+int gOffset;
+float gScale;
+
+static int twice(int v) {
+  return v * 2;
+}
+
+int add_offset(int v) {
+  return twice(v) + gOffset;
+}
+
+void root(const int *in, int *out) {
+  *out = add_offset(*in);
+}
@@ -0,0 +1,15 @@
+// -cache-dir tmp/cache
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+typedef struct Point {
+  float x;
+  float y;
+} Point_t;
+
+Point_t p;
+
+void root(const Point_t *in, Point_t *out) {
+  out->x = in->x + p.x;
+  out->y = in->y + p.y;
+}
@@ -0,0 +1,9 @@
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+typedef struct Point {
+  float x;
+  float y;
+} Point_t;
+
+Point_t q;
@@ -0,0 +1,10 @@
+// -manifest manifest.txt -jobs 2
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+int i;
+float f;
+
+void root(const int *in, int *out) {
+  *out = *in + i;
+}
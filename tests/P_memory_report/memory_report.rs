@@ -0,0 +1,11 @@
+// -fmemory-report tmp/memory_report.json
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+static const int gTable[16] = {
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+};
+
+int __attribute__((kernel)) root(int in, uint32_t x) {
+  return in + gTable[x & 15];
+}
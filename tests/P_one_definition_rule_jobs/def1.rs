@@ -0,0 +1,17 @@
+// -jobs 2
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+typedef struct SameDefinition1{
+	int member1;
+	float member2;
+	int member3;
+	int member4;
+	float member5;
+	float member6;
+	int member7;
+	int member8;
+	int member9;
+} SameDefinition1;
+
+SameDefinition1 o1;
@@ -0,0 +1,13 @@
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+#pragma rs optimize(root, O2)
+#pragma rs optimize(helper, Os)
+
+static int helper(int x) {
+  return x * 3;
+}
+
+void root(const int *in, int *out) {
+  *out = helper(*in);
+}
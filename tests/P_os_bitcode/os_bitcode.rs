@@ -0,0 +1,23 @@
+// -Os-bitcode -g
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+int gCount;
+float2 gScale;
+static float sBias = 0.5f;
+
+static float bias(float x) {
+  return x + sBias;
+}
+
+float2 scale(float2 v) {
+  return v * gScale;
+}
+
+void root(const float *in, float *out, uint32_t x) {
+  float acc = 0.f;
+  for (int i = 0; i < gCount; i++) {
+    acc += bias(in[i]) * (float) x;
+  }
+  *out = acc;
+}
@@ -0,0 +1,9 @@
+// -target-api 14 -Os-bitcode
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+int gCount;
+
+void root(const float *in, float *out) {
+  *out = *in * (float) gCount;
+}
@@ -0,0 +1,9 @@
+// -pch-dir tmp/pch
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+rs_allocation a;
+
+float4 __attribute__((kernel)) root(float4 in, uint32_t x) {
+  return rsGetElementAt_float4(a, x) + in;
+}
@@ -0,0 +1,8 @@
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+rs_matrix4x4 m;
+
+float4 __attribute__((kernel)) root(float4 in) {
+  return rsMatrixMultiply(&m, in);
+}
@@ -0,0 +1,9 @@
+// -ftime-trace tmp/time_trace.json
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+int gInt;
+
+int __attribute__((kernel)) root(int in) {
+  return in + gInt;
+}
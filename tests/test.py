@@ -8,6 +8,7 @@ Runs subdirectories of tests for the Renderscript compiler.
 """
 
 import filecmp
+import fnmatch
 import glob
 import os
 import re
@@ -47,6 +48,35 @@ def UpdateFiles(src, dst):
     shutil.copyfile(src, dst)
 
 
+def CheckOutputs(expect):
+  """Checks the files written under tmp/ against the patterns of expect.
+
+  Each line of expect is a pattern (as for fnmatch, relative to the test
+  directory) that some output must match, or, after a '!', that no output may
+  match. Lines starting with '#' are ignored.
+  """
+  outputs = []
+  for root, _, files in os.walk('tmp'):
+    for f in files:
+      outputs.append(os.path.join(root, f))
+
+  for line in open(expect, 'r'):
+    pattern = line.strip()
+    if not pattern or pattern[0] == '#':
+      continue
+    if pattern[0] == '!':
+      unexpected = fnmatch.filter(outputs, pattern[1:])
+      if unexpected:
+        if Options.verbose:
+          print 'Unexpected outputs: %s' % ' '.join(unexpected)
+        return False
+    elif not fnmatch.filter(outputs, pattern):
+      if Options.verbose:
+        print 'No output matching %s' % pattern
+      return False
+  return True
+
+
 def GetCommandLineArgs(filename):
   """Extracts command line arguments from first comment line in a file."""
   f = open(filename, 'r')
@@ -142,6 +172,11 @@ def ExecTest(dirname):
     passed = False
     if Options.verbose:
       print 'stderr is different'
+  if os.path.isfile('outputs.txt.expect'):
+    if not CheckOutputs('outputs.txt.expect'):
+      passed = False
+      if Options.verbose:
+        print 'outputs are different'
 
   if Options.updateCTS:
     # Copy resulting files to appropriate CTS directory (if different).